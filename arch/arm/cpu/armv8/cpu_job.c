@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Secondary cores for jobs, started and stopped through PSCI
+ *
+ * The cores are the ones listed under /cpus in the device tree, apart from
+ * the boot core. They use the boot core's page tables and exception
+ * vectors, so they see memory the same way.
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <cpu_job.h>
+#include <log.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <asm/psci.h>
+#include <asm/ptrace.h>
+#include <asm/system.h>
+#include <dm/ofnode.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define MPIDR_HWID_MASK		0xff00ffffffUL
+/* Time allowed for a core to turn off, in ms */
+#define CPU_JOB_OFF_TIMEOUT	100
+
+/**
+ * struct cpu_job_boot - state a secondary core needs to join U-Boot
+ *
+ * This is read by cpu_job_entry with the MMU off, so the order of the
+ * members must match the code there.
+ */
+struct cpu_job_boot {
+	u64 mair;
+	u64 tcr;
+	u64 ttbr0;
+	u64 sctlr;
+	u64 vbar;
+	u64 gd;
+	u64 sp;
+	u64 worker;
+} __aligned(CONFIG_SYS_CACHELINE_SIZE);
+
+void cpu_job_entry(void);
+
+static struct cpu_job_boot job_boot[CONFIG_CPU_JOB_WORKERS];
+static u64 job_mpidr[CONFIG_CPU_JOB_WORKERS];
+static u64 boot_mpidr;
+
+#define read_el_regs(el, b) do {					\
+	asm volatile("mrs %0, mair_el" #el : "=r" ((b)->mair));		\
+	asm volatile("mrs %0, tcr_el" #el : "=r" ((b)->tcr));		\
+	asm volatile("mrs %0, ttbr0_el" #el : "=r" ((b)->ttbr0));	\
+	asm volatile("mrs %0, sctlr_el" #el : "=r" ((b)->sctlr));	\
+	asm volatile("mrs %0, vbar_el" #el : "=r" ((b)->vbar));		\
+} while (0)
+
+/* Find the MPIDR of the @worker'th core which is not the boot core */
+static int cpu_job_find_core(int worker, u64 *mpidrp)
+{
+	const fdt32_t *reg;
+	const char *type;
+	ofnode cpus, node;
+	u64 mpidr;
+	int len;
+
+	cpus = ofnode_path("/cpus");
+	if (!ofnode_valid(cpus))
+		return -ENODEV;
+	ofnode_for_each_subnode(node, cpus) {
+		type = ofnode_read_string(node, "device_type");
+		if (!type || strcmp(type, "cpu"))
+			continue;
+		reg = ofnode_get_property(node, "reg", &len);
+		if (!reg)
+			continue;
+		if (len == sizeof(u64))
+			mpidr = fdt64_to_cpu(*(const fdt64_t *)reg);
+		else
+			mpidr = fdt32_to_cpu(*reg);
+		if (mpidr == boot_mpidr)
+			continue;
+		if (!worker--) {
+			*mpidrp = mpidr;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+/* PSCI return values are 32 bits wide, even for SMC64 calls */
+static int cpu_job_psci(ulong fn, ulong a1, ulong a2, ulong a3)
+{
+	struct pt_regs regs;
+
+	regs.regs[0] = fn;
+	regs.regs[1] = a1;
+	regs.regs[2] = a2;
+	regs.regs[3] = a3;
+	smc_call(&regs);
+
+	return (int)regs.regs[0];
+}
+
+int arch_cpu_job_start(int worker, void *stack_top)
+{
+	struct cpu_job_boot *boot = &job_boot[worker];
+	int ret;
+
+	boot_mpidr = read_mpidr() & MPIDR_HWID_MASK;
+	ret = cpu_job_find_core(worker, &job_mpidr[worker]);
+	if (ret)
+		return ret;
+
+	switch (current_el()) {
+	case 3:
+		read_el_regs(3, boot);
+		break;
+	case 2:
+		read_el_regs(2, boot);
+		break;
+	default:
+		read_el_regs(1, boot);
+		break;
+	}
+	boot->gd = (ulong)gd;
+	boot->sp = (ulong)stack_top;
+	boot->worker = worker;
+	flush_dcache_range((ulong)boot, (ulong)(boot + 1));
+
+	ret = cpu_job_psci(ARM_PSCI_0_2_FN64_CPU_ON, job_mpidr[worker],
+			   (ulong)cpu_job_entry, (ulong)boot);
+	if (ret) {
+		log_debug("CPU_ON %llx failed (err=%d)\n", job_mpidr[worker],
+			  ret);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int arch_cpu_job_stop(int worker)
+{
+	ulong start = get_timer(0);
+
+	do {
+		if (cpu_job_psci(ARM_PSCI_0_2_FN64_AFFINITY_INFO,
+				 job_mpidr[worker], 0, 0) ==
+		    PSCI_AFFINITY_LEVEL_OFF)
+			return 0;
+	} while (get_timer(start) < CPU_JOB_OFF_TIMEOUT);
+
+	return -ETIMEDOUT;
+}
+
+bool arch_cpu_job_on_worker(void)
+{
+	return (read_mpidr() & MPIDR_HWID_MASK) != boot_mpidr;
+}
+
+void arch_cpu_job_idle(void)
+{
+	asm volatile("wfe" : : : "memory");
+}
+
+void arch_cpu_job_wake(void)
+{
+	asm volatile("dsb ish\n\tsev" : : : "memory");
+}
@@ -6,6 +6,7 @@
 #include <common.h>
 #include <bootstage.h>
 #include <cpu_func.h>
+#include <cpu_job.h>
 #include <errno.h>
 #include <log.h>
 #include <asm/global_data.h>
@@ -373,3 +374,52 @@ ulong timer_get_boot_us(void)
 
 	return (count - base_count) / 1000;
 }
+
+#if CONFIG_IS_ENABLED(CPU_JOB)
+/* Workers are host threads, which come with their own stack */
+static void *job_threads[CONFIG_CPU_JOB_WORKERS];
+
+static void sandbox_job_thread(void *arg)
+{
+	cpu_job_worker((ulong)arg);
+}
+
+int arch_cpu_job_start(int worker, void *stack_top)
+{
+	job_threads[worker] = os_thread_create(sandbox_job_thread,
+					       (void *)(ulong)worker);
+
+	return job_threads[worker] ? 0 : -EAGAIN;
+}
+
+int arch_cpu_job_stop(int worker)
+{
+	int ret;
+
+	ret = os_thread_join(job_threads[worker]);
+	job_threads[worker] = NULL;
+
+	return ret ? -EIO : 0;
+}
+
+bool arch_cpu_job_on_worker(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_CPU_JOB_WORKERS; i++) {
+		if (job_threads[i] && os_thread_is_self(job_threads[i]))
+			return true;
+	}
+
+	return false;
+}
+
+void arch_cpu_job_idle(void)
+{
+	os_usleep(10);
+}
+
+void arch_cpu_job_wake(void)
+{
+}
+#endif
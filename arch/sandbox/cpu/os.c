@@ -202,6 +202,7 @@ int os_map_file(const char *pathname, int os_flags, void **bufp, int *sizep)
 {
 	void *ptr;
 	int size;
+	int prot;
 	int ifd;
 
 	ifd = os_open(pathname, os_flags);
@@ -215,7 +216,11 @@ int os_map_file(const char *pathname, int os_flags, void **bufp, int *sizep)
 		return -EIO;
 	}
 
-	ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, ifd, 0);
+	prot = PROT_READ;
+	if ((os_flags & OS_O_MASK) != OS_O_RDONLY)
+		prot |= PROT_WRITE;
+	ptr = mmap(0, size, prot, MAP_SHARED, ifd, 0);
+	os_close(ifd);
 	if (ptr == MAP_FAILED) {
 		printf("Can't map file '%s': %s\n", pathname, strerror(errno));
 		return -EPERM;
@@ -416,6 +421,56 @@ void os_usleep(unsigned long usec)
 	usleep(usec);
 }
 
+struct os_thread {
+	pthread_t tid;
+	void (*func)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_func(void *data)
+{
+	struct os_thread *thread = data;
+
+	thread->func(thread->arg);
+
+	return NULL;
+}
+
+void *os_thread_create(void (*func)(void *arg), void *arg)
+{
+	struct os_thread *thread;
+
+	thread = os_malloc(sizeof(*thread));
+	if (!thread)
+		return NULL;
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&thread->tid, NULL, os_thread_func, thread)) {
+		os_free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+int os_thread_join(void *thread)
+{
+	struct os_thread *t = thread;
+	int ret;
+
+	ret = pthread_join(t->tid, NULL);
+	os_free(t);
+
+	return ret ? -1 : 0;
+}
+
+bool os_thread_is_self(void *thread)
+{
+	struct os_thread *t = thread;
+
+	return pthread_equal(t->tid, pthread_self());
+}
+
 uint64_t __attribute__((no_instrument_function)) os_get_nsec(void)
 {
 #if defined(CLOCK_MONOTONIC) && defined(_POSIX_MONOTONIC_CLOCK)
@@ -9,6 +9,7 @@
 #include <bootstage.h>
 #include <cli.h>
 #include <cpu_func.h>
+#include <cpu_job.h>
 #include <env.h>
 #include <errno.h>
 #include <fdt_support.h>
@@ -340,15 +341,40 @@ int bootm_find_images(int flag, int argc, char *const argv[], ulong start,
 	return 0;
 }
 
+/**
+ * struct bootm_decomp - decompression of the OS on a secondary core
+ *
+ * @job:	job doing the decompression
+ * @os:		OS image being decompressed
+ * @load_end:	returns the end of the decompressed data
+ * @queued:	true if @job was queued and not waited for yet
+ */
+struct bootm_decomp {
+	struct cpu_job job;
+	image_info_t os;
+	ulong load_end;
+	bool queued;
+};
+
+static struct bootm_decomp os_decomp;
+
 static int bootm_find_other(struct cmd_tbl *cmdtp, int flag, int argc,
 			    char *const argv[])
 {
+	ulong start = 0, size = 0;
+
+	/* The OS is being written while the others are loaded */
+	if (os_decomp.queued) {
+		start = images.os.load;
+		size = CONFIG_SYS_BOOTM_LEN;
+	}
+
 	if (((images.os.type == IH_TYPE_KERNEL) ||
 	     (images.os.type == IH_TYPE_KERNEL_NOLOAD) ||
 	     (images.os.type == IH_TYPE_MULTI)) &&
 	    (images.os.os == IH_OS_LINUX ||
 		 images.os.os == IH_OS_VXWORKS))
-		return bootm_find_images(flag, argc, argv, 0, 0);
+		return bootm_find_images(flag, argc, argv, start, size);
 
 	return 0;
 }
@@ -397,6 +423,148 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 #endif
 
 #ifndef USE_HOSTCC
+static int bootm_decomp_job(void *arg)
+{
+	struct bootm_decomp *dec = arg;
+	image_info_t *os = &dec->os;
+
+	return image_decomp_data(os->comp, os->load, os->image_start,
+				 map_sysmem(os->load, 0),
+				 map_sysmem(os->image_start, os->image_len),
+				 os->image_len, CONFIG_SYS_BOOTM_LEN,
+				 &dec->load_end);
+}
+
+/* Get the end of a FIT, including the external data of its images */
+static ulong bootm_fit_end(const void *fit)
+{
+	ulong base = map_to_sysmem(fit);
+	ulong data = base + ALIGN(fdt_totalsize(fit), 4);
+	ulong end = base + fdt_totalsize(fit);
+	int images, node, offset, size;
+
+	if (!CONFIG_IS_ENABLED(FIT))
+		return end;
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0)
+		return end;
+	fdt_for_each_subnode(node, fit, images) {
+		if (fit_image_get_data_size(fit, node, &size))
+			continue;
+		if (!fit_image_get_data_position(fit, node, &offset))
+			end = max(end, base + offset + size);
+		else if (!fit_image_get_data_offset(fit, node, &offset))
+			end = max(end, data + offset + size);
+	}
+
+	return end;
+}
+
+/**
+ * bootm_arg_overlaps() - check if an image passed to bootm may be in a region
+ *
+ * Images given as ":name" or "#config" are in the OS FIT and are not checked
+ * here.
+ *
+ * @arg:	ramdisk or FDT argument to bootm, or NULL if none
+ * @start:	start of the region
+ * @end:	end of the region
+ * Return: true if the image may be in the region, including when its size is
+ * not known
+ */
+static bool bootm_arg_overlaps(const char *arg, ulong start, ulong end)
+{
+	const void *buf;
+	ulong addr, size;
+	const char *sep;
+
+	if (!arg || !strcmp(arg, "-") || *arg == ':' || *arg == '#')
+		return false;
+	addr = hextoul(arg, (char **)&sep);
+	buf = map_sysmem(addr, 0);
+	switch (genimg_get_format(buf)) {
+	case IMAGE_FORMAT_LEGACY:
+		size = image_get_image_size(buf);
+		break;
+	case IMAGE_FORMAT_FIT:
+		size = bootm_fit_end(buf) - addr;
+		break;
+	default:
+		/* A raw ramdisk is passed as address:size */
+		if (*sep != ':')
+			return true;
+		size = hextoul(sep + 1, NULL);
+		break;
+	}
+	unmap_sysmem(buf);
+
+	return addr < end && addr + size > start;
+}
+
+/**
+ * bootm_load_os_start() - start decompressing the OS on another core
+ *
+ * This lets the ramdisk and FDT be found and verified while the OS is
+ * decompressed. It is not done if the OS may overwrite an image which is
+ * read meanwhile: the image it comes from, which may hold the others too, or
+ * a ramdisk or FDT passed to bootm. Images copied to a load address in the
+ * OS load area are refused later, by bootm_find_other().
+ *
+ * @images:	images being booted
+ * @argc:	number of arguments to bootm, from the OS image
+ * @argv:	arguments to bootm, from the OS image
+ */
+static void bootm_load_os_start(bootm_headers_t *images, int argc,
+				char *const argv[])
+{
+	image_info_t *os = &images->os;
+	ulong start = os->load;
+	ulong end = os->load + CONFIG_SYS_BOOTM_LEN;
+	ulong os_end = os->end;
+
+	if (!CONFIG_IS_ENABLED(CPU_JOB))
+		return;
+	if (images->fit_hdr_os)
+		os_end = bootm_fit_end(images->fit_hdr_os);
+	os_end = max(os_end, os->image_start + os->image_len);
+	if (os->load == os->image_start ||
+	    (start < os_end && end > os->start))
+		return;
+	if (bootm_arg_overlaps(argc > 1 ? argv[1] : NULL, start, end) ||
+	    bootm_arg_overlaps(argc > 2 ? argv[2] : NULL, start, end))
+		return;
+
+	image_decomp_msg(os->comp, os->type, false);
+	os_decomp.os = *os;
+	cpu_job_queue(&os_decomp.job, bootm_decomp_job, &os_decomp);
+	os_decomp.queued = true;
+}
+
+/**
+ * bootm_load_os_wait() - wait for the OS started by bootm_load_os_start()
+ *
+ * @load_end:	returns the end of the decompressed data
+ * Return: result of the decompression, or -EBUSY if a secondary core did
+ * not stop
+ */
+static int bootm_load_os_wait(ulong *load_end)
+{
+	int err, ret;
+
+	os_decomp.queued = false;
+	err = cpu_job_wait(&os_decomp.job);
+	*load_end = os_decomp.load_end;
+	/* The OS cannot be started while a core is still in U-Boot */
+	ret = cpu_job_stop();
+	if (ret)
+		return ret;
+	if (err == -ENOSYS)
+		printf("Unimplemented compression type %d\n",
+		       os_decomp.os.comp);
+
+	return err;
+}
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -411,11 +579,15 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	void *load_buf, *image_buf;
 	int err;
 
-	load_buf = map_sysmem(load, 0);
-	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	if (os_decomp.queued) {
+		err = bootm_load_os_wait(&load_end);
+	} else {
+		load_buf = map_sysmem(load, 0);
+		image_buf = map_sysmem(os.image_start, image_len);
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load,
 					  CONFIG_SYS_BOOTM_LEN, err);
@@ -710,8 +882,16 @@ int do_bootm_states(struct cmd_tbl *cmdtp, int flag, int argc,
 	if (!ret && (states & BOOTM_STATE_FINDOS))
 		ret = bootm_find_os(cmdtp, flag, argc, argv);
 
-	if (!ret && (states & BOOTM_STATE_FINDOTHER))
+	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
+		if (states & BOOTM_STATE_LOADOS)
+			bootm_load_os_start(images, argc, argv);
 		ret = bootm_find_other(cmdtp, flag, argc, argv);
+		if (ret && os_decomp.queued) {
+			ulong load_end;
+
+			bootm_load_os_wait(&load_end);
+		}
+	}
 
 	/* Load the OS */
 	if (!ret && (states & BOOTM_STATE_LOADOS)) {
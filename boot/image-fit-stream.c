@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hashing of FIT images while they are loaded
+ *
+ * Verifying a FIT normally means loading it and then reading every image
+ * again to hash it. Loaders which know where the images of a FIT sit (SPL)
+ * or can find out from the FIT header as it arrives (tftp, wget, load)
+ * instead feed the data to progressive hash contexts in small pieces, while
+ * it is still in the cache. The resulting digests are recorded against the
+ * address and size of the image data, where fit_image_check_hash() picks
+ * them up and only has to compare them with the values in the FIT.
+ *
+ * Only images with external data (mkimage -E) are hashed this way. Embedded
+ * data is part of the FIT header, which is only complete at the very end of
+ * such a file.
+ *
+ * A digest belongs to the load which produced it. Starting another load, or
+ * running any command which may write to memory, drops all digests, so that
+ * data changed after loading is hashed again. Images covered by a required
+ * signature never use them, see fit_image_verify_with_data().
+ */
+
+#define LOG_CATEGORY LOGC_BOOT
+
+#include <common.h>
+#include <hash.h>
+#include <image.h>
+#include <log.h>
+#include <mapmem.h>
+#include <watchdog.h>
+#include <linux/libfdt.h>
+
+/* Number of digests kept, enough for the images of one or two FITs */
+#define FIT_STREAM_MAX_DIGESTS	16
+/* Number of images of a FIT hashed while it is loaded */
+#define FIT_STREAM_MAX_IMAGES	8
+
+/**
+ * struct fit_stream_digest - digest of image data computed while loading
+ *
+ * @data:	image data, NULL if the entry is free
+ * @size:	size of the image data
+ * @seq:	load which produced the digest, see @digest_seq
+ * @algo:	hash algorithm
+ * @len:	length of @value
+ * @value:	digest
+ */
+struct fit_stream_digest {
+	const void *data;
+	size_t size;
+	uint seq;
+	struct hash_algo *algo;
+	int len;
+	u8 value[FIT_MAX_HASH_LEN];
+};
+
+enum fit_stream_state {
+	FIT_STREAM_IDLE,	/* not loading, or not a FIT */
+	FIT_STREAM_HEADER,	/* waiting for the whole FIT header */
+	FIT_STREAM_IMAGES,	/* hashing the external data */
+};
+
+/**
+ * struct fit_stream_load - a file being loaded which may be a FIT
+ *
+ * @state:	current state
+ * @addr:	load address of the file
+ * @pos:	number of bytes loaded so far
+ * @count:	number of entries in @image
+ * @image:	images being hashed, with the offset of their data in the file
+ */
+struct fit_stream_load {
+	enum fit_stream_state state;
+	ulong addr;
+	ulong pos;
+	int count;
+	struct {
+		ulong start;
+		struct fit_hash_stream st;
+	} image[FIT_STREAM_MAX_IMAGES];
+};
+
+static struct fit_stream_digest digests[FIT_STREAM_MAX_DIGESTS];
+static int next_digest;
+/* Current load; digests from earlier loads are not used */
+static uint digest_seq;
+static struct fit_stream_load load;
+
+static void fit_hash_stream_free(struct fit_hash_stream *st)
+{
+	u8 value[FIT_MAX_HASH_LEN];
+	int i;
+
+	/* There is no call to drop a context, so finish and forget it */
+	for (i = 0; i < st->count; i++)
+		st->hash[i].algo->hash_finish(st->hash[i].algo, st->hash[i].ctx,
+					      value, sizeof(value));
+	st->count = 0;
+}
+
+int fit_hash_stream_init(struct fit_hash_stream *st, const void *fit,
+			 int image_noffset, const void *data, size_t size)
+{
+	struct hash_algo *algo;
+	const char *name;
+	int noffset;
+
+	st->data = data;
+	st->size = size;
+	st->done = 0;
+	st->count = 0;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		name = fit_get_name(fit, noffset, NULL);
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &name) ||
+		    hash_progressive_lookup_algo(name, &algo))
+			continue;
+		if (st->count == FIT_STREAM_MAX_HASHES)
+			break;
+		if (algo->hash_init(algo, &st->hash[st->count].ctx)) {
+			fit_hash_stream_free(st);
+			return -ENOMEM;
+		}
+		st->hash[st->count++].algo = algo;
+	}
+
+	return 0;
+}
+
+void fit_hash_stream_update(struct fit_hash_stream *st, const void *buf,
+			    size_t len)
+{
+	size_t chunk;
+	int i;
+
+	if (!st->count)
+		return;
+
+	len = min(len, st->size - st->done);
+	st->done += len;
+	while (len) {
+		chunk = min_t(size_t, len, CHUNKSZ);
+		for (i = 0; i < st->count; i++)
+			st->hash[i].algo->hash_update(st->hash[i].algo,
+						      st->hash[i].ctx, buf,
+						      chunk, 0);
+		WATCHDOG_RESET();
+		buf += chunk;
+		len -= chunk;
+	}
+}
+
+void fit_hash_stream_finish(struct fit_hash_stream *st)
+{
+	struct fit_stream_digest *dig;
+	struct hash_algo *algo;
+	int i;
+
+	if (st->done != st->size) {
+		log_debug("dropping partial image at %p\n", st->data);
+		fit_hash_stream_free(st);
+		return;
+	}
+
+	for (i = 0; i < st->count; i++) {
+		algo = st->hash[i].algo;
+		dig = &digests[next_digest];
+		next_digest = (next_digest + 1) % FIT_STREAM_MAX_DIGESTS;
+
+		dig->data = NULL;
+		if (algo->hash_finish(algo, st->hash[i].ctx, dig->value,
+				      sizeof(dig->value)))
+			continue;
+		dig->data = st->data;
+		dig->size = st->size;
+		dig->seq = digest_seq;
+		dig->algo = algo;
+		dig->len = algo->digest_size;
+		log_debug("%s digest for %p, size %zx\n", algo->name, st->data,
+			  st->size);
+	}
+	st->count = 0;
+}
+
+bool fit_stream_get_digest(const void *data, size_t size, const char *algo,
+			   uint8_t *value, int *value_len)
+{
+	struct fit_stream_digest *dig;
+	int i;
+
+	for (i = 0; i < FIT_STREAM_MAX_DIGESTS; i++) {
+		dig = &digests[i];
+		if (dig->data != data || dig->size != size ||
+		    dig->seq != digest_seq || strcmp(dig->algo->name, algo))
+			continue;
+		memcpy(value, dig->value, dig->len);
+		*value_len = dig->len;
+		dig->data = NULL;
+
+		return true;
+	}
+
+	return false;
+}
+
+void fit_stream_drop(void)
+{
+	digest_seq++;
+}
+
+void fit_stream_check_cmd(const char *name)
+{
+	/* Commands which do not write to memory, up to and including bootm */
+	static const char *const keep[] = {
+		"bootm", "echo", "printenv", "run", "setenv", "test",
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(keep); i++) {
+		if (!strcmp(name, keep[i]))
+			return;
+	}
+	fit_stream_drop();
+}
+
+/**
+ * fit_stream_parse() - set up hashing of the images of a FIT
+ *
+ * @fit:	FIT header, complete
+ * Return: 0 if OK, -ENOENT if this is not a FIT
+ */
+static int fit_stream_parse(const void *fit)
+{
+	ulong hdr_size = ALIGN(fdt_totalsize(fit), 4);
+	int images, noffset, start, size;
+	void *data;
+
+	if (fdt_check_header(fit))
+		return -ENOENT;
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0)
+		return -ENOENT;
+
+	load.count = 0;
+	fdt_for_each_subnode(noffset, fit, images) {
+		if (!fit_image_get_data_position(fit, noffset, &start)) {
+			if (start < hdr_size)
+				continue;
+		} else if (!fit_image_get_data_offset(fit, noffset, &start)) {
+			start += hdr_size;
+		} else {
+			continue;
+		}
+		if (fit_image_get_data_size(fit, noffset, &size) || size < 0)
+			continue;
+		if (load.count == FIT_STREAM_MAX_IMAGES)
+			break;
+
+		data = map_sysmem(load.addr + start, size);
+		load.image[load.count].start = start;
+		if (fit_hash_stream_init(&load.image[load.count].st, fit,
+					 noffset, data, size))
+			break;
+		if (load.image[load.count].st.count)
+			load.count++;
+	}
+
+	return 0;
+}
+
+void fit_stream_load_start(ulong addr)
+{
+	fit_stream_load_end();
+	fit_stream_drop();
+	load.state = FIT_STREAM_HEADER;
+	load.addr = addr;
+	load.pos = 0;
+}
+
+void fit_stream_load_data(ulong offset, ulong len)
+{
+	struct fit_hash_stream *st;
+	ulong from, to, end;
+	const void *buf;
+	int i, ret, pending;
+
+	if (load.state == FIT_STREAM_IDLE)
+		return;
+	if (offset != load.pos) {
+		log_debug("out-of-order data at %lx, expected %lx\n", offset,
+			  load.pos);
+		fit_stream_load_end();
+		return;
+	}
+	load.pos += len;
+
+	if (load.state == FIT_STREAM_HEADER) {
+		if (load.pos < sizeof(struct fdt_header))
+			return;
+		buf = map_sysmem(load.addr, load.pos);
+		if (fdt_magic(buf) != FDT_MAGIC) {
+			load.state = FIT_STREAM_IDLE;
+			unmap_sysmem(buf);
+			return;
+		}
+		if (load.pos < fdt_totalsize(buf)) {
+			unmap_sysmem(buf);
+			return;
+		}
+		ret = fit_stream_parse(buf);
+		unmap_sysmem(buf);
+		if (ret) {
+			load.state = FIT_STREAM_IDLE;
+			return;
+		}
+		load.state = FIT_STREAM_IMAGES;
+	}
+
+	/*
+	 * Image data always follows the header, so anything loaded before
+	 * this call is either header or already hashed
+	 */
+	pending = 0;
+	for (i = 0; i < load.count; i++) {
+		st = &load.image[i].st;
+		if (!st->count)
+			continue;
+		pending++;
+		from = max_t(ulong, offset, load.image[i].start + st->done);
+		end = load.image[i].start + st->size;
+		to = min(load.pos, end);
+		if (from >= to)
+			continue;
+		buf = map_sysmem(load.addr + from, to - from);
+		fit_hash_stream_update(st, buf, to - from);
+		unmap_sysmem(buf);
+		if (to == end) {
+			fit_hash_stream_finish(st);
+			pending--;
+		}
+	}
+
+	/* Nothing left to hash, so the loader can stop splitting the file */
+	if (!pending)
+		fit_stream_load_end();
+}
+
+bool fit_stream_load_active(void)
+{
+	return load.state != FIT_STREAM_IDLE;
+}
+
+ulong fit_stream_load_want(void)
+{
+	const void *buf;
+	ulong want;
+
+	if (load.state != FIT_STREAM_HEADER)
+		return FIT_STREAM_CHUNK;
+	if (load.pos < sizeof(struct fdt_header))
+		return sizeof(struct fdt_header) - load.pos;
+
+	/* Ask for the rest of the header in one piece */
+	buf = map_sysmem(load.addr, load.pos);
+	want = fdt_totalsize(buf) - load.pos;
+	unmap_sysmem(buf);
+
+	return want;
+}
+
+void fit_stream_load_end(void)
+{
+	int i;
+
+	for (i = 0; i < load.count; i++)
+		fit_hash_stream_finish(&load.image[i].st);
+	load.count = 0;
+	load.state = FIT_STREAM_IDLE;
+}
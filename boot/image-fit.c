@@ -1261,7 +1261,7 @@ int calculate_hash(const void *data, int data_len, const char *name,
 }
 
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, bool use_stream, char **err_msgp)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
 	int value_len;
@@ -1292,7 +1292,9 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (!(use_stream &&
+	      fit_stream_get_digest(data, size, algo, value, &value_len)) &&
+	    calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1308,6 +1310,30 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
+/**
+ * fit_has_required_keys() - check for keys which must verify a signature
+ *
+ * @key_blob: FDT containing the public keys, or NULL
+ * Return: true if any key is marked as required, for images or for
+ * configurations
+ */
+static bool fit_has_required_keys(const void *key_blob)
+{
+	int key_node, noffset;
+
+	if (!key_blob)
+		return false;
+	key_node = fdt_subnode_offset(key_blob, 0, FIT_SIG_NODENAME);
+	if (key_node < 0)
+		return false;
+	fdt_for_each_subnode(noffset, key_blob, key_node) {
+		if (fdt_getprop(key_blob, noffset, FIT_KEY_REQUIRED, NULL))
+			return true;
+	}
+
+	return false;
+}
+
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *key_blob, const void *data,
 			       size_t size)
@@ -1315,8 +1341,16 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
+	bool use_stream;
 	int ret;
 
+	/*
+	 * Digests computed while loading are not used for images covered by a
+	 * required signature: the data is always hashed again
+	 */
+	use_stream = !(FIT_IMAGE_ENABLE_VERIFY &&
+		       fit_has_required_keys(key_blob));
+
 	/* Verify all required signatures */
 	if (FIT_IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1337,7 +1371,7 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			if (fit_image_check_hash(fit, noffset, data, size,
-						 &err_msg))
+						 use_stream, &err_msg))
 				goto error;
 			puts("+ ");
 		} else if (FIT_IMAGE_ENABLE_VERIFY && verify_all &&
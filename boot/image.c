@@ -398,14 +398,7 @@ void image_print_contents(const void *ptr)
 	}
 }
 
-/**
- * print_decomp_msg() - Print a suitable decompression/loading message
- *
- * @type:	OS type (IH_OS_...)
- * @comp_type:	Compression type being used (IH_COMP_...)
- * @is_xip:	true if the load address matches the image start
- */
-static void print_decomp_msg(int comp_type, int type, bool is_xip)
+void image_decomp_msg(int comp_type, int type, bool is_xip)
 {
 	const char *name = genimg_get_type_name(type);
 
@@ -430,14 +423,13 @@ int image_decomp_type(const unsigned char *buf, ulong len)
 	return cmagic->comp_id;
 }
 
-int image_decomp(int comp, ulong load, ulong image_start, int type,
-		 void *load_buf, void *image_buf, ulong image_len,
-		 uint unc_len, ulong *load_end)
+int image_decomp_data(int comp, ulong load, ulong image_start,
+		      void *load_buf, void *image_buf, ulong image_len,
+		      uint unc_len, ulong *load_end)
 {
 	int ret = -ENOSYS;
 
 	*load_end = load;
-	print_decomp_msg(comp, type, load == image_start);
 
 	/*
 	 * Load the image to the right place, decompressing if needed. After
@@ -511,10 +503,6 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		}
 		break;
 	}
-	if (ret == -ENOSYS) {
-		printf("Unimplemented compression type %d\n", comp);
-		return ret;
-	}
 	if (ret)
 		return ret;
 
@@ -523,6 +511,21 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return 0;
 }
 
+int image_decomp(int comp, ulong load, ulong image_start, int type,
+		 void *load_buf, void *image_buf, ulong image_len,
+		 uint unc_len, ulong *load_end)
+{
+	int ret;
+
+	image_decomp_msg(comp, type, load == image_start);
+	ret = image_decomp_data(comp, load, image_start, load_buf, image_buf,
+				image_len, unc_len, load_end);
+	if (ret == -ENOSYS)
+		printf("Unimplemented compression type %d\n", comp);
+
+	return ret;
+}
+
 const table_entry_t *get_table_entry(const table_entry_t *table, int id)
 {
 	for (; table->id >= 0; ++table) {
@@ -7,6 +7,7 @@
 #include <command.h>
 #include <config.h>
 #include <common.h>
+#include <dm.h>
 #include <malloc.h>
 #include <part.h>
 
@@ -18,11 +19,15 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "ways: %u\n"
+	       "slot size: %u\n",
+	       stats.hits, stats.misses, stats.evictions, stats.entries,
+	       stats.max_blocks_per_entry, stats.max_entries,
+	       stats.ways, stats.slot_size);
 	return 0;
 }
 
@@ -41,9 +46,40 @@ static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+static int blkc_readahead(struct cmd_tbl *cmdtp, int flag,
+			  int argc, char *const argv[])
+{
+	struct blk_readahead_stats stats;
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret;
+
+	ret = uclass_get(UCLASS_BLK, &uc);
+	if (ret)
+		return CMD_RET_FAILURE;
+
+	printf("%-20s %10s %10s %10s %12s\n", "Device", "reads", "merged",
+	       "issued", "blocks");
+	uclass_foreach_dev(dev, uc) {
+		if (!device_active(dev))
+			continue;
+		blk_get_readahead_stats(dev, &stats);
+		printf("%-20s %10lu %10lu %10lu %12" LBAFlength "u\n",
+		       dev->name, stats.reads, stats.merged, stats.issued,
+		       stats.blocks);
+	}
+
+	return 0;
+}
+#endif
+
 static struct cmd_tbl cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	U_BOOT_CMD_MKENT(readahead, 0, 0, blkc_readahead, "", ""),
+#endif
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -84,5 +120,8 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"- set max blocks per request and number of cache slots\n"
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	"blkcache readahead - show and reset readahead statistics\n"
+#endif
 );
@@ -46,6 +46,18 @@ static int do_dm_dump_mem(struct cmd_tbl *cmdtp, int flag, int argc,
 
 	return 0;
 }
+
+static int do_dm_dump_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	int dev_count, uc_count;
+
+	dm_get_stats(&dev_count, &uc_count);
+	printf("Devices: %d, uclasses: %d\n", dev_count, uc_count);
+	dm_dump_lookups();
+
+	return 0;
+}
 #endif /* DM_STATS */
 
 static int do_dm_dump_static_driver_info(struct cmd_tbl *cmdtp, int flag,
@@ -75,9 +87,13 @@ static int do_dm_dump_uclass(struct cmd_tbl *cmdtp, int flag, int argc,
 #if CONFIG_IS_ENABLED(DM_STATS)
 #define DM_MEM_HELP	"dm mem           Provide a summary of memory usage\n"
 #define DM_MEM		U_BOOT_SUBCMD_MKENT(mem, 1, 1, do_dm_dump_mem),
+#define DM_STATS_HELP	"dm stats         Show how many uclass lookups were made\n"
+#define DM_STATS_CMD	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_dm_dump_stats),
 #else
 #define DM_MEM_HELP
 #define DM_MEM
+#define DM_STATS_HELP
+#define DM_STATS_CMD
 #endif
 
 #if CONFIG_IS_ENABLED(SYS_LONGHELP)
@@ -87,6 +103,7 @@ static char dm_help_text[] =
 	"dm drivers       Dump list of drivers with uclass and instances\n"
 	DM_MEM_HELP
 	"dm static        Dump list of drivers with static platform data\n"
+	DM_STATS_HELP
 	"dm tree          Dump tree of driver model devices ('*' = activated)\n"
 	"dm uclass        Dump list of instances for each uclass"
 	;
@@ -98,5 +115,6 @@ U_BOOT_CMD_WITH_SUBCMDS(dm, "Driver model low level access", dm_help_text,
 	U_BOOT_SUBCMD_MKENT(drivers, 1, 1, do_dm_dump_drivers),
 	DM_MEM
 	U_BOOT_SUBCMD_MKENT(static, 1, 1, do_dm_dump_static_driver_info),
+	DM_STATS_CMD
 	U_BOOT_SUBCMD_MKENT(tree, 1, 1, do_dm_dump_tree),
 	U_BOOT_SUBCMD_MKENT(uclass, 1, 1, do_dm_dump_uclass));
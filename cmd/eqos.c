@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Synopsys DWC Ethernet QOS controller statistics
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dm.h>
+#include <net/dwc_eth_qos.h>
+
+static int do_eqos(struct cmd_tbl *cmdtp, int flag, int argc,
+		   char *const argv[])
+{
+	struct eqos_stats stats;
+	struct eqos_rings rings;
+	struct udevice *dev;
+	struct uclass *uc;
+	bool clear;
+	int found = 0;
+
+	if (argc < 2 || argc > 3)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "stats"))
+		clear = false;
+	else if (!strcmp(argv[1], "clear"))
+		clear = true;
+	else
+		return CMD_RET_USAGE;
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		if (argc == 3 && strcmp(argv[2], dev->name))
+			continue;
+		if (eqos_get_stats(dev, &rings, &stats, clear))
+			continue;
+		found++;
+		if (clear)
+			continue;
+
+		printf("%s: rx ring %u, tx ring %u, refill batch %u\n",
+		       dev->name, rings.rx_descs, rings.tx_descs,
+		       rings.rx_refill_batch);
+		printf("    rx packets:   %lu\n", stats.rx_packets);
+		printf("    rx missed:    %lu\n", stats.rx_missed);
+		printf("    rx overflows: %lu\n", stats.rx_overflows);
+		printf("    rx refills:   %lu (%lu descriptors)\n",
+		       stats.rx_refills, stats.rx_refilled);
+		printf("    tx packets:   %lu\n", stats.tx_packets);
+		printf("    tx stalls:    %lu\n", stats.tx_stalls);
+	}
+
+	if (!found) {
+		printf("No active eqos device%s%s\n", argc == 3 ? " " : "",
+		       argc == 3 ? argv[2] : "");
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	eqos, 3, 0, do_eqos,
+	"Synopsys DWC Ethernet QOS controller statistics",
+	"stats [<dev>] - show DMA ring statistics\n"
+	"eqos clear [<dev>] - reset DMA ring statistics"
+);
@@ -10,6 +10,7 @@
 #include <command.h>
 #include <fs.h>
 #include <erofs.h>
+#include <linux/string.h>
 
 static int do_erofs_ls(struct cmd_tbl *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -40,3 +41,28 @@ U_BOOT_CMD(erofsload, 7, 0, do_erofs_load,
 	   "      ARCH_DMA_MINALIGN then a misaligned buffer warning will\n"
 	   "      be printed and performance will suffer for the load."
 );
+
+static int do_erofs_stat(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset"))
+			return CMD_RET_USAGE;
+		erofs_reset_stats();
+		return 0;
+	}
+	erofs_show_stats();
+
+	return 0;
+}
+
+U_BOOT_CMD(erofsstat, 2, 0, do_erofs_stat,
+	   "show EROFS read statistics",
+	   "\n"
+	   "    - show the counters of the decompressed pcluster cache\n"
+	   "erofsstat reset\n"
+	   "    - clear the counters"
+);
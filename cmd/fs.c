@@ -38,7 +38,10 @@ U_BOOT_CMD(
 	"      'bytes' gives the size to load in bytes.\n"
 	"      If 'bytes' is 0 or omitted, the file is read until the end.\n"
 	"      'pos' gives the file byte position to start reading from.\n"
-	"      If 'pos' is 0 or omitted, the file is read from the start."
+	"      If 'pos' is 0 or omitted, the file is read from the start.\n"
+	"      If 'addr' is '-', the file is used where it is when the device\n"
+	"      holds it in memory, else it is read to $loadaddr. $fileaddr\n"
+	"      gives its address."
 )
 
 static int do_save_wrapper(struct cmd_tbl *cmdtp, int flag, int argc,
@@ -111,3 +114,14 @@ U_BOOT_CMD(
 	fstypes, 1, 1, do_fstypes_wrapper,
 	"List supported filesystem types", ""
 );
+
+#if CONFIG_IS_ENABLED(FS_CACHE)
+static char fs_help_text[] =
+	"cache\n"
+	"- show the file lookup cache\n"
+	"fs cache clear\n"
+	"- empty the file lookup cache and reset its statistics";
+
+U_BOOT_CMD_WITH_SUBCMDS(fs, "Filesystem layer", fs_help_text,
+	U_BOOT_SUBCMD_MKENT(cache, 2, 1, do_fs_cache));
+#endif
@@ -12,6 +12,8 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <image.h>
+#include <linux/sizes.h>
 #include <linux/ctype.h>
 
 static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
@@ -20,6 +22,19 @@ static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+#ifdef CONFIG_HASH_BENCH
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		ulong addr = argc > 2 ? hextoul(argv[2], NULL) :
+			image_load_addr;
+		ulong len = argc > 3 ? hextoul(argv[3], NULL) : SZ_1M;
+
+		if (!len)
+			return CMD_RET_USAGE;
+		hash_bench(addr, len);
+
+		return 0;
+	}
+#endif
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -53,4 +68,9 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#ifdef CONFIG_HASH_BENCH
+	"\nhash bench [address [count]]\n"
+		"    - show the throughput of each algorithm, hashing count\n"
+		"      bytes (default 1MiB) at address (default loadaddr)"
+#endif
 );
@@ -9,6 +9,7 @@
 #include <command.h>
 #include <console.h>
 #include <display_options.h>
+#include <fs.h>
 #include <memalign.h>
 #include <mmc.h>
 #include <part.h>
@@ -156,6 +157,10 @@ static struct mmc *__init_mmc_device(int dev, bool force_init,
 	struct blk_desc *bd = mmc_get_blk_desc(mmc);
 	blkcache_invalidate(bd->if_type, bd->devnum);
 #endif
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	blk_readahead_invalidate(mmc_get_blk_desc(mmc)->bdev);
+#endif
+	fs_invalidate(mmc_get_blk_desc(mmc));
 
 	return mmc;
 }
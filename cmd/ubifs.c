@@ -144,6 +144,23 @@ static int do_ubifs_load(struct cmd_tbl *cmdtp, int flag, int argc,
 	return ret;
 }
 
+static int do_ubifs_stat(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset"))
+			return CMD_RET_USAGE;
+		ubifs_reset_stats();
+		return 0;
+	}
+	ubifs_show_stats();
+
+	return 0;
+}
+
 U_BOOT_CMD(
 	ubifsmount, 2, 0, do_ubifs_mount,
 	"mount UBIFS volume",
@@ -170,3 +187,12 @@ U_BOOT_CMD(
 	"<addr> <filename> [bytes]\n"
 	"    - load file 'filename' to address 'addr'"
 );
+
+U_BOOT_CMD(
+	ubifsstat, 2, 0, do_ubifs_stat,
+	"show UBIFS read statistics",
+	"\n"
+	"    - show index, bulk-read and timing counters\n"
+	"ubifsstat reset\n"
+	"    - clear the counters"
+);
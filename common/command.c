@@ -13,6 +13,7 @@
 #include <command.h>
 #include <console.h>
 #include <env.h>
+#include <image.h>
 #include <log.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
@@ -626,6 +627,9 @@ enum command_ret_t cmd_process(int flag, int argc, char *const argv[],
 	}
 #endif
 
+	/* Digests of loaded FIT images do not survive most commands */
+	fit_stream_check_cmd(cmdtp->name);
+
 	/* If OK so far, then do the command */
 	if (!rc) {
 		int newrep;
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running jobs on secondary cores
+ *
+ * Each worker has a ring of jobs. Only the boot core adds to it (moving
+ * @head) and only the worker takes from it (moving @tail), so no atomic
+ * read-modify-write is needed for the ring itself.
+ */
+
+#define LOG_CATEGORY LOGC_BOOT
+
+#include <common.h>
+#include <cpu_job.h>
+#include <log.h>
+#include <malloc.h>
+#include <time.h>
+#include <watchdog.h>
+#include <linux/delay.h>
+
+/* Number of jobs queued on each worker, must be a power of two */
+#define CPU_JOB_RING	8
+
+/**
+ * struct cpu_job_worker - a secondary core running jobs
+ *
+ * @ring:	jobs to run
+ * @head:	number of jobs queued, written by the boot core
+ * @tail:	number of jobs completed, written by the worker
+ * @stack:	stack of the worker, kept for the next start
+ */
+struct cpu_job_worker {
+	struct cpu_job *ring[CPU_JOB_RING];
+	uint head;
+	uint tail;
+	void *stack;
+};
+
+static struct cpu_job_worker workers[CONFIG_CPU_JOB_WORKERS];
+/* Number of workers running, only changed by the boot core */
+static int num_workers;
+/* Set when the workers should stop once their ring is empty */
+static int stopping;
+/* Set once the workers were started, or failed to start */
+static bool started;
+
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static void cpu_job_start(void)
+{
+	struct cpu_job_worker *w;
+	int i, ret;
+
+	started = true;
+	for (i = 0; i < CONFIG_CPU_JOB_WORKERS; i++) {
+		w = &workers[i];
+		if (!w->stack) {
+			w->stack = memalign(16, CONFIG_CPU_JOB_STACK_SIZE);
+			if (!w->stack)
+				break;
+		}
+		w->head = 0;
+		w->tail = 0;
+
+		/* Count the worker first, since it may need the locks */
+		num_workers++;
+		ret = arch_cpu_job_start(i, w->stack + CONFIG_CPU_JOB_STACK_SIZE);
+		if (ret) {
+			num_workers--;
+			if (ret != -ENODEV)
+				log_warning("Cannot start worker %d (err=%d)\n",
+					    i, ret);
+			break;
+		}
+	}
+	log_debug("%d workers\n", num_workers);
+}
+
+void cpu_job_queue(struct cpu_job *job, int (*func)(void *arg), void *arg)
+{
+	struct cpu_job_worker *w = NULL;
+	uint pending, least = CPU_JOB_RING;
+	int i;
+
+	job->func = func;
+	job->arg = arg;
+	job->ret = 0;
+	job->state = CPU_JOB_QUEUED;
+
+	if (!started)
+		cpu_job_start();
+	for (i = 0; i < num_workers; i++) {
+		pending = workers[i].head - load_acquire(&workers[i].tail);
+		if (pending < least) {
+			w = &workers[i];
+			least = pending;
+		}
+	}
+	if (!w) {
+		job->ret = func(arg);
+		job->state = CPU_JOB_DONE;
+		return;
+	}
+
+	w->ring[w->head % CPU_JOB_RING] = job;
+	store_release(&w->head, w->head + 1);
+	arch_cpu_job_wake();
+}
+
+/*
+ * Take a job back from the ring of a worker which has not started it yet.
+ * The worker takes jobs with the same exchange, so only one side gets it.
+ */
+static bool cpu_job_unqueue(struct cpu_job *job)
+{
+	struct cpu_job_worker *w;
+	struct cpu_job **slot;
+	uint pos;
+	int i;
+
+	for (i = 0; i < num_workers; i++) {
+		w = &workers[i];
+		for (pos = load_acquire(&w->tail); pos != w->head; pos++) {
+			slot = &w->ring[pos % CPU_JOB_RING];
+			if (load_acquire(slot) == job)
+				return __atomic_exchange_n(slot, NULL,
+							   __ATOMIC_ACQ_REL) == job;
+		}
+	}
+
+	return false;
+}
+
+int cpu_job_wait_timeout(struct cpu_job *job, ulong timeout_ms)
+{
+	ulong start = get_timer(0);
+
+	/* Poll rather than idle, since nothing may wake us up in time */
+	while (load_acquire(&job->state) != CPU_JOB_DONE) {
+		WATCHDOG_RESET();
+		if (get_timer(start) >= timeout_ms) {
+			if (!cpu_job_unqueue(job))
+				return -ETIMEDOUT;
+			log_debug("Running job %p on the boot core\n", job);
+			job->ret = job->func(job->arg);
+			job->state = CPU_JOB_DONE;
+			break;
+		}
+		udelay(10);
+	}
+
+	return job->ret;
+}
+
+int cpu_job_wait(struct cpu_job *job)
+{
+	int ret;
+
+	ret = cpu_job_wait_timeout(job, CONFIG_CPU_JOB_TIMEOUT);
+	if (load_acquire(&job->state) == CPU_JOB_DONE)
+		return ret;
+
+	/* The worker still uses the job and its memory, so keep waiting */
+	log_warning("Job %p is taking a long time\n", job);
+	while (load_acquire(&job->state) != CPU_JOB_DONE) {
+		WATCHDOG_RESET();
+		udelay(10);
+	}
+
+	return job->ret;
+}
+
+int cpu_job_stop(void)
+{
+	int i, ret = 0;
+
+	if (num_workers) {
+		store_release(&stopping, 1);
+		arch_cpu_job_wake();
+		for (i = 0; i < num_workers; i++) {
+			if (arch_cpu_job_stop(i)) {
+				log_err("Worker %d did not stop\n", i);
+				ret = -EBUSY;
+			}
+		}
+		/* A worker which is still running needs the locks */
+		if (ret)
+			return ret;
+		num_workers = 0;
+		stopping = 0;
+	}
+	started = false;
+
+	return 0;
+}
+
+bool cpu_job_on_worker(void)
+{
+	return num_workers && arch_cpu_job_on_worker();
+}
+
+void cpu_job_lock(int *lock)
+{
+	if (!num_workers)
+		return;
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+		;
+}
+
+void cpu_job_unlock(int *lock)
+{
+	if (!num_workers)
+		return;
+	store_release(lock, 0);
+}
+
+void cpu_job_worker(int worker)
+{
+	struct cpu_job_worker *w = &workers[worker];
+	struct cpu_job *job;
+	uint tail = w->tail;
+
+	while (1) {
+		if (tail == load_acquire(&w->head)) {
+			if (load_acquire(&stopping))
+				break;
+			arch_cpu_job_idle();
+			continue;
+		}
+		/* The job is NULL if the boot core took it back */
+		job = __atomic_exchange_n(&w->ring[tail % CPU_JOB_RING], NULL,
+					  __ATOMIC_ACQ_REL);
+		if (job) {
+			job->ret = job->func(job->arg);
+			/* The owner may reuse the job as soon as it sees this */
+			store_release(&job->state, CPU_JOB_DONE);
+		}
+		store_release(&w->tail, ++tail);
+		arch_cpu_job_wake();
+	}
+}
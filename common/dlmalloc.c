@@ -16,10 +16,43 @@
 #define DEBUG
 #endif
 
+#include <cpu_job.h>
 #include <malloc.h>
 #include <asm/io.h>
 #include <valgrind/memcheck.h>
 
+#if CONFIG_IS_ENABLED(CPU_JOB)
+/*
+ * Jobs on secondary cores may allocate memory, so the public functions at
+ * the end of this file take malloc_lock and call these, which also call each
+ * other.
+ */
+#undef mALLOc
+#undef fREe
+#undef rEALLOc
+#undef mEMALIGn
+#undef vALLOc
+#undef pvALLOc
+#undef cALLOc
+#define mALLOc		malloc_unlocked
+#define fREe		free_unlocked
+#define rEALLOc		realloc_unlocked
+#define mEMALIGn	memalign_unlocked
+#define vALLOc		valloc_unlocked
+#define pvALLOc		pvalloc_unlocked
+#define cALLOc		calloc_unlocked
+
+static Void_t *mALLOc(size_t bytes);
+static void fREe(Void_t *mem);
+static Void_t *rEALLOc(Void_t *oldmem, size_t bytes);
+static Void_t *mEMALIGn(size_t alignment, size_t bytes);
+static Void_t *vALLOc(size_t bytes);
+static Void_t *pvALLOc(size_t bytes);
+static Void_t *cALLOc(size_t n, size_t elem_size);
+
+static int malloc_lock;
+#endif
+
 #ifdef DEBUG
 #if __STD_C
 static void malloc_update_mallinfo (void);
@@ -2459,6 +2492,81 @@ int mALLOPt(param_number, value) int param_number; int value;
   }
 }
 
+#if CONFIG_IS_ENABLED(CPU_JOB)
+void *malloc(size_t bytes)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = malloc_unlocked(bytes);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+
+void free(void *mem)
+{
+	cpu_job_lock(&malloc_lock);
+	free_unlocked(mem);
+	cpu_job_unlock(&malloc_lock);
+}
+
+void *realloc(void *oldmem, size_t bytes)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = realloc_unlocked(oldmem, bytes);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = memalign_unlocked(alignment, bytes);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+
+void *valloc(size_t bytes)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = valloc_unlocked(bytes);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+
+void *pvalloc(size_t bytes)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = pvalloc_unlocked(bytes);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+
+void *calloc(size_t n, size_t elem_size)
+{
+	void *mem;
+
+	cpu_job_lock(&malloc_lock);
+	mem = calloc_unlocked(n, elem_size);
+	cpu_job_unlock(&malloc_lock);
+
+	return mem;
+}
+#endif
+
 int initf_malloc(void)
 {
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
@@ -20,6 +20,7 @@
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
+#include <div64.h>
 #include <linux/errno.h>
 #include <u-boot/crc.h>
 #else
@@ -197,10 +198,14 @@ static int __maybe_unused hash_update_crc32(struct hash_algo *algo, void *ctx,
 static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 					    void *dest_buf, int size)
 {
+	uint32_t crc;
+
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Big-endian, like crc32_wd_buf() */
+	crc = cpu_to_be32(*((uint32_t *)ctx));
+	memcpy(dest_buf, &crc, sizeof(crc));
 	free(ctx);
 	return 0;
 }
@@ -644,5 +649,42 @@ int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 
 	return 0;
 }
+
+#if defined(CONFIG_HASH_BENCH)
+/* Time spent on each algorithm by hash_bench() */
+#define HASH_BENCH_MS	500
+
+void hash_bench(ulong addr, ulong len)
+{
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	ulong start, time, loops;
+	uint frac;
+	u64 rate;
+	void *buf;
+	int i;
+
+	reloc_update();
+	buf = map_sysmem(addr, len);
+	printf("Hashing %lu bytes at %08lx\n", len, addr);
+	for (i = 0; i < ARRAY_SIZE(hash_algo); i++) {
+		struct hash_algo *algo = &hash_algo[i];
+
+		loops = 0;
+		start = get_timer(0);
+		do {
+			algo->hash_func_ws(buf, len, output, algo->chunk_size);
+			loops++;
+			time = get_timer(start);
+		} while (time < HASH_BENCH_MS);
+
+		/* bytes per ms is kB/s; keep two decimals of MB/s */
+		rate = (u64)loops * len;
+		do_div(rate, time * 10);
+		frac = do_div(rate, 100);
+		printf("%-12s %6llu.%02u MB/s\n", algo->name, rate, frac);
+	}
+	unmap_sysmem(buf);
+}
+#endif
 #endif /* CONFIG_CMD_HASH || CONFIG_CMD_SHA1SUM || CONFIG_CMD_CRC32) */
 #endif /* !USE_HOSTCC */
@@ -218,6 +218,56 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/**
+ * spl_fit_read_data() - read the external data of an image
+ *
+ * With SPL_FIT_STREAM_VERIFY the data is read in pieces which are hashed
+ * while still in the cache, so that fit_image_verify_with_data() does not
+ * need to read it all again.
+ *
+ * @info:	points to information about the device to load from
+ * @sector:	first sector to read
+ * @nr_sectors:	number of sectors to read
+ * @buf:	buffer to read into
+ * @fit:	FIT header
+ * @node:	offset of the image node in @fit
+ * @overhead:	offset of the image data in @buf
+ * @length:	size of the image data
+ * Return:	0 on success, -EIO if the data could not be read
+ */
+static int spl_fit_read_data(struct spl_load_info *info, ulong sector,
+			     int nr_sectors, void *buf, const void *fit,
+			     int node, ulong overhead, size_t length)
+{
+	struct fit_hash_stream st;
+	int chunk, count, done;
+	size_t end;
+
+	if (!CONFIG_IS_ENABLED(FIT_STREAM_VERIFY))
+		return info->read(info, sector, nr_sectors, buf) == nr_sectors ?
+			0 : -EIO;
+
+	if (fit_hash_stream_init(&st, fit, node, buf + overhead, length))
+		return -EIO;
+	chunk = max(FIT_STREAM_CHUNK / info->bl_len, 1);
+	for (done = 0; done < nr_sectors; done += count) {
+		count = min(chunk, nr_sectors - done);
+		if (info->read(info, sector + done, count,
+			       buf + done * info->bl_len) != count) {
+			fit_hash_stream_finish(&st);
+			return -EIO;
+		}
+		end = min_t(size_t, (done + count) * info->bl_len - overhead,
+			    length);
+		if (end > st.done)
+			fit_hash_stream_update(&st, buf + overhead + st.done,
+					       end - st.done);
+	}
+	fit_hash_stream_finish(&st);
+
+	return 0;
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -299,9 +349,11 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
-		if (info->read(info,
-			       sector + get_aligned_image_offset(info, offset),
-			       nr_sectors, src_ptr) != nr_sectors)
+		if (spl_fit_read_data(info,
+				      sector + get_aligned_image_offset(info,
+									offset),
+				      nr_sectors, src_ptr, fit, node, overhead,
+				      length))
 			return -EIO;
 
 		debug("External data: dst=%p, offset=%x, size=%lx\n",
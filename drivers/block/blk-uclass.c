@@ -9,9 +9,11 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
+#include <asm/cache.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -436,6 +438,173 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+/**
+ * struct blk_readahead - readahead state of a block device
+ *
+ * This is uclass-private data for each block device. The window grows each
+ * time a read starts where the previous one ended, and collapses on any
+ * other access.
+ *
+ * @buf:	Buffer holding the blocks read ahead, allocated on first use
+ * @start:	First block held in @buf
+ * @count:	Number of valid blocks in @buf, 0 if empty
+ * @hwpart:	Hardware partition the blocks in @buf were read from
+ * @next:	Block following the end of the previous read request
+ * @window:	Current window size in blocks, 0 if access is not sequential
+ * @max_blocks:	Largest window allowed by the device, 0 for no limit
+ * @stats:	Statistics since the last blk_get_readahead_stats()
+ */
+struct blk_readahead {
+	void *buf;
+	lbaint_t start;
+	lbaint_t count;
+	int hwpart;
+	lbaint_t next;
+	lbaint_t window;
+	lbaint_t max_blocks;
+	struct blk_readahead_stats stats;
+};
+
+void blk_set_readahead_max(struct udevice *dev, lbaint_t blocks)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	ra->max_blocks = blocks;
+	ra->window = 0;
+}
+
+void blk_get_readahead_stats(struct udevice *dev,
+			     struct blk_readahead_stats *stats)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	*stats = ra->stats;
+	memset(&ra->stats, '\0', sizeof(ra->stats));
+}
+
+static lbaint_t blk_readahead_limit(struct blk_desc *desc,
+				    struct blk_readahead *ra)
+{
+	lbaint_t limit = CONFIG_BLOCK_READAHEAD_SIZE / desc->blksz;
+
+	if (ra->max_blocks && ra->max_blocks < limit)
+		limit = ra->max_blocks;
+
+	return limit;
+}
+
+void blk_readahead_invalidate(struct udevice *dev)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	ra->count = 0;
+	ra->window = 0;
+}
+
+/**
+ * blk_readahead_read() - read blocks, going through the readahead window
+ *
+ * Blocks already in the window are copied out. If the rest of the request
+ * follows on from the previous one and is smaller than the window, the
+ * whole window is read into the buffer and the request served from there;
+ * otherwise it goes straight to the device.
+ *
+ * @dev:	Block device to read from
+ * @desc:	Block descriptor of @dev
+ * @start:	First block to read
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer
+ * Return: number of blocks read, or -ve error number
+ */
+static ulong blk_readahead_read(struct udevice *dev, struct blk_desc *desc,
+				lbaint_t start, lbaint_t blkcnt, void *buffer)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+	lbaint_t done = 0, todo, count, limit;
+	bool sequential;
+	ulong n;
+
+	ra->stats.reads++;
+	if (ra->hwpart != desc->hwpart) {
+		ra->hwpart = desc->hwpart;
+		ra->count = 0;
+		ra->next = 0;
+	}
+	sequential = start == ra->next;
+	ra->next = start + blkcnt;
+
+	if (ra->count && start >= ra->start &&
+	    start < ra->start + ra->count) {
+		done = min(blkcnt, ra->start + ra->count - start);
+		memcpy(buffer, ra->buf + (start - ra->start) * desc->blksz,
+		       done * desc->blksz);
+		if (done == blkcnt) {
+			ra->stats.merged++;
+			return blkcnt;
+		}
+		start += done;
+		buffer += done * desc->blksz;
+	}
+	todo = blkcnt - done;
+
+	limit = blk_readahead_limit(desc, ra);
+	if (sequential)
+		ra->window = min(max(ra->window * 2, todo * 2), limit);
+	else
+		ra->window = 0;
+
+	count = ra->window;
+	if (desc->lba && start + count > desc->lba)
+		count = desc->lba > start ? desc->lba - start : 0;
+	if (count > todo && !ra->buf)
+		ra->buf = memalign(ARCH_DMA_MINALIGN, limit * desc->blksz);
+
+	ra->stats.issued++;
+	if (count <= todo || !ra->buf) {
+		n = ops->read(dev, start, todo, buffer);
+		if (IS_ERR_VALUE(n))
+			return n;
+		ra->stats.blocks += n;
+
+		return done + n;
+	}
+
+	ra->count = 0;
+	n = ops->read(dev, start, count, ra->buf);
+	if (IS_ERR_VALUE(n))
+		return n;
+	ra->stats.blocks += n;
+	ra->start = start;
+	ra->count = n;
+
+	n = min(n, todo);
+	memcpy(buffer, ra->buf, n * desc->blksz);
+
+	return done + n;
+}
+
+static void blk_readahead_remove(struct udevice *dev)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	free(ra->buf);
+	ra->buf = NULL;
+	ra->count = 0;
+}
+#else
+static ulong blk_readahead_read(struct udevice *dev, struct blk_desc *desc,
+				lbaint_t start, lbaint_t blkcnt, void *buffer)
+{
+	return blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+}
+
+static void blk_readahead_remove(struct udevice *dev)
+{
+}
+#endif
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
@@ -449,7 +618,7 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
+	blks_read = blk_readahead_read(dev, block_dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
 			      start, blkcnt, block_dev->blksz, buffer);
@@ -467,6 +636,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(dev);
+	fs_invalidate(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -480,9 +651,25 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(dev);
+	fs_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
+int blk_dmap(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
+	     void **ptrp)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (!ops->map)
+		return -ENOSYS;
+	if (start > block_dev->lba || blkcnt > block_dev->lba - start)
+		return -ERANGE;
+
+	return ops->map(dev, start, blkcnt, ptrp);
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -757,9 +944,21 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	fs_remove_dev(dev_get_uclass_plat(dev));
+	blk_readahead_remove(dev);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+	.per_device_auto	= sizeof(struct blk_readahead),
+#endif
 };
@@ -3,158 +3,260 @@
  * Copyright (C) Nelson Integration, LLC 2016
  * Author: Eric Nelson<eric@nelint.com>
  *
+ * The cache is a set-associative array of page-sized slots carved out of a
+ * single pool. Each slot holds the blocks of one naturally aligned,
+ * page-sized window of a device, with a bitmap recording which of those
+ * blocks are valid. A slot is located by hashing (iftype, devnum, window)
+ * into a set and comparing the tags of the few ways in that set, so lookups
+ * no longer depend on the number of cached entries.
  */
 #include <common.h>
 #include <blk.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
-#include <asm/global_data.h>
 #include <linux/ctype.h>
-#include <linux/list.h>
+#include <linux/sizes.h>
 
-#ifdef CONFIG_NEEDS_MANUAL_RELOC
-DECLARE_GLOBAL_DATA_PTR;
-#endif
+/* size of each cache slot; a slot never holds more than one window */
+#define BLKCACHE_SLOT_SIZE	SZ_4K
+/* number of slots in each set */
+#define BLKCACHE_WAYS		4
 
-struct block_cache_node {
-	struct list_head lh;
+struct block_cache_slot {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	lbaint_t window;	/* block number / blocks per slot */
+	u32 valid;		/* bitmap of valid blocks, 0 if slot is free */
+	u32 lru;		/* value of lru_clock when last used */
 };
 
-static LIST_HEAD(block_cache);
+static struct block_cache_slot *slots;
+static char *pool;
+static unsigned int num_sets;
+static unsigned int num_ways;
+static u32 lru_clock;
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
 	.max_entries = 32
 };
 
-#ifdef CONFIG_NEEDS_MANUAL_RELOC
-int blkcache_init(void)
+static void cache_free(void)
 {
-	struct list_head *head = &block_cache;
+	free(slots);
+	free(pool);
+	slots = NULL;
+	pool = NULL;
+	num_sets = 0;
+	_stats.entries = 0;
+}
+
+/**
+ * cache_alloc() - allocate the slot pool on first use
+ *
+ * Return: 0 if OK, -ENOMEM if the pool could not be allocated
+ */
+static int cache_alloc(void)
+{
+	unsigned int count;
+
+	if (slots)
+		return 0;
+
+	num_ways = min_t(unsigned int, BLKCACHE_WAYS, _stats.max_entries);
+	num_sets = _stats.max_entries / num_ways;
+	count = num_sets * num_ways;
 
-	head->next = (uintptr_t)head->next + gd->reloc_off;
-	head->prev = (uintptr_t)head->prev + gd->reloc_off;
+	slots = calloc(count, sizeof(*slots));
+	pool = malloc(count * BLKCACHE_SLOT_SIZE);
+	if (!slots || !pool) {
+		debug("blkcache: cannot allocate %u slots\n", count);
+		cache_free();
+		return -ENOMEM;
+	}
 
 	return 0;
 }
-#endif
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static inline unsigned int blocks_per_slot(unsigned long blksz)
+{
+	return BLKCACHE_SLOT_SIZE / blksz;
+}
+
+static inline char *slot_data(struct block_cache_slot *slot)
+{
+	return pool + (slot - slots) * BLKCACHE_SLOT_SIZE;
+}
+
+static struct block_cache_slot *cache_set(int iftype, int devnum,
+					  lbaint_t window)
 {
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
+	u64 hash;
+
+	hash = (u64)window * 0x9e3779b97f4a7c15ULL;
+	hash ^= ((u64)devnum << 8 | iftype) * 0xc2b2ae3d27d4eb4fULL;
+	hash ^= hash >> 29;
+
+	return &slots[(hash % num_sets) * num_ways];
+}
+
+/**
+ * cache_lookup() - find a slot for a window, optionally allocating it
+ *
+ * @iftype: IF_TYPE_x for type of device
+ * @devnum: device index of particular type
+ * @blksz: size in bytes of each block
+ * @window: window number to look up
+ * @alloc: true to claim a slot (evicting the LRU way) if not present
+ * Return: slot, or NULL if not present and @alloc is false
+ */
+static struct block_cache_slot *cache_lookup(int iftype, int devnum,
+					     unsigned long blksz,
+					     lbaint_t window, bool alloc)
+{
+	struct block_cache_slot *set, *slot, *victim = NULL;
+	unsigned int way;
+
+	set = cache_set(iftype, devnum, window);
+	for (way = 0; way < num_ways; way++) {
+		slot = &set[way];
+		if (!slot->valid) {
+			if (!victim || victim->valid)
+				victim = slot;
+			continue;
 		}
-	return 0;
+		if (slot->window == window && slot->devnum == devnum &&
+		    slot->iftype == iftype && slot->blksz == blksz) {
+			slot->lru = ++lru_clock;
+			return slot;
+		}
+		if (!victim || (victim->valid &&
+				(s32)(slot->lru - victim->lru) < 0))
+			victim = slot;
+	}
+
+	if (!alloc)
+		return NULL;
+
+	if (victim->valid) {
+		debug("evict: window " LBAF "\n", victim->window);
+		++_stats.evictions;
+	} else {
+		_stats.entries++;
+	}
+	victim->iftype = iftype;
+	victim->devnum = devnum;
+	victim->blksz = blksz;
+	victim->window = window;
+	victim->valid = 0;
+	victim->lru = ++lru_clock;
+
+	return victim;
+}
+
+/**
+ * cache_usable() - check whether a request can go through the cache
+ *
+ * @blkcnt: number of blocks in the request
+ * @blksz: size in bytes of each block
+ * Return: true if the request is small enough and the cache is set up
+ */
+static bool cache_usable(lbaint_t blkcnt, unsigned long blksz)
+{
+	/* don't cache big stuff */
+	if (!blkcnt || blkcnt > _stats.max_blocks_per_entry)
+		return false;
+
+	if (!blksz || blksz > BLKCACHE_SLOT_SIZE ||
+	    blocks_per_slot(blksz) > 32)
+		return false;
+
+	return num_sets != 0;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_slot *slot;
+	unsigned int per_slot, first, count;
+	lbaint_t blk = start, end = start + blkcnt;
+	char *dst = buffer;
+	u32 mask;
+
+	if (!cache_usable(blkcnt, blksz)) {
+		++_stats.misses;
+		return 0;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	/* The buffer is scratch until we hit, so copy as we go */
+	per_slot = blocks_per_slot(blksz);
+	while (blk < end) {
+		first = blk % per_slot;
+		count = min_t(lbaint_t, per_slot - first, end - blk);
+		mask = GENMASK(first + count - 1, first);
+
+		slot = cache_lookup(iftype, devnum, blksz, blk / per_slot,
+				    false);
+		if (!slot || (slot->valid & mask) != mask) {
+			debug("miss: start " LBAF ", count " LBAFU "\n",
+			      start, blkcnt);
+			++_stats.misses;
+			return 0;
+		}
+		memcpy(dst, slot_data(slot) + first * blksz, count * blksz);
+		dst += count * blksz;
+		blk += count;
+	}
+
+	debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+	++_stats.hits;
+
+	return 1;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	struct block_cache_slot *slot;
+	unsigned int per_slot, first, count;
+	lbaint_t blk = start, end = start + blkcnt;
+	const char *src = buffer;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	if (!num_sets && _stats.max_entries && cache_alloc())
 		return;
-
-	if (_stats.max_entries == 0)
+	if (!cache_usable(blkcnt, blksz))
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
+	per_slot = blocks_per_slot(blksz);
+	while (blk < end) {
+		first = blk % per_slot;
+		count = min_t(lbaint_t, per_slot - first, end - blk);
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+		slot = cache_lookup(iftype, devnum, blksz, blk / per_slot,
+				    true);
+		memcpy(slot_data(slot) + first * blksz, src, count * blksz);
+		slot->valid |= GENMASK(first + count - 1, first);
+		src += count * blksz;
+		blk += count;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
+	struct block_cache_slot *slot;
+	unsigned int i;
+
+	for (i = 0; i < num_sets * num_ways; i++) {
+		slot = &slots[i];
+		if (slot->valid && slot->iftype == iftype &&
+		    slot->devnum == devnum) {
+			slot->valid = 0;
 			--_stats.entries;
 		}
 	}
@@ -162,17 +264,10 @@ void blkcache_invalidate(int iftype, int devnum)
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
-		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+		/* invalidate cache; the pool is reallocated on next fill */
+		cache_free();
 	}
 
 	_stats.max_blocks_per_entry = blocks;
@@ -180,11 +275,15 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
+	stats->ways = min_t(unsigned int, BLKCACHE_WAYS, _stats.max_entries);
+	stats->slot_size = BLKCACHE_SLOT_SIZE;
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
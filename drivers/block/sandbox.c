@@ -95,6 +95,7 @@ int host_dev_bind(int devnum, char *filename, bool removable)
 	struct udevice *dev;
 	struct blk_desc *desc;
 	char dev_name[20], *str, *fname;
+	loff_t size;
 	int ret, fd;
 
 	/* Remove and unbind the old device, if any */
@@ -144,6 +145,12 @@ int host_dev_bind(int devnum, char *filename, bool removable)
 	host_dev->fd = fd;
 	host_dev->filename = fname;
 
+	/* Map the file as well, if possible, so it can be used in place */
+	size = os_lseek(fd, 0, OS_SEEK_END);
+	if (size > 0 && size <= INT_MAX)
+		os_map_file(filename, OS_O_RDONLY, &host_dev->buf,
+			    &host_dev->size);
+
 	ret = device_probe(dev);
 	if (ret) {
 		device_unbind(dev);
@@ -243,14 +250,30 @@ int sandbox_host_unbind(struct udevice *dev)
 
 	/* Data validity is checked in host_dev_bind() */
 	host_dev = dev_get_plat(dev);
+	if (host_dev->buf)
+		os_unmap(host_dev->buf, host_dev->size);
 	os_close(host_dev->fd);
 
 	return 0;
 }
 
+static int host_block_map(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void **ptrp)
+{
+	struct host_block_dev *host_dev = dev_get_plat(dev);
+	struct blk_desc *block_dev = dev_get_uclass_plat(dev);
+
+	if (!host_dev->buf)
+		return -ENOSYS;
+	*ptrp = host_dev->buf + start * block_dev->blksz;
+
+	return 0;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.map	= host_block_map,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
@@ -16,6 +16,7 @@
 #include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -91,6 +92,7 @@ int device_unbind(struct udevice *dev)
 			return log_msg_ret("unbind", ret);
 	}
 
+	lists_drop_deferred(dev);
 	ret = device_chld_unbind(dev, NULL);
 	if (ret)
 		return log_msg_ret("child unbind", ret);
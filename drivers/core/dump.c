@@ -6,10 +6,13 @@
 #include <common.h>
 #include <dm.h>
 #include <mapmem.h>
+#include <asm/global_data.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/uclass-internal.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
 	int i, is_last;
@@ -245,3 +248,21 @@ void dm_dump_mem(struct dm_stats *stats)
 	printf("Drop device name (not SRAM): %x (%d)\n", stats->dev_name_size,
 	       stats->dev_name_size);
 }
+
+void dm_dump_lookups(void)
+{
+	struct uclass_table *tab = gd_uclass_table();
+	int i, count = 0;
+
+	if (!tab) {
+		printf("No uclass table: every lookup searches the list\n");
+		return;
+	}
+	for (i = 0; i < UCLASS_COUNT; i++) {
+		if (tab->uc[i])
+			count++;
+	}
+	printf("uclass table: %d of %d IDs present\n", count, UCLASS_COUNT);
+	printf("uclass_find(): %lu lookups, %lu from the table, %lu searched the list (%lu uclasses checked)\n",
+	       tab->finds, tab->finds - tab->walks, tab->walks, tab->steps);
+}
@@ -16,17 +16,215 @@
 #include <dm/lists.h>
 #include <dm/platdata.h>
 #include <dm/uclass.h>
+#include <dm/uclass-internal.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <linux/compiler.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_HASH)
+/* Marks the end of a hash chain */
+#define LISTS_HASH_END		0xffff
+
+/**
+ * struct lists_compat - a compatible string of a driver
+ *
+ * @drv:	Index of the driver in the linker list
+ * @match:	Index of the string in the driver's of_match table
+ * @next:	Next entry with the same hash, or LISTS_HASH_END
+ */
+struct lists_compat {
+	u16 drv;
+	u16 match;
+	u16 next;
+};
+
+/**
+ * struct lists_hash - hash tables for finding drivers
+ *
+ * Each chain is in linker-list order, so that a lookup finds the same driver
+ * as searching the linker list does.
+ *
+ * @mask:	Number of chains in each table, less one
+ * @name_head:	First driver in each chain of driver names
+ * @name_next:	Next driver in the same chain, for each driver
+ * @compat_head: First entry in each chain of compatible strings
+ * @compat:	Entry for each compatible string of each driver
+ */
+struct lists_hash {
+	uint mask;
+	u16 *name_head;
+	u16 *name_next;
+	u16 *compat_head;
+	struct lists_compat *compat;
+};
+
+static struct lists_hash *lists_hash;
+static bool lists_hash_off;
+/* Too many drivers or compatible strings for the u16 indexes */
+static bool lists_hash_too_big;
+
+void lists_use_hash(bool use)
+{
+	lists_hash_off = !use;
+}
+
+static uint lists_hash_str(const char *str)
+{
+	uint hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619U;
+
+	return hash;
+}
+
+/*
+ * Get the hash tables, setting them up on first use. This needs the full
+ * malloc(), so before that the linker list is searched instead.
+ */
+static struct lists_hash *lists_get_hash(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id;
+	struct lists_hash *hash;
+	struct lists_compat *ent;
+	uint size, count = 0;
+	int i, j;
+	u16 *slot;
+
+	/* BSS, which holds the statics below, is not usable before then */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return NULL;
+	if (lists_hash_off || lists_hash_too_big)
+		return NULL;
+	if (lists_hash)
+		return lists_hash;
+
+	for (i = 0; i < n_ents; i++) {
+		for (of_id = driver[i].of_match; of_id && of_id->compatible;
+		     of_id++)
+			count++;
+	}
+	if (n_ents >= LISTS_HASH_END || count >= LISTS_HASH_END) {
+		lists_hash_too_big = true;
+		return NULL;
+	}
+	size = roundup_pow_of_two(max(max(n_ents, (int)count), 1));
+	hash = malloc(sizeof(*hash) + count * sizeof(*ent) +
+		      (size * 2 + n_ents) * sizeof(u16));
+	if (!hash) {
+		/* Do not retry the allocation on every lookup */
+		lists_hash_off = true;
+		return NULL;
+	}
+	hash->mask = size - 1;
+	hash->compat = (struct lists_compat *)(hash + 1);
+	hash->compat_head = (u16 *)(hash->compat + count);
+	hash->name_head = hash->compat_head + size;
+	hash->name_next = hash->name_head + size;
+	memset(hash->compat_head, '\xff', size * 2 * sizeof(u16));
+
+	/* Add entries in reverse so that each chain ends up in list order */
+	for (i = n_ents - 1; i >= 0; i--) {
+		slot = &hash->name_head[lists_hash_str(driver[i].name) &
+					hash->mask];
+		hash->name_next[i] = *slot;
+		*slot = i;
+
+		of_id = driver[i].of_match;
+		for (j = 0; of_id && of_id[j].compatible; j++)
+			;
+		while (j--) {
+			ent = &hash->compat[--count];
+			ent->drv = i;
+			ent->match = j;
+			slot = &hash->compat_head[lists_hash_str(of_id[j].compatible)
+						  & hash->mask];
+			ent->next = *slot;
+			*slot = count;
+		}
+	}
+	lists_hash = hash;
+
+	return hash;
+}
+
+static struct driver *lists_hash_find_name(struct lists_hash *hash,
+					   const char *name)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	uint i;
+
+	for (i = hash->name_head[lists_hash_str(name) & hash->mask];
+	     i != LISTS_HASH_END; i = hash->name_next[i]) {
+		if (!strcmp(name, driver[i].name))
+			return driver + i;
+	}
+
+	return NULL;
+}
+
+static struct driver *lists_hash_find_compat(struct lists_hash *hash,
+					     const char *compat,
+					     const struct udevice_id **of_idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const struct udevice_id *of_id;
+	struct lists_compat *ent;
+	uint i;
+
+	for (i = hash->compat_head[lists_hash_str(compat) & hash->mask];
+	     i != LISTS_HASH_END; i = ent->next) {
+		ent = &hash->compat[i];
+		of_id = &driver[ent->drv].of_match[ent->match];
+		if (!strcmp(of_id->compatible, compat)) {
+			*of_idp = of_id;
+			return driver + ent->drv;
+		}
+	}
+
+	return NULL;
+}
+#else
+struct lists_hash;
+
+static inline struct lists_hash *lists_get_hash(void)
+{
+	return NULL;
+}
+
+static inline struct driver *lists_hash_find_name(struct lists_hash *hash,
+						  const char *name)
+{
+	return NULL;
+}
+
+static inline struct driver *
+lists_hash_find_compat(struct lists_hash *hash, const char *compat,
+		       const struct udevice_id **of_idp)
+{
+	return NULL;
+}
+#endif
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
 		ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct lists_hash *hash = lists_get_hash();
 	struct driver *entry;
 
+	if (hash)
+		return lists_hash_find_name(hash, name);
 	for (entry = drv; entry != drv + n_ents; entry++) {
 		if (!strcmp(name, entry->name))
 			return entry;
@@ -181,11 +379,47 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+/**
+ * driver_find_compatible() - Find the first driver matching a compatible string
+ *
+ * @drv:	If non-NULL, only this driver is considered
+ * @compat:	The compatible string to search for
+ * @of_idp:	Returns the match that was found, or NULL if @drv has no
+ *		compatible strings
+ * Return: driver found, or NULL if none
+ */
+static struct driver *driver_find_compatible(struct driver *drv,
+					     const char *compat,
+					     const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct lists_hash *hash;
+	struct driver *entry;
+
+	if (drv) {
+		*of_idp = NULL;
+		if (!drv->of_match)
+			return drv;
+		if (driver_check_compatible(drv->of_match, of_idp, compat))
+			return NULL;
+		return drv;
+	}
+
+	hash = lists_get_hash();
+	if (hash)
+		return lists_hash_find_compat(hash, compat, of_idp);
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -222,19 +456,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = driver_find_compatible(drv, compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
@@ -245,12 +468,13 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			}
 		}
 
-		if (entry->of_match)
+		if (id)
 			log_debug("   - found match at '%s': '%s' matches '%s'\n",
 				  entry->name, entry->of_match->compatible,
 				  id->compatible);
 		ret = device_bind_with_driver_data(parent, entry, name,
-						   id->data, node, &dev);
+						   id ? id->data : 0, node,
+						   &dev);
 		if (ret == -ENODEV) {
 			log_debug("Driver '%s' refuses to bind\n", entry->name);
 			continue;
@@ -273,3 +497,240 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 	return result;
 }
 #endif
+
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * struct lists_lazy_node - a devicetree node waiting to be bound
+ *
+ * @sibling:		Entry in the list of waiting nodes
+ * @parent:		Device to bind the node to
+ * @node:		Devicetree node
+ * @uclass_id:		Uclass of the first driver which matches the node
+ * @pre_reloc_only:	Value to pass to lists_bind_fdt()
+ */
+struct lists_lazy_node {
+	struct list_head sibling;
+	struct udevice *parent;
+	ofnode node;
+	enum uclass_id uclass_id;
+	bool pre_reloc_only;
+};
+
+/**
+ * struct lists_lazy - devicetree nodes waiting to be bound
+ *
+ * @head:	List of struct lists_lazy_node, in the order they were found
+ * @count:	Number of nodes in @head
+ * @active:	true to record new nodes, false to bind them straight away
+ * @can_free:	true if this was allocated with the full malloc(), so that
+ *		free() can be used on it
+ */
+struct lists_lazy {
+	struct list_head head;
+	int count;
+	bool active;
+	bool can_free;
+};
+
+int lists_lazy_start(void)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+
+	if (!lazy) {
+		lazy = calloc(1, sizeof(*lazy));
+		if (!lazy)
+			return -ENOMEM;
+		INIT_LIST_HEAD(&lazy->head);
+		lazy->can_free = gd->flags & GD_FLG_FULL_MALLOC_INIT;
+		gd_set_dm_lazy(lazy);
+	}
+	lazy->active = true;
+
+	return 0;
+}
+
+void lists_lazy_free(void)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+	struct lists_lazy_node *lnode, *tmp;
+
+	/* Memory from before relocation is simply left behind */
+	if (lazy && lazy->can_free) {
+		list_for_each_entry_safe(lnode, tmp, &lazy->head, sibling)
+			free(lnode);
+		free(lazy);
+	}
+	gd_set_dm_lazy(NULL);
+}
+
+void lists_lazy_stop(void)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+
+	if (lazy)
+		lazy->active = false;
+}
+
+/* Buses which look after their children expect all of them to be bound */
+static bool lists_parent_is_bus(struct udevice *parent)
+{
+	const struct uclass_driver *uc_drv = parent->uclass->uc_drv;
+	const struct driver *drv = parent->driver;
+
+	return drv->child_post_bind || drv->per_child_auto ||
+		drv->per_child_plat_auto || uc_drv->child_post_bind ||
+		uc_drv->per_child_auto || uc_drv->per_child_plat_auto;
+}
+
+bool lists_defer_fdt(struct udevice *parent, ofnode node, bool pre_reloc_only)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+	struct lists_lazy_node *lnode;
+	const struct udevice_id *id;
+	const char *compat_list, *compat;
+	struct uclass_driver *uc_drv;
+	struct driver *drv = NULL;
+	int compat_length, i;
+
+	if (!lazy || !lazy->active || lists_parent_is_bus(parent))
+		return false;
+
+	/* The subnodes may hold devices of any uclass */
+	if (ofnode_valid(ofnode_first_subnode(node)))
+		return false;
+
+	compat_list = ofnode_get_property(node, "compatible", &compat_length);
+	if (!compat_list)
+		return false;
+	for (i = 0; i < compat_length; i += strlen(compat) + 1) {
+		compat = compat_list + i;
+		drv = driver_find_compatible(NULL, compat, &id);
+		if (drv)
+			break;
+	}
+
+	/*
+	 * Let lists_bind_fdt() deal with nodes it would skip. Once a uclass
+	 * exists, its devices are expected to be bound already
+	 */
+	if (!drv || uclass_find(drv->id))
+		return false;
+
+	/*
+	 * A bind() method may do more than set up the device, e.g. ask for it
+	 * to be probed straight away with DM_FLAG_PROBE_AFTER_BIND
+	 */
+	uc_drv = lists_uclass_lookup(drv->id);
+	if (drv->bind || !uc_drv || uc_drv->post_bind)
+		return false;
+	if (pre_reloc_only && !ofnode_pre_reloc(node) &&
+	    !(drv->flags & DM_FLAG_PRE_RELOC))
+		return false;
+
+	lnode = malloc(sizeof(*lnode));
+	if (!lnode)
+		return false;
+	lnode->parent = parent;
+	lnode->node = node;
+	lnode->uclass_id = drv->id;
+	lnode->pre_reloc_only = pre_reloc_only;
+	list_add_tail(&lnode->sibling, &lazy->head);
+	lazy->count++;
+	log_debug("defer node %s\n", ofnode_get_name(node));
+
+	return true;
+}
+
+/*
+ * Bind the nodes in @todo, which have been taken off the main list so that
+ * binding one of them can safely look up other uclasses
+ */
+static int lists_bind_todo(struct list_head *todo)
+{
+	struct lists_lazy_node *lnode;
+	int ret, err = 0;
+
+	while (!list_empty(todo)) {
+		lnode = list_first_entry(todo, struct lists_lazy_node, sibling);
+		list_del(&lnode->sibling);
+		ret = lists_bind_fdt(lnode->parent, lnode->node, NULL, NULL,
+				     lnode->pre_reloc_only);
+		if (ret) {
+			dm_warn("Error binding deferred node '%s': %d\n",
+				ofnode_get_name(lnode->node), ret);
+			if (!err)
+				err = ret;
+		}
+		free(lnode);
+	}
+
+	return err;
+}
+
+/* Bind all the nodes recorded for a uclass, in the order they were found */
+static int lists_bind_uclass(struct lists_lazy *lazy, enum uclass_id id)
+{
+	struct lists_lazy_node *lnode, *tmp;
+	LIST_HEAD(todo);
+
+	list_for_each_entry_safe(lnode, tmp, &lazy->head, sibling) {
+		if (lnode->uclass_id == id) {
+			list_move_tail(&lnode->sibling, &todo);
+			lazy->count--;
+		}
+	}
+
+	return lists_bind_todo(&todo);
+}
+
+void lists_bind_deferred(enum uclass_id id)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+
+	if (lazy)
+		lists_bind_uclass(lazy, id);
+}
+
+int lists_bind_deferred_node(ofnode node)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+	struct lists_lazy_node *lnode;
+
+	if (!lazy)
+		return 0;
+
+	/*
+	 * Bind the node's whole uclass, so that its devices are still numbered
+	 * in devicetree order
+	 */
+	list_for_each_entry(lnode, &lazy->head, sibling) {
+		if (ofnode_equal(lnode->node, node))
+			return lists_bind_uclass(lazy, lnode->uclass_id);
+	}
+
+	return 0;
+}
+
+void lists_drop_deferred(struct udevice *parent)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+	struct lists_lazy_node *lnode, *tmp;
+
+	if (!lazy)
+		return;
+	list_for_each_entry_safe(lnode, tmp, &lazy->head, sibling) {
+		if (lnode->parent == parent) {
+			list_del(&lnode->sibling);
+			lazy->count--;
+			free(lnode);
+		}
+	}
+}
+
+int lists_deferred_count(void)
+{
+	struct lists_lazy *lazy = gd_dm_lazy();
+
+	return lazy ? lazy->count : 0;
+}
+#endif
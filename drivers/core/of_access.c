@@ -29,6 +29,7 @@
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -47,6 +48,18 @@ static struct device_node *of_stdout;
 /* pointer to options given after the alias (separated by :) or NULL if none */
 static const char *of_stdout_options;
 
+/* tree covered by the phandle table, NULL if there is no table */
+static struct device_node *of_phandle_root;
+
+/* nodes with a phandle, hashed by phandle with linear probing */
+static struct device_node **of_phandle_table;
+
+/* number of slots in the phandle table minus one */
+static uint of_phandle_mask;
+
+/* number of nodes in the phandle table */
+static uint of_phandle_count;
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  *
@@ -445,16 +458,113 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
+static void of_phandle_insert(struct device_node **table, uint mask,
+			      struct device_node *np)
+{
+	uint i;
+
+	for (i = np->phandle & mask; table[i]; i = (i + 1) & mask)
+		;
+	table[i] = np;
+}
+
+/**
+ * of_phandle_resize() - Make room in the phandle table
+ *
+ * The table is kept at most half full so that probe sequences stay short.
+ *
+ * @count: Number of nodes the table must be able to hold
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+static int of_phandle_resize(uint count)
+{
+	struct device_node **table;
+	uint size, i;
+
+	size = roundup_pow_of_two(max(count * 2, 16U));
+	if (of_phandle_table && size <= of_phandle_mask + 1)
+		return 0;
+	table = calloc(size, sizeof(*table));
+	if (!table)
+		return -ENOMEM;
+	if (of_phandle_table) {
+		for (i = 0; i <= of_phandle_mask; i++) {
+			if (of_phandle_table[i])
+				of_phandle_insert(table, size - 1,
+						  of_phandle_table[i]);
+		}
+		free(of_phandle_table);
+	}
+	of_phandle_table = table;
+	of_phandle_mask = size - 1;
+
+	return 0;
+}
+
+static void of_phandle_add(struct device_node *np)
+{
+	if (!of_phandle_root || of_phandle_root != gd->of_root)
+		return;
+	if (of_phandle_resize(of_phandle_count + 1))
+		return;
+	of_phandle_insert(of_phandle_table, of_phandle_mask, np);
+	of_phandle_count++;
+}
+
+int of_phandle_scan(void)
+{
+	struct device_node *np;
+	uint count = 0;
+	int ret;
+
+	free(of_phandle_table);
+	of_phandle_table = NULL;
+	of_phandle_root = NULL;
+	of_phandle_count = 0;
+
+	for_each_of_allnodes(np) {
+		if (np->phandle)
+			count++;
+	}
+	ret = of_phandle_resize(count);
+	if (ret)
+		return ret;
+	of_phandle_root = gd->of_root;
+	for_each_of_allnodes(np) {
+		if (np->phandle)
+			of_phandle_add(np);
+	}
+
+	return 0;
+}
+
 struct device_node *of_find_node_by_phandle(phandle handle)
 {
 	struct device_node *np;
+	uint i;
 
 	if (!handle)
 		return NULL;
 
+	/*
+	 * Entries whose phandle has since changed are skipped. Nodes which
+	 * gain a phandle after the table is built are found by walking the
+	 * tree, then added to the table
+	 */
+	if (of_phandle_root && of_phandle_root == gd->of_root) {
+		for (i = handle & of_phandle_mask; of_phandle_table[i];
+		     i = (i + 1) & of_phandle_mask) {
+			np = of_phandle_table[i];
+			if (np->phandle == handle)
+				return of_node_get(np);
+		}
+	}
+
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
+	if (np)
+		of_phandle_add(np);
 	(void)of_node_get(np);
 
 	return np;
@@ -9,6 +9,7 @@
 #define LOG_CATEGORY UCLASS_ROOT
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <fdtdec.h>
 #include <log.h>
@@ -180,6 +181,12 @@ int dm_init(bool of_live)
 		gd->uclass_root = &DM_UCLASS_ROOT_S_NON_CONST;
 		INIT_LIST_HEAD(DM_UCLASS_ROOT_NON_CONST);
 	}
+	/* Without the table, uclasses are found by searching the list */
+	ret = uclass_table_init();
+	if (ret)
+		log_debug("uclass_table_init() failed: %d\n", ret);
+	/* Nodes recorded for an earlier tree must not be bound into this one */
+	lists_lazy_free();
 
 	if (IS_ENABLED(CONFIG_NEEDS_MANUAL_RELOC)) {
 		fix_drivers();
@@ -285,6 +292,8 @@ static int dm_scan_fdt_node(struct udevice *parent, ofnode parent_node,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (lists_defer_fdt(parent, node, pre_reloc_only))
+			continue;
 		err = lists_bind_fdt(parent, node, NULL, NULL, pre_reloc_only);
 		if (err && !ret) {
 			ret = err;
@@ -418,6 +427,32 @@ static int dm_scan(bool pre_reloc_only)
 	return dm_probe_devices(gd->dm_root, pre_reloc_only);
 }
 
+/**
+ * dm_record_lazy() - Record how many devices were bound and deferred
+ *
+ * This adds a bootstage record, e.g. "dm_r: 95 bound, 40 deferred"
+ *
+ * @pre_reloc_only: true if this is the pre-relocation driver model
+ */
+static void dm_record_lazy(bool pre_reloc_only)
+{
+	int dev_count, uc_count, deferred;
+	char *str;
+
+	dm_get_stats(&dev_count, &uc_count);
+	deferred = lists_deferred_count();
+	log_debug("%d devices bound, %d deferred\n", dev_count, deferred);
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE))
+		return;
+
+	str = malloc(40);
+	if (!str)
+		return;
+	snprintf(str, 40, "%s: %d bound, %d deferred",
+		 pre_reloc_only ? "dm_f" : "dm_r", dev_count, deferred);
+	bootstage_mark_name(BOOTSTAGE_ID_ALLOC, str);
+}
+
 int dm_init_and_scan(bool pre_reloc_only)
 {
 	int ret;
@@ -428,11 +463,20 @@ int dm_init_and_scan(bool pre_reloc_only)
 		return ret;
 	}
 	if (!CONFIG_IS_ENABLED(OF_PLATDATA_INST)) {
+		if (CONFIG_IS_ENABLED(DM_LAZY_BIND)) {
+			ret = lists_lazy_start();
+			if (ret)
+				log_debug("lists_lazy_start() failed: %d\n",
+					  ret);
+		}
 		ret = dm_scan(pre_reloc_only);
+		lists_lazy_stop();
 		if (ret) {
 			log_debug("dm_scan() failed: %d\n", ret);
 			return ret;
 		}
+		if (CONFIG_IS_ENABLED(DM_LAZY_BIND))
+			dm_record_lazy(pre_reloc_only);
 	}
 	if (CONFIG_IS_ENABLED(DM_EVENT)) {
 		ret = event_notify_null(EVT_DM_POST_INIT);
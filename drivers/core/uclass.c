@@ -23,20 +23,64 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+int uclass_table_init(void)
+{
+	struct uclass_table *tab = gd_uclass_table();
+
+	if (!CONFIG_IS_ENABLED(DM_UCLASS_TABLE))
+		return 0;
+	/* Leave the small early malloc() pool to the devices */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+	if (tab) {
+		memset(tab, '\0', sizeof(*tab));
+	} else {
+		tab = calloc(1, sizeof(*tab));
+		if (!tab)
+			return -ENOMEM;
+		gd_set_uclass_table(tab);
+	}
+	tab->complete = list_empty(gd->uclass_root);
+
+	return 0;
+}
+
+/* Record the uclass for an ID, or NULL if it is removed */
+static void uclass_table_set(enum uclass_id id, struct uclass *uc)
+{
+	struct uclass_table *tab = gd_uclass_table();
+
+	if (tab && (uint)id < UCLASS_COUNT)
+		tab->uc[id] = uc;
+}
+
 struct uclass *uclass_find(enum uclass_id key)
 {
+	struct uclass_table *tab = gd_uclass_table();
 	struct uclass *uc;
 
 	if (!gd->dm_root)
 		return NULL;
+	if (tab) {
+		tab->finds++;
+		if ((uint)key < UCLASS_COUNT && tab->uc[key])
+			return tab->uc[key];
+		if (tab->complete)
+			return NULL;
+		tab->walks++;
+	}
+
 	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
+	 * Uclasses created before the table was set up, e.g. by dtoc, are
+	 * added to it here
 	 */
 	list_for_each_entry(uc, gd->uclass_root, sibling_node) {
-		if (uc->uc_drv->id == key)
+		if (tab)
+			tab->steps++;
+		if (uc->uc_drv->id == key) {
+			uclass_table_set(key, uc);
 			return uc;
+		}
 	}
 
 	return NULL;
@@ -86,6 +130,7 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, DM_UCLASS_ROOT_NON_CONST);
+	uclass_table_set(id, uc);
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -102,6 +147,7 @@ fail:
 		uclass_set_priv(uc, NULL);
 	}
 	list_del(&uc->sibling_node);
+	uclass_table_set(id, NULL);
 fail_mem:
 	free(uc);
 
@@ -135,6 +181,7 @@ int uclass_destroy(struct uclass *uc)
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
+	uclass_table_set(uc_drv->id, NULL);
 	if (uc_drv->priv_auto)
 		free(uclass_get_priv(uc));
 	free(uc);
@@ -152,9 +199,18 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 	*ucp = NULL;
 	uc = uclass_find(id);
 	if (!uc) {
+		int ret;
+
 		if (CONFIG_IS_ENABLED(OF_PLATDATA_INST))
 			return -ENOENT;
-		return uclass_add(id, ucp);
+		ret = uclass_add(id, ucp);
+		if (ret)
+			return ret;
+
+		/* Bind any devices which were waiting for their uclass */
+		lists_bind_deferred(id);
+
+		return 0;
 	}
 	*ucp = uc;
 
@@ -489,6 +489,7 @@ static int mmc_blk_probe(struct udevice *dev)
 		debug("%s: mmc_init() failed (err=%d)\n", __func__, ret);
 		return ret;
 	}
+	blk_set_readahead_max(dev, mmc->cfg->b_max);
 
 	ret = device_probe(dev);
 	if (ret) {
@@ -28,6 +28,13 @@
 #include <power/regulator.h>
 #include <watchdog.h>
 
+/* IDMA linked list item, as fetched by the SDMMC from memory */
+struct stm32_sdmmc2_lli {
+	u32 idmalar;
+	u32 idmabase;
+	u32 idmasize;
+};
+
 struct stm32_sdmmc2_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
@@ -37,6 +44,7 @@ struct stm32_sdmmc2_plat {
 	struct gpio_desc cd_gpio;
 	u32 clk_reg_msk;
 	u32 pwr_reg_msk;
+	struct stm32_sdmmc2_lli *lli;
 #if CONFIG_IS_ENABLED(DM_REGULATOR)
 	bool vqmmc_enabled;
 #endif
@@ -66,7 +74,10 @@ struct stm32_sdmmc2_ctx {
 #define SDMMC_ICR		0x38	/* SDMMC interrupt clear           */
 #define SDMMC_MASK		0x3C	/* SDMMC mask                      */
 #define SDMMC_IDMACTRL		0x50	/* SDMMC DMA control               */
+#define SDMMC_IDMABSIZE		0x54	/* SDMMC DMA buffer size           */
 #define SDMMC_IDMABASE0		0x58	/* SDMMC DMA buffer 0 base address */
+#define SDMMC_IDMALAR		0x64	/* SDMMC DMA linked list address   */
+#define SDMMC_IDMABAR		0x68	/* SDMMC DMA linked list base      */
 
 /* SDMMC_POWER register */
 #define SDMMC_POWER_PWRCTRL_MASK	GENMASK(1, 0)
@@ -107,6 +118,9 @@ struct stm32_sdmmc2_ctx {
 #define SDMMC_CMD_BOOTEN		BIT(15)
 #define SDMMC_CMD_CMDSUSPEND		BIT(16)
 
+/* SDMMC_DLEN register */
+#define SDMMC_DLEN_DATALENGTH		GENMASK(24, 0)
+
 /* SDMMC_DCTRL register */
 #define SDMMC_DCTRL_DTEN		BIT(0)
 #define SDMMC_DCTRL_DTDIR		BIT(1)
@@ -201,10 +215,96 @@ struct stm32_sdmmc2_ctx {
 
 /* SDMMC_IDMACTRL register */
 #define SDMMC_IDMACTRL_IDMAEN		BIT(0)
+#define SDMMC_IDMACTRL_IDMALLIEN	BIT(1)
+
+/* SDMMC_IDMABSIZE register */
+#define SDMMC_IDMABSIZE_IDMABNDT	GENMASK(16, 5)
+
+/* SDMMC_IDMALAR register */
+#define SDMMC_IDMALAR_IDMALA		GENMASK(13, 0)
+#define SDMMC_IDMALAR_ABR		BIT(29)
+#define SDMMC_IDMALAR_ULS		BIT(30)
+#define SDMMC_IDMALAR_ULA		BIT(31)
+
+/*
+ * Each linked list item but the last one must cover a multiple of the IDMA
+ * burst (32 bytes), so split transfers on the largest such buffer size.
+ * Enough items are provided to cover the largest data length.
+ */
+#define SDMMC_LLI_MAX_BSIZE		SDMMC_IDMABSIZE_IDMABNDT
+#define SDMMC_LLI_ENTRIES		DIV_ROUND_UP(SDMMC_DLEN_DATALENGTH, \
+						     SDMMC_LLI_MAX_BSIZE)
+#define SDMMC_LLI_SIZE			ALIGN(SDMMC_LLI_ENTRIES * \
+					      sizeof(struct stm32_sdmmc2_lli), \
+					      ARCH_DMA_MINALIGN)
+
+/* driver data: the IDMA supports linked list mode */
+#define SDMMC_HAS_LLI			BIT(0)
 
 #define SDMMC_CMD_TIMEOUT		0xFFFFFFFF
 #define SDMMC_BUSYD0END_TIMEOUT_US	2000000
 
+/*
+ * Prepare the data cache for a DMA read: the buffer lines are invalidated
+ * so that no dirty line is written back over the received data, but the
+ * lines which are only partly covered by the buffer are cleaned first to
+ * keep the data around it.
+ */
+static void stm32_sdmmc2_prepare_read(u32 buf, struct stm32_sdmmc2_ctx *ctx)
+{
+	u32 start = roundup(buf, ARCH_DMA_MINALIGN);
+	u32 end = rounddown(buf + ctx->data_length, ARCH_DMA_MINALIGN);
+
+	if (start >= end) {
+		flush_dcache_range(ctx->cache_start, ctx->cache_end);
+		return;
+	}
+
+	if (start != ctx->cache_start)
+		flush_dcache_range(ctx->cache_start, start);
+	if (end != ctx->cache_end)
+		flush_dcache_range(end, ctx->cache_end);
+	invalidate_dcache_range(start, end);
+}
+
+/*
+ * Start the IDMA in linked list mode, splitting the buffer into items of at
+ * most SDMMC_LLI_MAX_BSIZE bytes. The first item is loaded in the registers
+ * and the IDMA fetches the following ones from the list.
+ */
+static void stm32_sdmmc2_start_lli(struct stm32_sdmmc2_plat *plat,
+				   u32 buf, u32 len)
+{
+	struct stm32_sdmmc2_lli *lli = plat->lli;
+	u32 size;
+	int i;
+
+	for (i = 0; len; i++) {
+		size = min_t(u32, len, SDMMC_LLI_MAX_BSIZE);
+		lli[i].idmalar = ((i + 1) * sizeof(*lli)) |
+				 SDMMC_IDMALAR_ULA | SDMMC_IDMALAR_ULS |
+				 SDMMC_IDMALAR_ABR;
+		lli[i].idmabase = buf;
+		lli[i].idmasize = size;
+		buf += size;
+		len -= size;
+	}
+
+	/* notice the end of the linked list */
+	lli[i - 1].idmalar &= ~SDMMC_IDMALAR_ULA;
+
+	flush_dcache_range((ulong)lli,
+			   (ulong)lli + ALIGN(i * sizeof(*lli),
+					      ARCH_DMA_MINALIGN));
+
+	writel((u32)(long)lli, plat->base + SDMMC_IDMABAR);
+	writel(lli[0].idmalar, plat->base + SDMMC_IDMALAR);
+	writel(lli[0].idmabase, plat->base + SDMMC_IDMABASE0);
+	writel(lli[0].idmasize, plat->base + SDMMC_IDMABSIZE);
+	writel(SDMMC_IDMACTRL_IDMAEN | SDMMC_IDMACTRL_IDMALLIEN,
+	       plat->base + SDMMC_IDMACTRL);
+}
+
 static void stm32_sdmmc2_start_data(struct udevice *dev,
 				    struct mmc_data *data,
 				    struct stm32_sdmmc2_ctx *ctx)
@@ -235,16 +335,18 @@ static void stm32_sdmmc2_start_data(struct udevice *dev,
 	ctx->cache_end = roundup(idmabase0 + ctx->data_length,
 				 ARCH_DMA_MINALIGN);
 
-	/*
-	 * Flush data cache before DMA start (clean and invalidate)
-	 * Clean also needed for read
-	 * Avoid issue on buffer not cached-aligned
-	 */
-	flush_dcache_range(ctx->cache_start, ctx->cache_end);
+	if (data->flags & MMC_DATA_READ)
+		stm32_sdmmc2_prepare_read(idmabase0, ctx);
+	else
+		flush_dcache_range(ctx->cache_start, ctx->cache_end);
 
 	/* Enable internal DMA */
-	writel(idmabase0, plat->base + SDMMC_IDMABASE0);
-	writel(SDMMC_IDMACTRL_IDMAEN, plat->base + SDMMC_IDMACTRL);
+	if (plat->lli && ctx->data_length > SDMMC_LLI_MAX_BSIZE) {
+		stm32_sdmmc2_start_lli(plat, idmabase0, ctx->data_length);
+	} else {
+		writel(idmabase0, plat->base + SDMMC_IDMABASE0);
+		writel(SDMMC_IDMACTRL_IDMAEN, plat->base + SDMMC_IDMACTRL);
+	}
 }
 
 static void stm32_sdmmc2_start_cmd(struct udevice *dev,
@@ -654,11 +756,25 @@ static int stm32_sdmmc2_host_power_cycle(struct udevice *dev)
 	return 0;
 }
 
+/*
+ * A single command moves at most SDMMC_DLEN_DATALENGTH bytes, whether in
+ * single buffer or in linked list mode.
+ */
+static int stm32_sdmmc2_get_b_max(struct udevice *dev, void *dst,
+				  lbaint_t blkcnt)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	return min_t(u32, SDMMC_DLEN_DATALENGTH / mmc->read_bl_len,
+		     mmc->cfg->b_max);
+}
+
 static const struct dm_mmc_ops stm32_sdmmc2_ops = {
 	.send_cmd = stm32_sdmmc2_send_cmd,
 	.set_ios = stm32_sdmmc2_set_ios,
 	.get_cd = stm32_sdmmc2_getcd,
 	.host_power_cycle = stm32_sdmmc2_host_power_cycle,
+	.get_b_max = stm32_sdmmc2_get_b_max,
 };
 
 static int stm32_sdmmc2_of_to_plat(struct udevice *dev)
@@ -680,7 +796,8 @@ static int stm32_sdmmc2_of_to_plat(struct udevice *dev)
 
 	cfg->f_min = 400000;
 	cfg->voltages = MMC_VDD_32_33 | MMC_VDD_33_34 | MMC_VDD_165_195;
-	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+	cfg->b_max = min_t(u32, SDMMC_DLEN_DATALENGTH / MMC_MAX_BLOCK_LEN,
+			   CONFIG_SYS_MMC_MAX_BLK_COUNT);
 	cfg->name = "STM32 SD/MMC";
 	cfg->host_caps = 0;
 	cfg->f_max = 52000000;
@@ -772,6 +889,12 @@ static int stm32_sdmmc2_probe(struct udevice *dev)
 
 	upriv->mmc = &plat->mmc;
 
+	if (dev_get_driver_data(dev) & SDMMC_HAS_LLI) {
+		plat->lli = memalign(ARCH_DMA_MINALIGN, SDMMC_LLI_SIZE);
+		if (!plat->lli)
+			dev_dbg(dev, "no linked list, using single buffer\n");
+	}
+
 	if (plat->clk_reg_msk & SDMMC_CLKCR_SELCLKRX_CKIN)
 		stm32_sdmmc2_probe_level_translator(dev);
 
@@ -781,6 +904,16 @@ static int stm32_sdmmc2_probe(struct udevice *dev)
 	return 0;
 }
 
+static int stm32_sdmmc2_remove(struct udevice *dev)
+{
+	struct stm32_sdmmc2_plat *plat = dev_get_plat(dev);
+
+	free(plat->lli);
+	plat->lli = NULL;
+
+	return 0;
+}
+
 static int stm32_sdmmc2_bind(struct udevice *dev)
 {
 	struct stm32_sdmmc2_plat *plat = dev_get_plat(dev);
@@ -790,7 +923,7 @@ static int stm32_sdmmc2_bind(struct udevice *dev)
 
 static const struct udevice_id stm32_sdmmc2_ids[] = {
 	{ .compatible = "st,stm32-sdmmc2" },
-	{ .compatible = "st,stm32mp25-sdmmc2" },
+	{ .compatible = "st,stm32mp25-sdmmc2", .data = SDMMC_HAS_LLI },
 	{ }
 };
 
@@ -800,6 +933,7 @@ U_BOOT_DRIVER(stm32_sdmmc2) = {
 	.of_match = stm32_sdmmc2_ids,
 	.ops = &stm32_sdmmc2_ops,
 	.probe = stm32_sdmmc2_probe,
+	.remove = stm32_sdmmc2_remove,
 	.bind = stm32_sdmmc2_bind,
 	.of_to_plat = stm32_sdmmc2_of_to_plat,
 	.plat_auto	= sizeof(struct stm32_sdmmc2_plat),
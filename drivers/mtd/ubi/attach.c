@@ -86,6 +86,7 @@
 #include <linux/math64.h>
 
 #include <ubi_uboot.h>
+#include <bootstage.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
@@ -1406,6 +1407,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (!ai)
 		return -ENOMEM;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_SCAN, "ubi_scan");
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	/* On small flash devices we disable fastmap in any case. */
 	if ((int)mtd_div_by_eb(ubi->mtd->size, ubi->mtd) <= UBI_FM_MAX_START) {
@@ -1433,6 +1435,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 #else
 	err = scan_all(ubi, ai, 0);
 #endif
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_SCAN);
 	if (err)
 		goto out_ai;
 
@@ -1443,15 +1446,21 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	ubi->mean_ec = ai->mean_ec;
 	dbg_gen("max. sequence number:       %llu", ai->max_sqnum);
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_VOL, "ubi_volumes");
 	err = ubi_read_volume_table(ubi, ai);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_VOL);
 	if (err)
 		goto out_ai;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_EC, "ubi_erase_counters");
 	err = ubi_wl_init(ubi, ai);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_EC);
 	if (err)
 		goto out_vtbl;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_VOL, "ubi_volumes");
 	err = ubi_eba_init(ubi, ai);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_VOL);
 	if (err)
 		goto out_wl;
 
@@ -36,6 +36,7 @@
 #endif
 #include <linux/err.h>
 #include <ubi_uboot.h>
+#include <bootstage.h>
 #include <linux/mtd/partitions.h>
 
 #include "ubi.h"
@@ -1061,11 +1062,30 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 #ifndef __UBOOT__
 	wake_up_process(ubi->bgt_thread);
 #else
+	/* Run the erasures queued while building the wear-levelling trees */
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_EC, "ubi_erase_counters");
 	ubi_do_worker(ubi);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_EC);
 #endif
 
 	spin_unlock(&ubi->wl_lock);
 
+	/*
+	 * If the device had to be scanned although fastmap may be used on
+	 * it, write a fastmap now. Left to detach time, it would usually
+	 * never be written since U-Boot boots the OS without detaching, and
+	 * the next attach would have to scan again.
+	 */
+	if (IS_ENABLED(CONFIG_MTD_UBI_FASTMAP_WRITE_AFTER_SCAN) &&
+	    !ubi->fm && !ubi->fm_disabled && !ubi->ro_mode) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_FM, "ubi_fastmap_write");
+		err = ubi_update_fastmap(ubi);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_FM);
+		if (err)
+			ubi_warn(ubi, "cannot write fastmap after scan, error %d",
+				 err);
+	}
+
 	ubi_devices[ubi_num] = ubi;
 	ubi_notify_all(ubi, UBI_VOLUME_ADDED, NULL);
 	return ubi_num;
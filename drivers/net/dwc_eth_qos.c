@@ -115,7 +115,12 @@ static struct eqos_desc *eqos_get_desc(struct eqos_priv *eqos,
 				       unsigned int num, bool rx)
 {
 	return eqos->descs +
-		((rx ? EQOS_DESCRIPTORS_TX : 0) + num) * eqos->desc_size;
+		((rx ? eqos->num_tx_descs : 0) + num) * eqos->desc_size;
+}
+
+static void *eqos_get_rx_buf(struct eqos_priv *eqos, unsigned int num)
+{
+	return eqos->rx_dma_buf + num * EQOS_MAX_PACKET_SIZE;
 }
 
 void eqos_inval_desc_generic(struct eqos_priv *eqos, void *desc)
@@ -801,6 +806,8 @@ static int eqos_start(struct udevice *dev)
 
 	eqos->tx_desc_idx = 0;
 	eqos->rx_desc_idx = 0;
+	eqos->rx_refill_idx = 0;
+	eqos->rx_refill_pending = 0;
 
 	ret = eqos->config->ops->eqos_phy_power_on(dev);
 	if (ret < 0) {
@@ -1060,35 +1067,34 @@ static int eqos_start(struct udevice *dev)
 
 	/* Set up descriptors */
 
-	memset(eqos->descs, 0, eqos->desc_size * EQOS_DESCRIPTORS_NUM);
+	memset(eqos->descs, 0, eqos->desc_size *
+	       (eqos->num_tx_descs + eqos->num_rx_descs));
 
-	for (i = 0; i < EQOS_DESCRIPTORS_TX; i++) {
+	for (i = 0; i < eqos->num_tx_descs; i++) {
 		struct eqos_desc *tx_desc = eqos_get_desc(eqos, i, false);
 		eqos->config->ops->eqos_flush_desc(eqos, tx_desc);
 	}
 
-	for (i = 0; i < EQOS_DESCRIPTORS_RX; i++) {
+	for (i = 0; i < eqos->num_rx_descs; i++) {
 		struct eqos_desc *rx_desc = eqos_get_desc(eqos, i, true);
-		rx_desc->des0 = (u32)(ulong)(eqos->rx_dma_buf +
-					     (i * EQOS_MAX_PACKET_SIZE));
+		rx_desc->des0 = (u32)(ulong)eqos_get_rx_buf(eqos, i);
 		rx_desc->des3 = EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
 		mb();
 		eqos->config->ops->eqos_flush_desc(eqos, rx_desc);
-		eqos->config->ops->eqos_inval_buffer(eqos->rx_dma_buf +
-						(i * EQOS_MAX_PACKET_SIZE),
-						EQOS_MAX_PACKET_SIZE);
+		eqos->config->ops->eqos_inval_buffer(eqos_get_rx_buf(eqos, i),
+						     EQOS_MAX_PACKET_SIZE);
 	}
 
 	writel(0, &eqos->dma_regs->ch0_txdesc_list_haddress);
 	writel((ulong)eqos_get_desc(eqos, 0, false),
 		&eqos->dma_regs->ch0_txdesc_list_address);
-	writel(EQOS_DESCRIPTORS_TX - 1,
+	writel(eqos->num_tx_descs - 1,
 	       &eqos->dma_regs->ch0_txdesc_ring_length);
 
 	writel(0, &eqos->dma_regs->ch0_rxdesc_list_haddress);
 	writel((ulong)eqos_get_desc(eqos, 0, true),
 		&eqos->dma_regs->ch0_rxdesc_list_address);
-	writel(EQOS_DESCRIPTORS_RX - 1,
+	writel(eqos->num_rx_descs - 1,
 	       &eqos->dma_regs->ch0_rxdesc_ring_length);
 
 	/* Enable everything */
@@ -1106,7 +1112,7 @@ static int eqos_start(struct udevice *dev)
 	 * that's not distinguishable from none of the descriptors being
 	 * available.
 	 */
-	last_rx_desc = (ulong)eqos_get_desc(eqos, EQOS_DESCRIPTORS_RX - 1, true);
+	last_rx_desc = (ulong)eqos_get_desc(eqos, eqos->num_rx_descs - 1, true);
 	writel(last_rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
 
 	eqos->started = true;
@@ -1123,6 +1129,25 @@ err:
 	return ret;
 }
 
+/*
+ * The missed packet and overflow counters of the MTL RX queue are cleared on
+ * read, so accumulate them into the driver statistics.
+ */
+static void eqos_update_stats(struct eqos_priv *eqos)
+{
+	u32 val;
+
+	if (!eqos->started)
+		return;
+
+	val = readl(&eqos->mtl_regs->rxq0_missed_packet_overflow_cnt);
+	eqos->stats.rx_missed += (val >>
+				  EQOS_MTL_RXQ0_MISSED_PACKET_MISPKTCNT_SHIFT) &
+				 EQOS_MTL_RXQ0_MISSED_PACKET_MISPKTCNT_MASK;
+	eqos->stats.rx_overflows += val &
+				    EQOS_MTL_RXQ0_MISSED_PACKET_OVFPKTCNT_MASK;
+}
+
 static void eqos_stop(struct udevice *dev)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
@@ -1132,6 +1157,7 @@ static void eqos_stop(struct udevice *dev)
 
 	if (!eqos->started)
 		return;
+	eqos_update_stats(eqos);
 	eqos->started = false;
 	eqos->reg_access_ok = false;
 
@@ -1190,7 +1216,7 @@ static int eqos_send(struct udevice *dev, void *packet, int length)
 
 	tx_desc = eqos_get_desc(eqos, eqos->tx_desc_idx, false);
 	eqos->tx_desc_idx++;
-	eqos->tx_desc_idx %= EQOS_DESCRIPTORS_TX;
+	eqos->tx_desc_idx %= eqos->num_tx_descs;
 
 	tx_desc->des0 = (ulong)eqos->tx_dma_buf;
 	tx_desc->des1 = 0;
@@ -1208,16 +1234,120 @@ static int eqos_send(struct udevice *dev, void *packet, int length)
 
 	for (i = 0; i < 1000000; i++) {
 		eqos->config->ops->eqos_inval_desc(eqos, tx_desc);
-		if (!(readl(&tx_desc->des3) & EQOS_DESC3_OWN))
+		if (!(readl(&tx_desc->des3) & EQOS_DESC3_OWN)) {
+			eqos->stats.tx_packets++;
 			return 0;
+		}
 		udelay(1);
 	}
 
 	debug("%s: TX timeout\n", __func__);
+	eqos->stats.tx_stalls++;
 
 	return -ETIMEDOUT;
 }
 
+/*
+ * Call @fn once for each physically contiguous part of the RX ring entries
+ * [first, first + count), i.e. at most twice when the range wraps.
+ */
+static void eqos_rx_ring_ranges(struct eqos_priv *eqos, unsigned int first,
+				unsigned int count,
+				void (*fn)(struct eqos_priv *eqos,
+					   unsigned int first,
+					   unsigned int count))
+{
+	unsigned int n;
+
+	while (count) {
+		n = min(count, eqos->num_rx_descs - first);
+		fn(eqos, first, n);
+		count -= n;
+		first = 0;
+	}
+}
+
+static void eqos_flush_rx_descs(struct eqos_priv *eqos, unsigned int first,
+				unsigned int count)
+{
+	unsigned long start = (unsigned long)eqos_get_desc(eqos, first, true);
+	unsigned int i;
+
+	/*
+	 * Cached descriptors are padded to a cache line each, so a run of
+	 * them is flushed with a single range operation.
+	 */
+	if (eqos->config->ops->eqos_flush_desc == eqos_flush_desc_generic) {
+		if (eqos->use_cached_mem)
+			flush_dcache_range(start,
+					   start + count * eqos->desc_size);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		eqos->config->ops->eqos_flush_desc(eqos,
+				eqos_get_desc(eqos, first + i, true));
+}
+
+static void eqos_inval_rx_bufs(struct eqos_priv *eqos, unsigned int first,
+			       unsigned int count)
+{
+	eqos->config->ops->eqos_inval_buffer(eqos_get_rx_buf(eqos, first),
+					     count * EQOS_MAX_PACKET_SIZE);
+}
+
+/*
+ * Give the RX descriptors released by eqos_free_pkt() back to the DMA. This
+ * is done a batch at a time so that the cache maintenance and the tail
+ * pointer update are paid once per batch rather than once per packet.
+ */
+static void eqos_rx_refill(struct eqos_priv *eqos)
+{
+	unsigned int first = eqos->rx_refill_idx;
+	unsigned int count = eqos->rx_refill_pending;
+	struct eqos_desc *rx_desc;
+	unsigned int i, idx;
+
+	if (!count)
+		return;
+
+	for (i = 0, idx = first; i < count; i++) {
+		rx_desc = eqos_get_desc(eqos, idx, true);
+		rx_desc->des0 = 0;
+		idx = (idx + 1) % eqos->num_rx_descs;
+	}
+	mb();
+	eqos_rx_ring_ranges(eqos, first, count, eqos_flush_rx_descs);
+	eqos_rx_ring_ranges(eqos, first, count, eqos_inval_rx_bufs);
+
+	for (i = 0, idx = first; i < count; i++) {
+		rx_desc = eqos_get_desc(eqos, idx, true);
+		rx_desc->des0 = (u32)(ulong)eqos_get_rx_buf(eqos, idx);
+		rx_desc->des1 = 0;
+		rx_desc->des2 = 0;
+		idx = (idx + 1) % eqos->num_rx_descs;
+	}
+	/*
+	 * Make sure that if HW sees the _OWN writes below, it will see all the
+	 * writes to the rest of the descriptors too.
+	 */
+	mb();
+	for (i = 0, idx = first; i < count; i++) {
+		rx_desc = eqos_get_desc(eqos, idx, true);
+		rx_desc->des3 = EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
+		idx = (idx + 1) % eqos->num_rx_descs;
+	}
+	eqos_rx_ring_ranges(eqos, first, count, eqos_flush_rx_descs);
+
+	writel((ulong)rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
+
+	eqos->rx_refill_idx = idx;
+	eqos->rx_refill_pending = 0;
+	eqos->stats.rx_refills++;
+	eqos->stats.rx_refilled += count;
+	eqos_update_stats(eqos);
+}
+
 static int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
@@ -1230,15 +1360,17 @@ static int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
 	eqos->config->ops->eqos_inval_desc(eqos, rx_desc);
 	if (rx_desc->des3 & EQOS_DESC3_OWN) {
 		debug("%s: RX packet not available\n", __func__);
+		/* Nothing to do, so don't hold back a partial batch */
+		eqos_rx_refill(eqos);
 		return -EAGAIN;
 	}
 
-	*packetp = eqos->rx_dma_buf +
-		(eqos->rx_desc_idx * EQOS_MAX_PACKET_SIZE);
+	*packetp = eqos_get_rx_buf(eqos, eqos->rx_desc_idx);
 	length = rx_desc->des3 & 0x7fff;
 	debug("%s: *packetp=%p, length=%d\n", __func__, *packetp, length);
 
 	eqos->config->ops->eqos_inval_buffer(*packetp, length);
+	eqos->stats.rx_packets++;
 
 	return length;
 }
@@ -1247,12 +1379,10 @@ static int eqos_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
 	uchar *packet_expected;
-	struct eqos_desc *rx_desc;
 
 	debug("%s(packet=%p, length=%d)\n", __func__, packet, length);
 
-	packet_expected = eqos->rx_dma_buf +
-		(eqos->rx_desc_idx * EQOS_MAX_PACKET_SIZE);
+	packet_expected = eqos_get_rx_buf(eqos, eqos->rx_desc_idx);
 	if (packet != packet_expected) {
 		debug("%s: Unexpected packet (expected %p)\n", __func__,
 		      packet_expected);
@@ -1261,27 +1391,15 @@ static int eqos_free_pkt(struct udevice *dev, uchar *packet, int length)
 
 	eqos->config->ops->eqos_inval_buffer(packet, length);
 
-	rx_desc = eqos_get_desc(eqos, eqos->rx_desc_idx, true);
+	eqos->rx_desc_idx++;
+	eqos->rx_desc_idx %= eqos->num_rx_descs;
 
-	rx_desc->des0 = 0;
-	mb();
-	eqos->config->ops->eqos_flush_desc(eqos, rx_desc);
-	eqos->config->ops->eqos_inval_buffer(packet, length);
-	rx_desc->des0 = (u32)(ulong)packet;
-	rx_desc->des1 = 0;
-	rx_desc->des2 = 0;
 	/*
-	 * Make sure that if HW sees the _OWN write below, it will see all the
-	 * writes to the rest of the descriptor too.
+	 * The batch is smaller than the ring, so eqos_recv() never reaches a
+	 * descriptor which is still waiting to be refilled.
 	 */
-	mb();
-	rx_desc->des3 = EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
-	eqos->config->ops->eqos_flush_desc(eqos, rx_desc);
-
-	writel((ulong)rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
-
-	eqos->rx_desc_idx++;
-	eqos->rx_desc_idx %= EQOS_DESCRIPTORS_RX;
+	if (++eqos->rx_refill_pending >= eqos->rx_refill_batch)
+		eqos_rx_refill(eqos);
 
 	return 0;
 }
@@ -1293,7 +1411,8 @@ static int eqos_probe_resources_core(struct udevice *dev)
 
 	debug("%s(dev=%p):\n", __func__, dev);
 
-	eqos->descs = eqos_alloc_descs(eqos, EQOS_DESCRIPTORS_NUM);
+	eqos->descs = eqos_alloc_descs(eqos, eqos->num_tx_descs +
+				       eqos->num_rx_descs);
 	if (!eqos->descs) {
 		debug("%s: eqos_alloc_descs() failed\n", __func__);
 		ret = -ENOMEM;
@@ -1308,7 +1427,8 @@ static int eqos_probe_resources_core(struct udevice *dev)
 	}
 	debug("%s: tx_dma_buf=%p\n", __func__, eqos->tx_dma_buf);
 
-	eqos->rx_dma_buf = memalign(EQOS_BUFFER_ALIGN, EQOS_RX_BUFFER_SIZE);
+	eqos->rx_dma_buf = memalign(EQOS_BUFFER_ALIGN, eqos->num_rx_descs *
+				    EQOS_MAX_PACKET_SIZE);
 	if (!eqos->rx_dma_buf) {
 		debug("%s: memalign(rx_dma_buf) failed\n", __func__);
 		ret = -ENOMEM;
@@ -1325,7 +1445,7 @@ static int eqos_probe_resources_core(struct udevice *dev)
 	debug("%s: rx_pkt=%p\n", __func__, eqos->rx_pkt);
 
 	eqos->config->ops->eqos_inval_buffer(eqos->rx_dma_buf,
-			EQOS_MAX_PACKET_SIZE * EQOS_DESCRIPTORS_RX);
+			EQOS_MAX_PACKET_SIZE * eqos->num_rx_descs);
 
 	debug("%s: OK\n", __func__);
 	return 0;
@@ -1572,6 +1692,16 @@ static int eqos_probe(struct udevice *dev)
 
 	eqos->max_speed = dev_read_u32_default(dev, "max-speed", 0);
 
+	eqos->num_tx_descs = dev_read_u32_default(dev, "u-boot,tx-descriptors",
+					CONFIG_DWC_ETH_QOS_TX_DESCRIPTORS);
+	eqos->num_rx_descs = dev_read_u32_default(dev, "u-boot,rx-descriptors",
+					CONFIG_DWC_ETH_QOS_RX_DESCRIPTORS);
+	eqos->num_tx_descs = clamp_t(unsigned int, eqos->num_tx_descs,
+				     EQOS_DESCRIPTORS_MIN, EQOS_DESCRIPTORS_MAX);
+	eqos->num_rx_descs = clamp_t(unsigned int, eqos->num_rx_descs,
+				     EQOS_DESCRIPTORS_MIN, EQOS_DESCRIPTORS_MAX);
+	eqos->rx_refill_batch = eqos->num_rx_descs / EQOS_RX_REFILL_PARTS;
+
 	ret = eqos_probe_resources_core(dev);
 	if (ret < 0) {
 		pr_err("eqos_probe_resources_core() failed: %d", ret);
@@ -1787,3 +1917,23 @@ U_BOOT_DRIVER(eth_eqos) = {
 	.priv_auto	= sizeof(struct eqos_priv),
 	.plat_auto	= sizeof(struct eth_pdata),
 };
+
+int eqos_get_stats(struct udevice *dev, struct eqos_rings *rings,
+		   struct eqos_stats *stats, bool clear)
+{
+	struct eqos_priv *eqos;
+
+	if (dev->driver != DM_DRIVER_GET(eth_eqos) || !device_active(dev))
+		return -ENODEV;
+
+	eqos = dev_get_priv(dev);
+	eqos_update_stats(eqos);
+	rings->rx_descs = eqos->num_rx_descs;
+	rings->tx_descs = eqos->num_tx_descs;
+	rings->rx_refill_batch = eqos->rx_refill_batch;
+	*stats = eqos->stats;
+	if (clear)
+		memset(&eqos->stats, '\0', sizeof(eqos->stats));
+
+	return 0;
+}
@@ -5,6 +5,7 @@
 
 #include <phy_interface.h>
 #include <linux/bitops.h>
+#include <net/dwc_eth_qos.h>
 
 /* Core registers */
 
@@ -102,7 +103,7 @@ struct eqos_mtl_regs {
 	u32 txq0_quantum_weight;			/* 0xd18 */
 	u32 unused_d1c[(0xd30 - 0xd1c) / 4];	/* 0xd1c */
 	u32 rxq0_operation_mode;			/* 0xd30 */
-	u32 unused_d34;				/* 0xd34 */
+	u32 rxq0_missed_packet_overflow_cnt;	/* 0xd34 */
 	u32 rxq0_debug;				/* 0xd38 */
 };
 
@@ -118,6 +119,10 @@ struct eqos_mtl_regs {
 #define EQOS_MTL_TXQ0_DEBUG_TRCSTS_SHIFT		1
 #define EQOS_MTL_TXQ0_DEBUG_TRCSTS_MASK			3
 
+#define EQOS_MTL_RXQ0_MISSED_PACKET_MISPKTCNT_SHIFT	16
+#define EQOS_MTL_RXQ0_MISSED_PACKET_MISPKTCNT_MASK	0x7ff
+#define EQOS_MTL_RXQ0_MISSED_PACKET_OVFPKTCNT_MASK	0x7ff
+
 #define EQOS_MTL_RXQ0_OPERATION_MODE_RQS_SHIFT		20
 #define EQOS_MTL_RXQ0_OPERATION_MODE_RQS_MASK		0x3ff
 #define EQOS_MTL_RXQ0_OPERATION_MODE_RFD_SHIFT		14
@@ -193,12 +198,11 @@ struct eqos_tegra186_regs {
 #define EQOS_AUTO_CAL_STATUS_ACTIVE			BIT(31)
 
 /* Descriptors */
-#define EQOS_DESCRIPTORS_TX	4
-#define EQOS_DESCRIPTORS_RX	4
-#define EQOS_DESCRIPTORS_NUM	(EQOS_DESCRIPTORS_TX + EQOS_DESCRIPTORS_RX)
+#define EQOS_DESCRIPTORS_MIN	4
+#define EQOS_DESCRIPTORS_MAX	1024	/* ring length registers are 10 bits */
+#define EQOS_RX_REFILL_PARTS	4	/* RX refill batches per ring */
 #define EQOS_BUFFER_ALIGN	ARCH_DMA_MINALIGN
 #define EQOS_MAX_PACKET_SIZE	ALIGN(1568, ARCH_DMA_MINALIGN)
-#define EQOS_RX_BUFFER_SIZE	(EQOS_DESCRIPTORS_RX * EQOS_MAX_PACKET_SIZE)
 
 struct eqos_desc {
 	u32 des0;
@@ -269,7 +273,9 @@ struct eqos_priv {
 	ofnode phy_of_node;
 	u32 max_speed;
 	void *descs;
+	unsigned int num_tx_descs, num_rx_descs;
 	int tx_desc_idx, rx_desc_idx;
+	unsigned int rx_refill_idx, rx_refill_pending, rx_refill_batch;
 	unsigned int desc_size;
 	void *tx_dma_buf;
 	void *rx_dma_buf;
@@ -278,6 +284,7 @@ struct eqos_priv {
 	bool reg_access_ok;
 	bool clk_ck_enabled;
 	bool use_cached_mem;
+	struct eqos_stats stats;
 #ifdef CONFIG_DM_REGULATOR
 	struct udevice *phy_supply;
 #endif
@@ -6,6 +6,7 @@
 #define LOG_CATEGORY UCLASS_WDT
 
 #include <common.h>
+#include <cpu_job.h>
 #include <dm.h>
 #include <errno.h>
 #include <hang.h>
@@ -217,6 +218,10 @@ void watchdog_reset(void)
 	if (!gd || !(gd->flags & GD_FLG_WDT_READY))
 		return;
 
+	/* Leave the watchdog to the boot core when running as a job */
+	if (cpu_job_on_worker())
+		return;
+
 	if (uclass_get(UCLASS_WDT, &uc))
 		return;
 
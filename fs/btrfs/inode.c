@@ -408,6 +408,39 @@ out:
 	return ret;
 }
 
+/*
+ * Read @len bytes at logical address @logical into @dest.
+ *
+ * The range may cross stripe or chunk boundaries, each piece is read from the
+ * first mirror that returns it intact.
+ */
+static int read_logical(struct btrfs_fs_info *fs_info, char *dest,
+			u64 logical, u64 len)
+{
+	while (len) {
+		int num_copies;
+		u64 read = 0;
+		int ret = -EIO;
+		int i;
+
+		num_copies = btrfs_num_copies(fs_info, logical, len);
+		for (i = 1; i <= num_copies; i++) {
+			read = len;
+			ret = read_extent_data(fs_info, dest, logical, &read, i);
+			if (!ret && read)
+				break;
+			ret = -EIO;
+		}
+		if (ret)
+			return ret;
+		dest += read;
+		logical += read;
+		len -= read;
+	}
+
+	return 0;
+}
+
 /*
  * Read out regular extent.
  *
@@ -426,14 +459,11 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	struct btrfs_key key;
 	u64 extent_num_bytes;
 	u64 disk_bytenr;
-	u64 read;
+	u64 doff;
 	char *cbuf = NULL;
 	char *dbuf = NULL;
 	u32 csize;
 	u32 dsize;
-	bool finished = false;
-	int num_copies;
-	int i;
 	int slot = path->slots[0];
 	int ret;
 
@@ -451,52 +481,38 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 		return len;
 	}
 
-	if (btrfs_file_extent_compression(leaf, fi) == BTRFS_COMPRESS_NONE) {
-		u64 logical;
-
-		logical = btrfs_file_extent_disk_bytenr(leaf, fi) +
-			  btrfs_file_extent_offset(leaf, fi) +
-			  offset - key.offset;
-		read = len;
+	disk_bytenr = btrfs_file_extent_disk_bytenr(leaf, fi);
+	doff = btrfs_file_extent_offset(leaf, fi) + offset - key.offset;
 
-		num_copies = btrfs_num_copies(fs_info, logical, len);
-		for (i = 1; i <= num_copies; i++) {
-			ret = read_extent_data(fs_info, dest, logical, &read, i);
-			if (ret < 0 || read != len)
-				continue;
-			finished = true;
-			break;
-		}
-		if (!finished)
-			return -EIO;
+	if (btrfs_file_extent_compression(leaf, fi) == BTRFS_COMPRESS_NONE) {
+		ret = read_logical(fs_info, dest, disk_bytenr + doff, len);
+		if (ret < 0)
+			return ret;
 		return len;
 	}
 
 	csize = btrfs_file_extent_disk_num_bytes(leaf, fi);
 	dsize = btrfs_file_extent_ram_bytes(leaf, fi);
-	disk_bytenr = btrfs_file_extent_disk_bytenr(leaf, fi);
-	num_copies = btrfs_num_copies(fs_info, disk_bytenr, csize);
 
+	/*
+	 * The decompressors can't stop part way through, so only when the
+	 * caller wants the whole decompressed extent can it go straight into
+	 * @dest. Otherwise decompress into a bounce buffer and copy the part
+	 * needed.
+	 */
 	cbuf = malloc_cache_aligned(csize);
-	dbuf = malloc_cache_aligned(dsize);
+	if (doff == 0 && len == dsize)
+		dbuf = dest;
+	else
+		dbuf = malloc_cache_aligned(dsize);
 	if (!cbuf || !dbuf) {
 		ret = -ENOMEM;
 		goto out;
 	}
 	/* For compressed extent, we must read the whole on-disk extent */
-	for (i = 1; i <= num_copies; i++) {
-		read = csize;
-		ret = read_extent_data(fs_info, cbuf, disk_bytenr,
-				       &read, i);
-		if (ret < 0 || read != csize)
-			continue;
-		finished = true;
-		break;
-	}
-	if (!finished) {
-		ret = -EIO;
+	ret = read_logical(fs_info, cbuf, disk_bytenr, csize);
+	if (ret < 0)
 		goto out;
-	}
 
 	ret = btrfs_decompress(btrfs_file_extent_compression(leaf, fi), cbuf,
 			       csize, dbuf, dsize);
@@ -511,14 +527,73 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	if (ret < dsize)
 		memset(dbuf + ret, 0, dsize - ret);
 	/* Then copy the needed part */
-	memcpy(dest, dbuf + btrfs_file_extent_offset(leaf, fi), len);
+	if (dbuf != dest)
+		memcpy(dest, dbuf + doff, len);
 	ret = len;
 out:
 	free(cbuf);
-	free(dbuf);
+	if (dbuf != dest)
+		free(dbuf);
 	return ret;
 }
 
+/*
+ * Read the uncompressed regular extent at @path from file offset @cur, plus
+ * any following extents which continue it on disk, up to @end.
+ *
+ * Files written sequentially are usually laid out as a chain of such extents,
+ * so this turns them into a single device read.
+ *
+ * Return 0 and set @len_ret to the number of bytes read.
+ * Return <0 for error.
+ */
+static int read_extent_run(struct btrfs_root *root, struct btrfs_path *path,
+			   u64 ino, u64 cur, u64 end, char *dest, u64 *len_ret)
+{
+	struct btrfs_file_extent_item *fi;
+	struct extent_buffer *leaf;
+	struct btrfs_key key;
+	u64 logical;
+	u64 len;
+	int ret;
+
+	leaf = path->nodes[0];
+	btrfs_item_key_to_cpu(leaf, &key, path->slots[0]);
+	fi = btrfs_item_ptr(leaf, path->slots[0], struct btrfs_file_extent_item);
+	logical = btrfs_file_extent_disk_bytenr(leaf, fi) +
+		  btrfs_file_extent_offset(leaf, fi) + cur - key.offset;
+	len = min(key.offset + btrfs_file_extent_num_bytes(leaf, fi), end) -
+	      cur;
+
+	while (cur + len < end) {
+		ret = btrfs_next_item(root, path);
+		if (ret)
+			break;
+		leaf = path->nodes[0];
+		btrfs_item_key_to_cpu(leaf, &key, path->slots[0]);
+		if (key.objectid != ino || key.type != BTRFS_EXTENT_DATA_KEY ||
+		    key.offset != cur + len)
+			break;
+		fi = btrfs_item_ptr(leaf, path->slots[0],
+				    struct btrfs_file_extent_item);
+		if (btrfs_file_extent_type(leaf, fi) != BTRFS_FILE_EXTENT_REG ||
+		    btrfs_file_extent_compression(leaf, fi) !=
+		    BTRFS_COMPRESS_NONE ||
+		    btrfs_file_extent_disk_bytenr(leaf, fi) == 0 ||
+		    btrfs_file_extent_disk_bytenr(leaf, fi) +
+		    btrfs_file_extent_offset(leaf, fi) != logical + len)
+			break;
+		len = min(key.offset + btrfs_file_extent_num_bytes(leaf, fi),
+			  end) - cur;
+	}
+
+	ret = read_logical(root->fs_info, dest, logical, len);
+	if (ret < 0)
+		return ret;
+	*len_ret = len;
+	return 0;
+}
+
 /*
  * Get the first file extent that covers bytenr @file_offset.
  *
@@ -701,7 +776,7 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 
 	/* Read the aligned part */
 	while (cur < aligned_end) {
-		u64 extent_num_bytes;
+		u64 read;
 		u8 type;
 
 		btrfs_release_path(&path);
@@ -740,14 +815,21 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		}
 
 		/* Read the remaining part of the extent */
-		extent_num_bytes = btrfs_file_extent_num_bytes(path.nodes[0],
-							       fi);
-		ret = btrfs_read_extent_reg(&path, fi, cur,
-				min(extent_num_bytes, aligned_end - cur),
-				dest + cur - file_offset);
+		if (btrfs_file_extent_compression(path.nodes[0], fi) ==
+		    BTRFS_COMPRESS_NONE) {
+			ret = read_extent_run(root, &path, ino, cur,
+					      aligned_end,
+					      dest + cur - file_offset, &read);
+		} else {
+			read = key.offset +
+			       btrfs_file_extent_num_bytes(path.nodes[0], fi);
+			read = min(read, aligned_end) - cur;
+			ret = btrfs_read_extent_reg(&path, fi, cur, read,
+						    dest + cur - file_offset);
+		}
 		if (ret < 0)
 			goto out;
-		cur += min(extent_num_bytes, aligned_end - cur);
+		cur += read;
 	}
 
 	/* Read the tailing unaligned part*/
@@ -1,6 +1,68 @@
 // SPDX-License-Identifier: GPL-2.0+
 #include "internal.h"
 #include "decompress.h"
+#include <cpu_job.h>
+
+#ifdef CONFIG_FS_EROFS_PCLUSTER_CACHE
+#define Z_EROFS_PCLUSTER_CACHE	CONFIG_FS_EROFS_PCLUSTER_CACHE
+#else
+#define Z_EROFS_PCLUSTER_CACHE	0
+#endif
+
+/* Number of pclusters which may be decompressed at the same time */
+#define Z_EROFS_MAX_JOBS	4
+
+/**
+ * struct z_erofs_pcluster - a decompressed physical cluster
+ *
+ * @pa: Position of the compressed data
+ * @deviceid: Device holding the compressed data
+ * @len: Number of bytes decompressed, from the start of the extent
+ * @size: Size of @data
+ * @last_used: Value of z_erofs_pcluster_clock when last used, 0 if unused
+ * @data: Decompressed data
+ */
+struct z_erofs_pcluster {
+	erofs_off_t pa;
+	unsigned int deviceid;
+	unsigned int len;
+	unsigned int size;
+	ulong last_used;
+	char *data;
+};
+
+/**
+ * struct z_erofs_job - a pcluster being decompressed
+ *
+ * @job: Job running the decompression
+ * @rq: What to decompress
+ * @raw: Buffer for the compressed data
+ * @rawsize: Size of @raw
+ * @busy: true if @job has been queued and not waited for
+ */
+struct z_erofs_job {
+	struct cpu_job job;
+	struct z_erofs_decompress_req rq;
+	char *raw;
+	unsigned int rawsize;
+	bool busy;
+};
+
+static struct z_erofs_pcluster z_erofs_pclusters[Z_EROFS_PCLUSTER_CACHE];
+static ulong z_erofs_pcluster_clock;
+
+/**
+ * struct z_erofs_stats - counters of the pcluster cache, shown by erofsstat
+ *
+ * @hits: Number of reads served from a cached pcluster
+ * @fills: Number of pclusters decompressed into the cache
+ * @evictions: Number of cached pclusters replaced by another one
+ */
+static struct z_erofs_stats {
+	ulong hits;
+	ulong fills;
+	ulong evictions;
+} z_erofs_stats;
 
 static int erofs_map_blocks_flatmode(struct erofs_inode *inode,
 				     struct erofs_map_blocks *map,
@@ -206,6 +268,95 @@ static int erofs_read_raw_data(struct erofs_inode *inode, char *buffer,
 	return 0;
 }
 
+/* Find a pcluster which has at least @len bytes decompressed */
+static struct z_erofs_pcluster *z_erofs_pcluster_get(struct erofs_map_dev *mdev,
+						     erofs_off_t len)
+{
+	struct z_erofs_pcluster *pcl;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(z_erofs_pclusters); i++) {
+		pcl = &z_erofs_pclusters[i];
+		if (pcl->last_used && pcl->pa == mdev->m_pa &&
+		    pcl->deviceid == mdev->m_deviceid && pcl->len >= len) {
+			z_erofs_stats.hits++;
+			pcl->last_used = ++z_erofs_pcluster_clock;
+			return pcl;
+		}
+	}
+
+	return NULL;
+}
+
+/* Take the least recently used pcluster, with room for @len bytes */
+static struct z_erofs_pcluster *z_erofs_pcluster_victim(erofs_off_t len)
+{
+	struct z_erofs_pcluster *pcl, *victim = NULL;
+	char *data;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(z_erofs_pclusters); i++) {
+		pcl = &z_erofs_pclusters[i];
+		if (!victim || pcl->last_used < victim->last_used)
+			victim = pcl;
+	}
+	if (!victim || len > UINT_MAX)
+		return NULL;
+
+	if (victim->last_used)
+		z_erofs_stats.evictions++;
+	victim->last_used = 0;
+	if (victim->size < len) {
+		data = realloc(victim->data, len);
+		if (!data)
+			return NULL;
+		victim->data = data;
+		victim->size = len;
+	}
+
+	return victim;
+}
+
+void z_erofs_drop_pclusters(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(z_erofs_pclusters); i++)
+		free(z_erofs_pclusters[i].data);
+	memset(z_erofs_pclusters, '\0', sizeof(z_erofs_pclusters));
+	z_erofs_pcluster_clock = 0;
+}
+
+void erofs_show_stats(void)
+{
+	printf("pcluster cache: %d entries, %lu hits, %lu filled, %lu evicted\n",
+	       Z_EROFS_PCLUSTER_CACHE, z_erofs_stats.hits, z_erofs_stats.fills,
+	       z_erofs_stats.evictions);
+}
+
+void erofs_reset_stats(void)
+{
+	memset(&z_erofs_stats, '\0', sizeof(z_erofs_stats));
+}
+
+static int z_erofs_decompress_job(void *arg)
+{
+	return z_erofs_decompress(arg);
+}
+
+/*
+ * Wait for a job to finish, returning its result. Once this returns, the
+ * worker is done with the job's buffers, even if the job failed
+ */
+static int z_erofs_wait_job(struct z_erofs_job *job)
+{
+	if (!job->busy)
+		return 0;
+	job->busy = false;
+
+	return cpu_job_wait(&job->job);
+}
+
 static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			     erofs_off_t size, erofs_off_t offset)
 {
@@ -213,17 +364,23 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 	struct erofs_map_blocks map = {
 		.index = UINT_MAX,
 	};
+	struct z_erofs_job jobs[Z_EROFS_MAX_JOBS] = {};
+	struct z_erofs_pcluster *pcl;
 	struct erofs_map_dev mdev;
+	struct z_erofs_job *job;
+	unsigned int njobs = 0;
 	bool partial;
-	unsigned int bufsize = 0;
-	char *raw = NULL;
-	int ret = 0;
+	int ret = 0, err, i;
+	char *out, *raw;
 
 	end = offset + size;
 	while (end > offset) {
 		map.m_la = end - 1;
 
-		ret = z_erofs_map_blocks_iter(inode, &map, 0);
+		/* The cache needs to know how much a whole pcluster holds */
+		ret = z_erofs_map_blocks_iter(inode, &map,
+					      Z_EROFS_PCLUSTER_CACHE ?
+					      EROFS_GET_BLOCKS_FIEMAP : 0);
 		if (ret)
 			break;
 
@@ -257,39 +414,107 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			skip = 0;
 			end = map.m_la;
 		}
+		out = buffer + end - offset;
 
 		if (!(map.m_flags & EROFS_MAP_MAPPED)) {
-			memset(buffer + end - offset, 0, length);
-			end = map.m_la;
+			memset(out, 0, length - skip);
 			continue;
 		}
 
-		if (map.m_plen > bufsize) {
-			bufsize = map.m_plen;
-			raw = realloc(raw, bufsize);
-			if (!raw) {
-				ret = -ENOMEM;
+		/* Uncompressed data goes straight into place */
+		if (map.m_algorithmformat == Z_EROFS_COMPRESSION_SHIFTED) {
+			if (map.m_plen != EROFS_BLKSIZ) {
+				ret = -EFSCORRUPTED;
 				break;
 			}
+			DBG_BUGON(length > EROFS_BLKSIZ);
+
+			ret = erofs_dev_read(mdev.m_deviceid, out,
+					     mdev.m_pa + skip, length - skip);
+			if (ret < 0)
+				break;
+			continue;
+		}
+
+		pcl = z_erofs_pcluster_get(&mdev, length);
+		if (pcl) {
+			memcpy(out, pcl->data + skip, length - skip);
+			continue;
 		}
-		ret = erofs_dev_read(mdev.m_deviceid, raw, mdev.m_pa, map.m_plen);
+
+		/*
+		 * If only part of the pcluster is wanted, the rest is likely
+		 * to be wanted by the next read, so decompress all of it into
+		 * the cache. Otherwise decompress straight into the buffer.
+		 */
+		pcl = NULL;
+		if (skip || length < map.m_llen)
+			pcl = z_erofs_pcluster_victim(map.m_llen);
+
+		job = &jobs[njobs++ % Z_EROFS_MAX_JOBS];
+		ret = z_erofs_wait_job(job);
 		if (ret < 0)
 			break;
 
-		ret = z_erofs_decompress(&(struct z_erofs_decompress_req) {
-					.in = raw,
-					.out = buffer + end - offset,
-					.decodedskip = skip,
-					.inputsize = map.m_plen,
-					.decodedlength = length,
-					.alg = map.m_algorithmformat,
-					.partial_decoding = partial
-					 });
+		if (map.m_plen > job->rawsize) {
+			raw = realloc(job->raw, map.m_plen);
+			if (!raw) {
+				ret = -ENOMEM;
+				break;
+			}
+			job->raw = raw;
+			job->rawsize = map.m_plen;
+		}
+		ret = erofs_dev_read(mdev.m_deviceid, job->raw, mdev.m_pa,
+				     map.m_plen);
 		if (ret < 0)
 			break;
+
+		if (pcl) {
+			ret = z_erofs_decompress(&(struct z_erofs_decompress_req) {
+						.in = job->raw,
+						.out = pcl->data,
+						.inputsize = map.m_plen,
+						.decodedlength = map.m_llen,
+						.alg = map.m_algorithmformat,
+						.partial_decoding = true
+						 });
+			if (ret < 0)
+				break;
+
+			pcl->pa = mdev.m_pa;
+			pcl->deviceid = mdev.m_deviceid;
+			pcl->len = map.m_llen;
+			pcl->last_used = ++z_erofs_pcluster_clock;
+			z_erofs_stats.fills++;
+			memcpy(out, pcl->data + skip, length - skip);
+			continue;
+		}
+
+		/*
+		 * Each pcluster has its own part of the buffer, so it can be
+		 * decompressed on another core while the next one is read
+		 */
+		job->rq = (struct z_erofs_decompress_req) {
+			.in = job->raw,
+			.out = out,
+			.decodedskip = skip,
+			.inputsize = map.m_plen,
+			.decodedlength = length,
+			.alg = map.m_algorithmformat,
+			.partial_decoding = partial
+		};
+		cpu_job_queue(&job->job, z_erofs_decompress_job, &job->rq);
+		job->busy = true;
 	}
-	if (raw)
-		free(raw);
+
+	for (i = 0; i < Z_EROFS_MAX_JOBS; i++) {
+		err = z_erofs_wait_job(&jobs[i]);
+		if (err < 0 && ret >= 0)
+			ret = err;
+		free(jobs[i].raw);
+	}
+
 	return ret < 0 ? ret : 0;
 }
 
@@ -56,6 +56,149 @@ out:
 }
 #endif
 
+/*
+ * Compressed data is aligned to the end of the physical cluster, with zeroes
+ * in front of it. Returns the number of bytes of padding.
+ */
+static int __maybe_unused z_erofs_fixup_insize(struct z_erofs_decompress_req *rq)
+{
+	unsigned int margin = 0;
+
+	while (margin < rq->inputsize && margin < EROFS_BLKSIZ &&
+	       !rq->in[margin])
+		margin++;
+
+	if (margin >= rq->inputsize || margin >= EROFS_BLKSIZ)
+		return -EFSCORRUPTED;
+
+	return margin;
+}
+
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_LZMA)
+#include <asm/unaligned.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+
+static void *z_erofs_lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void z_erofs_lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+static int z_erofs_decompress_lzma(struct z_erofs_decompress_req *rq)
+{
+	ISzAlloc alloc = {
+		.Alloc = z_erofs_lzma_alloc,
+		.Free = z_erofs_lzma_free,
+	};
+	unsigned char props[LZMA_PROPS_SIZE];
+	char *dest = rq->out, *src, *buff = NULL;
+	SizeT destlen, srclen;
+	ELzmaStatus status;
+	int margin, ret;
+
+	margin = z_erofs_fixup_insize(rq);
+	if (margin < 0)
+		return margin;
+	src = rq->in + margin;
+
+	if (rq->decodedskip) {
+		buff = malloc(rq->decodedlength);
+		if (!buff)
+			return -ENOMEM;
+		dest = buff;
+	}
+
+	/*
+	 * This is MicroLZMA: a raw LZMA stream whose first byte, which the
+	 * range decoder ignores and is always zero, holds the inverted
+	 * properties byte instead. The whole output is in memory, so the
+	 * dictionary size does not matter.
+	 */
+	props[0] = ~src[0];
+	put_unaligned_le32(Z_EROFS_LZMA_MAX_DICT_SIZE, props + 1);
+	src[0] = 0;
+
+	destlen = rq->decodedlength;
+	srclen = rq->inputsize - margin;
+	ret = LzmaDecode((unsigned char *)dest, &destlen,
+			 (unsigned char *)src, &srclen, props, sizeof(props),
+			 LZMA_FINISH_ANY, &status, &alloc);
+	src[0] = ~props[0];
+	if (ret != SZ_OK || destlen != rq->decodedlength) {
+		ret = -EIO;
+		goto out;
+	}
+
+	if (rq->decodedskip)
+		memcpy(rq->out, dest + rq->decodedskip,
+		       rq->decodedlength - rq->decodedskip);
+	ret = destlen;
+
+out:
+	if (buff)
+		free(buff);
+
+	return ret;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_DEFLATE)
+#include <u-boot/zlib.h>
+
+static int z_erofs_decompress_deflate(struct z_erofs_decompress_req *rq)
+{
+	char *dest = rq->out, *buff = NULL;
+	z_stream stream;
+	int margin, ret;
+
+	margin = z_erofs_fixup_insize(rq);
+	if (margin < 0)
+		return margin;
+
+	if (rq->decodedskip) {
+		buff = malloc(rq->decodedlength);
+		if (!buff)
+			return -ENOMEM;
+		dest = buff;
+	}
+
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* Partial decoding stops as soon as the output is full */
+	stream.next_in = (unsigned char *)rq->in + margin;
+	stream.avail_in = rq->inputsize - margin;
+	stream.next_out = (unsigned char *)dest;
+	stream.avail_out = rq->decodedlength;
+	ret = inflate(&stream, Z_SYNC_FLUSH);
+	inflateEnd(&stream);
+	if ((ret != Z_OK && ret != Z_STREAM_END) ||
+	    stream.total_out != rq->decodedlength) {
+		ret = -EIO;
+		goto out;
+	}
+
+	if (rq->decodedskip)
+		memcpy(rq->out, dest + rq->decodedskip,
+		       rq->decodedlength - rq->decodedskip);
+	ret = stream.total_out;
+
+out:
+	if (buff)
+		free(buff);
+
+	return ret;
+}
+#endif
+
 int z_erofs_decompress(struct z_erofs_decompress_req *rq)
 {
 	if (rq->alg == Z_EROFS_COMPRESSION_SHIFTED) {
@@ -73,6 +216,14 @@ int z_erofs_decompress(struct z_erofs_decompress_req *rq)
 #if IS_ENABLED(CONFIG_LZ4)
 	if (rq->alg == Z_EROFS_COMPRESSION_LZ4)
 		return z_erofs_decompress_lz4(rq);
+#endif
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_LZMA)
+	if (rq->alg == Z_EROFS_COMPRESSION_LZMA)
+		return z_erofs_decompress_lzma(rq);
+#endif
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_DEFLATE)
+	if (rq->alg == Z_EROFS_COMPRESSION_DEFLATE)
+		return z_erofs_decompress_deflate(rq);
 #endif
 	return -EOPNOTSUPP;
 }
@@ -9,6 +9,16 @@ static struct erofs_ctxt {
 	struct blk_desc *cur_dev;
 } ctxt;
 
+/* Filesystem which the cached pclusters come from */
+static struct {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	u8 uuid[16];
+	u64 build_time;
+	u32 build_time_nsec;
+	u32 checksum;
+} cache_owner;
+
 int erofs_dev_read(int device_id, void *buf, u64 offset, size_t len)
 {
 	lbaint_t sect = offset >> ctxt.cur_dev->log2blksz;
@@ -41,6 +51,21 @@ int erofs_probe(struct blk_desc *fs_dev_desc,
 	if (ret)
 		goto error;
 
+	if (cache_owner.dev != fs_dev_desc ||
+	    cache_owner.part_start != fs_partition->start ||
+	    memcmp(cache_owner.uuid, sbi.uuid, sizeof(sbi.uuid)) ||
+	    cache_owner.build_time != sbi.build_time ||
+	    cache_owner.build_time_nsec != sbi.build_time_nsec ||
+	    cache_owner.checksum != sbi.checksum) {
+		z_erofs_drop_pclusters();
+		cache_owner.dev = fs_dev_desc;
+		cache_owner.part_start = fs_partition->start;
+		memcpy(cache_owner.uuid, sbi.uuid, sizeof(sbi.uuid));
+		cache_owner.build_time = sbi.build_time;
+		cache_owner.build_time_nsec = sbi.build_time_nsec;
+		cache_owner.checksum = sbi.checksum;
+	}
+
 	return 0;
 error:
 	ctxt.cur_dev = NULL;
@@ -22,6 +22,7 @@
 #include <blk.h>
 #include <ext_common.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <memalign.h>
@@ -1995,6 +1996,249 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/* Extents longer than this are unwritten and read as zeroes */
+#define EXT4_EXT_INIT_MAX_LEN	(1U << 15)
+
+/**
+ * struct ext4_run_cache - runs of the last extent-mapped file read
+ *
+ * fs_read() mounts the filesystem again for every call, so this is kept
+ * across mounts and records enough to tell whether it is the same inode.
+ *
+ * @dev_desc: Block device holding the filesystem
+ * @part_offset: Start of the partition, in sectors
+ * @uuid: UUID of the filesystem
+ * @ino: Inode number
+ * @inode: Copy of the inode
+ * @runs: Runs found so far, sorted by file block
+ * @count: Number of runs in @runs
+ * @max: Number of runs allocated
+ */
+struct ext4_run_cache {
+	struct blk_desc *dev_desc;
+	lbaint_t part_offset;
+	__le32 uuid[4];
+	int ino;
+	struct ext2_inode inode;
+	struct ext4_run *runs;
+	int count;
+	int max;
+};
+
+static struct ext4_run_cache ext4_runs;
+
+void ext4fs_drop_runs(void)
+{
+	free(ext4_runs.runs);
+	memset(&ext4_runs, '\0', sizeof(ext4_runs));
+}
+
+void ext4fs_invalidate(struct blk_desc *desc)
+{
+	if (!desc || ext4_runs.dev_desc == desc)
+		ext4fs_drop_runs();
+}
+
+/* Find the cached run holding @fileblock, dropping the runs of other inodes */
+static struct ext4_run *ext4fs_find_run(struct ext2fs_node *node,
+					uint32_t fileblock)
+{
+	struct ext4_run_cache *rc = &ext4_runs;
+	int lo = 0, hi, mid;
+
+	if (rc->dev_desc != get_fs()->dev_desc ||
+	    rc->part_offset != part_offset || rc->ino != node->ino ||
+	    memcmp(rc->uuid, ext4fs_root->sblock.unique_id,
+		   sizeof(rc->uuid)) ||
+	    memcmp(&rc->inode, &node->inode, sizeof(rc->inode))) {
+		ext4fs_drop_runs();
+		rc->dev_desc = get_fs()->dev_desc;
+		rc->part_offset = part_offset;
+		memcpy(rc->uuid, ext4fs_root->sblock.unique_id,
+		       sizeof(rc->uuid));
+		rc->ino = node->ino;
+		rc->inode = node->inode;
+		return NULL;
+	}
+
+	hi = rc->count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (fileblock < rc->runs[mid].lblk)
+			hi = mid;
+		else if (fileblock - rc->runs[mid].lblk >= rc->runs[mid].len)
+			lo = mid + 1;
+		else
+			return &rc->runs[mid];
+	}
+
+	return NULL;
+}
+
+/* Add a run found in the extent tree, keeping the runs sorted */
+static void ext4fs_add_run(const struct ext4_run *run)
+{
+	struct ext4_run_cache *rc = &ext4_runs;
+	struct ext4_run *runs;
+	int i;
+
+	if (rc->count == rc->max) {
+		runs = realloc(rc->runs, (rc->max + 16) * sizeof(*runs));
+		if (!runs)
+			return;
+		rc->runs = runs;
+		rc->max += 16;
+	}
+	for (i = rc->count; i && rc->runs[i - 1].lblk > run->lblk; i--)
+		rc->runs[i] = rc->runs[i - 1];
+	rc->runs[i] = *run;
+	rc->count++;
+}
+
+static uint64_t ext4fs_extent_start(const struct ext4_extent *ext)
+{
+	return (uint64_t)le16_to_cpu(ext->ee_start_hi) << 32 |
+		le32_to_cpu(ext->ee_start_lo);
+}
+
+/*
+ * Walk the extent tree down to the run holding @fileblock. Extents in the
+ * same leaf which carry on where the previous one ends are merged, and a
+ * hole runs up to the next extent, if known.
+ */
+static int ext4fs_find_extent(struct ext2_inode *inode, uint32_t fileblock,
+			      struct ext_block_cache *cache,
+			      struct ext4_run *run)
+{
+	struct ext4_extent_header *eh;
+	struct ext4_extent_idx *idx;
+	struct ext4_extent *ext;
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	uint32_t next = UINT32_MAX;
+	uint32_t start, len;
+	uint64_t block;
+	int entries, i;
+
+	eh = (struct ext4_extent_header *)inode->b.blocks.dir_blocks;
+	while (1) {
+		if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC)
+			return -EINVAL;
+		entries = le16_to_cpu(eh->eh_entries);
+		if (!eh->eh_depth)
+			break;
+		if (!entries)
+			return -EINVAL;
+
+		/* A file block before the first index is in a hole */
+		idx = (struct ext4_extent_idx *)(eh + 1);
+		for (i = 0; i + 1 < entries; i++) {
+			if (fileblock < le32_to_cpu(idx[i + 1].ei_block))
+				break;
+		}
+		if (i + 1 < entries)
+			next = min(next, le32_to_cpu(idx[i + 1].ei_block));
+		block = (uint64_t)le16_to_cpu(idx[i].ei_leaf_hi) << 32 |
+			le32_to_cpu(idx[i].ei_leaf_lo);
+		if (!ext_cache_read(cache, (lbaint_t)block << log2_blksz, blksz))
+			return -EIO;
+		eh = (struct ext4_extent_header *)cache->buf;
+	}
+
+	ext = (struct ext4_extent *)(eh + 1);
+	for (i = 0; i < entries; i++) {
+		start = le32_to_cpu(ext[i].ee_block);
+		len = le16_to_cpu(ext[i].ee_len);
+		if (fileblock < start) {
+			next = start;
+			break;
+		}
+		if (len > EXT4_EXT_INIT_MAX_LEN)
+			len -= EXT4_EXT_INIT_MAX_LEN;
+		if (fileblock - start >= len)
+			continue;
+
+		run->lblk = start;
+		run->len = len;
+		run->pblk = 0;
+		if (le16_to_cpu(ext[i].ee_len) > EXT4_EXT_INIT_MAX_LEN)
+			return 0;
+		run->pblk = ext4fs_extent_start(&ext[i]);
+		for (i++; i < entries; i++) {
+			len = le16_to_cpu(ext[i].ee_len);
+			if (le32_to_cpu(ext[i].ee_block) !=
+			    run->lblk + run->len ||
+			    len > EXT4_EXT_INIT_MAX_LEN ||
+			    ext4fs_extent_start(&ext[i]) !=
+			    run->pblk + run->len)
+				break;
+			run->len += len;
+		}
+
+		return 0;
+	}
+
+	run->lblk = fileblock;
+	run->pblk = 0;
+	run->len = next - fileblock;
+
+	return 0;
+}
+
+int ext4fs_get_run(struct ext2fs_node *node, uint32_t fileblock,
+		   uint32_t max, struct ext_block_cache *cache,
+		   struct ext4_run *run)
+{
+	struct ext2_inode *inode = &node->inode;
+	struct ext4_run *found = NULL;
+	bool is_file;
+	long int blknr;
+	int ret;
+
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
+		/* Looking up a path must not drop the runs of the file read */
+		is_file = S_ISREG(le16_to_cpu(inode->mode));
+		if (is_file)
+			found = ext4fs_find_run(node, fileblock);
+		if (found) {
+			*run = *found;
+		} else {
+			ret = ext4fs_find_extent(inode, fileblock, cache, run);
+			if (ret) {
+				printf("invalid extent block\n");
+				return ret;
+			}
+			if (is_file)
+				ext4fs_add_run(run);
+		}
+
+		/* Start the run at @fileblock */
+		if (run->pblk)
+			run->pblk += fileblock - run->lblk;
+		run->len -= fileblock - run->lblk;
+		run->lblk = fileblock;
+	} else {
+		blknr = read_allocated_block(inode, fileblock, cache);
+		if (blknr < 0)
+			return -EIO;
+		run->lblk = fileblock;
+		run->pblk = blknr;
+		for (run->len = 1; run->len < max; run->len++) {
+			blknr = read_allocated_block(inode,
+						     fileblock + run->len,
+						     cache);
+			if (blknr < 0)
+				return -EIO;
+			if (run->pblk ? blknr != run->pblk + run->len : blknr)
+				break;
+		}
+	}
+	run->len = min(run->len, max);
+
+	return 0;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2336,16 +2580,26 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 int ext4fs_open(const char *filename, loff_t *len)
 {
 	struct ext2fs_node *fdiro = NULL;
+	u64 ino;
 	int status;
 
 	if (ext4fs_root == NULL)
 		return -1;
 
 	ext4fs_file = NULL;
-	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
-				  FILETYPE_REG);
-	if (status == 0)
-		goto fail;
+	if (fs_cache_get_handle(filename, &ino)) {
+		fdiro = zalloc(sizeof(struct ext2fs_node));
+		if (!fdiro)
+			return -1;
+		fdiro->data = ext4fs_root;
+		fdiro->ino = ino;
+	} else {
+		status = ext4fs_find_file(filename, &ext4fs_root->diropen,
+					  &fdiro, FILETYPE_REG);
+		if (status == 0)
+			goto fail;
+		fs_cache_set_handle(filename, fdiro->ino);
+	}
 
 	if (!fdiro->inode_read) {
 		status = ext4fs_read_inode(fdiro->data, fdiro->ino,
@@ -48,8 +48,48 @@ static inline void *zalloc(size_t size)
 	return p;
 }
 
+/**
+ * struct ext4_run - file blocks which follow each other on disk
+ *
+ * @lblk: First file block
+ * @pblk: Filesystem block holding @lblk, or 0 for a hole
+ * @len: Number of blocks
+ */
+struct ext4_run {
+	uint32_t lblk;
+	uint64_t pblk;
+	uint32_t len;
+};
+
 int ext4fs_read_inode(struct ext2_data *data, int ino,
 		      struct ext2_inode *inode);
+
+/**
+ * ext4fs_get_run() - Find the run of blocks starting at a file block
+ *
+ * For extent-mapped regular files the runs are cached, as long as the inode
+ * is not changed, so that reading a file in several calls only walks the
+ * extent tree once. Directories are not cached, so that looking up the file
+ * again does not drop its runs.
+ *
+ * @node: File to look in
+ * @fileblock: First file block of the run
+ * @max: Maximum number of blocks to return
+ * @cache: Cache to use for reading extent and indirect blocks
+ * @run: Returns the run, which starts at @fileblock
+ * Return: 0 if OK, -ve on error
+ */
+int ext4fs_get_run(struct ext2fs_node *node, uint32_t fileblock,
+		   uint32_t max, struct ext_block_cache *cache,
+		   struct ext4_run *run);
+
+/**
+ * ext4fs_drop_runs() - Drop the runs cached by ext4fs_get_run()
+ *
+ * This must be called before changing the filesystem, or after the device
+ * is written behind its back (see ext4fs_invalidate()).
+ */
+void ext4fs_drop_runs(void);
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos, loff_t len,
 		     char *buf, loff_t *actread);
 int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
@@ -29,6 +29,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <uuid.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -45,142 +46,66 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 }
 
 /*
- * Taken from openmoko-kernel mailing list: By Andy green
- * Optimized read file API : collects and defers contiguous sector
- * reads into one potentially more efficient larger sequential read action
+ * Read a file one run of contiguous blocks at a time, straight into @buf,
+ * so that each run takes a single device read
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
-	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
-	lbaint_t delayed_next = 0;
-	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
+	/* Keep each read within the int that ext4fs_devread() takes */
+	uint32_t max_blocks = SZ_1G / blocksize;
+	uint32_t fileblock, blockcnt;
 	struct ext_block_cache cache;
-
-	ext_cache_init(&cache);
+	struct ext4_run run;
+	loff_t left, bytes;
+	int skipfirst;
+	int ret = 0;
 
 	/* Adjust len so it we can't read past the end of the file. */
 	if (len + pos > filesize)
 		len = (filesize - pos);
 
-	if (blocksize <= 0 || len <= 0) {
-		ext_cache_fini(&cache);
+	if (blocksize <= 0 || len <= 0)
 		return -1;
-	}
 
+	ext_cache_init(&cache);
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
-
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
-		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
-		if (blknr < 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-
-		blknr = blknr << log2_fs_blocksize;
-
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
-
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
+	fileblock = lldiv(pos, blocksize);
+	skipfirst = pos - ((loff_t)fileblock << (log2_fs_blocksize + log2blksz));
+
+	for (left = len; left; left -= bytes) {
+		if (ext4fs_get_run(node, fileblock,
+				   min(blockcnt - fileblock, max_blocks),
+				   &cache, &run)) {
+			ret = -1;
+			break;
 		}
-		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
-			}
-		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
+		bytes = ((loff_t)run.len << (log2_fs_blocksize + log2blksz)) -
+			skipfirst;
+		if (bytes > left)
+			bytes = left;
+		if (!run.pblk) {
+			memset(buf, 0, bytes);
+		} else if (!ext4fs_devread((lbaint_t)run.pblk <<
+					   log2_fs_blocksize, skipfirst, bytes,
+					   buf)) {
+			ret = -1;
+			break;
 		}
-		buf += blocksize - skipfirst;
+		buf += bytes;
+		fileblock += run.len;
+		skipfirst = 0;
 	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-		previous_block_number = -1;
-	}
-
-	*actread  = len;
 	ext_cache_fini(&cache);
-	return 0;
+	if (!ret)
+		*actread = len;
+
+	return ret;
 }
 
 int ext4fs_ls(const char *dirname)
@@ -220,6 +145,74 @@ int ext4fs_size(const char *filename, loff_t *size)
 	return ext4fs_open(filename, size);
 }
 
+/* Look up a file and keep its node, for reading it many times */
+int ext4fs_open_file(const char *filename, void **handlep, loff_t *sizep)
+{
+	if (ext4fs_open(filename, sizep) < 0)
+		return -ENOENT;
+
+	*handlep = ext4fs_file;
+	ext4fs_file = NULL;
+
+	return 0;
+}
+
+int ext4fs_pread(void *handle, void *buf, loff_t offset, loff_t len,
+		 loff_t *actread)
+{
+	if (ext4fs_root == NULL)
+		return -1;
+
+	return ext4fs_read_file(handle, offset, len, buf, actread);
+}
+
+void ext4fs_release(void *handle)
+{
+	ext4fs_free_node(handle, &ext4fs_root->diropen);
+}
+
+int ext4fs_map(const char *filename, loff_t offset, loff_t len, loff_t *posp)
+{
+	struct ext2fs_node *node;
+	struct ext_block_cache cache;
+	struct ext4_run run;
+	uint32_t fileblock, blockcnt;
+	uint64_t pblk = 0;
+	loff_t size;
+	int blocksize;
+	int ret;
+
+	if (!ext4fs_root)
+		return -ENODEV;
+	ret = ext4fs_open_file(filename, (void **)&node, &size);
+	if (ret)
+		return ret;
+	blocksize = EXT2_BLOCK_SIZE(node->data);
+	blockcnt = lldiv(offset + len + blocksize - 1, blocksize);
+	fileblock = lldiv(offset, blocksize);
+
+	/* The blocks may be in several runs, but they must follow on */
+	ext_cache_init(&cache);
+	for (ret = -ENXIO; fileblock < blockcnt; fileblock += run.len) {
+		if (ext4fs_get_run(node, fileblock, blockcnt - fileblock,
+				   &cache, &run)) {
+			ret = -EIO;
+			break;
+		}
+		if (!run.pblk || (pblk && run.pblk != pblk))
+			break;
+		if (!pblk)
+			*posp = run.pblk * blocksize + offset % blocksize;
+		pblk = run.pblk + run.len;
+		if (fileblock + run.len >= blockcnt)
+			ret = 0;
+	}
+	ext_cache_fini(&cache);
+	ext4fs_release(node);
+
+	return ret;
+}
+
 int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread)
 {
 	if (ext4fs_root == NULL || ext4fs_file == NULL)
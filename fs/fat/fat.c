@@ -16,12 +16,14 @@
 #include <fs.h>
 #include <log.h>
 #include <asm/byteorder.h>
+#include <asm/unaligned.h>
 #include <part.h>
 #include <malloc.h>
 #include <memalign.h>
 #include <asm/cache.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
@@ -196,12 +198,12 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
+		__u32 getsize = mydata->fatbufblocks;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+		__u32 startblock = bufnum * mydata->fatbufblocks;
 
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+		/* Cap length if fatlength is not a multiple of fatbufblocks */
 		if (startblock + getsize > fatlength)
 			getsize = fatlength - startblock;
 
@@ -304,6 +306,180 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Read the whole FAT into fatbuf from now on, if it is small enough, so that
+ * following a long cluster chain does not read it a few sectors at a time.
+ */
+static void get_whole_fat(fsdata *mydata)
+{
+	__u8 *buf;
+
+	if (mydata->fatbufblocks == mydata->fatlength ||
+	    (u64)mydata->fatlength * mydata->sect_size > MAX_FATCACHE)
+		return;
+
+	/* Write back the fatbuf to the disk */
+	if (flush_dirty_fat_buffer(mydata) < 0)
+		return;
+
+	buf = malloc_cache_aligned(mydata->fatlength * mydata->sect_size);
+	if (!buf)
+		return;
+	free(mydata->fatbuf);
+	mydata->fatbuf = buf;
+	mydata->fatbufblocks = mydata->fatlength;
+	mydata->fatbufnum = -1;
+}
+
+/**
+ * struct fat_run - clusters of a file which follow each other on the disk
+ *
+ * @index:	index of the first cluster within the file
+ * @clust:	first cluster
+ * @count:	number of clusters
+ */
+struct fat_run {
+	__u32 index;
+	__u32 clust;
+	__u32 count;
+};
+
+/**
+ * struct fat_run_map - where the clusters of the last file read are
+ *
+ * fs_read() mounts the filesystem again for every call, so this is kept
+ * across mounts and records enough to tell whether it is the same file. It
+ * is dropped whenever the FAT is changed.
+ *
+ * @dev:	block device holding the filesystem
+ * @part_start:	start of the partition, in sectors
+ * @volume_id:	volume ID of the filesystem
+ * @start:	first cluster of the file
+ * @size:	size of the file in bytes
+ * @runs:	runs found so far, in file order
+ * @count:	number of runs in @runs
+ * @max:	number of runs allocated
+ * @mapped:	number of clusters covered by @runs
+ * @next:	cluster following the last one in @runs
+ */
+struct fat_run_map {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	u32 volume_id;
+	__u32 start;
+	__u32 size;
+	struct fat_run *runs;
+	int count;
+	int max;
+	__u32 mapped;
+	__u32 next;
+};
+
+static struct fat_run_map fat_runs;
+
+static void fat_drop_runs(void)
+{
+	free(fat_runs.runs);
+	memset(&fat_runs, '\0', sizeof(fat_runs));
+}
+
+void fat_invalidate(struct blk_desc *desc)
+{
+	if (!desc || fat_runs.dev == desc)
+		fat_drop_runs();
+}
+
+/**
+ * fat_map_file() - find where the clusters of a file are
+ *
+ * The cluster chain is followed up to cluster @nclust, carrying on from
+ * where the last call for the same file stopped.
+ *
+ * @mydata:	filesystem description
+ * @dentptr:	directory entry of the file
+ * @nclust:	number of clusters needed from the start of the file
+ * Return:	0 if OK, -1 on error
+ */
+static int fat_map_file(fsdata *mydata, dir_entry *dentptr, __u32 nclust)
+{
+	struct fat_run_map *map = &fat_runs;
+	struct fat_run *run;
+	__u32 clust, next;
+
+	if (map->dev != cur_dev || map->part_start != cur_part_info.start ||
+	    map->volume_id != mydata->volume_id ||
+	    map->start != START(dentptr) ||
+	    map->size != FAT2CPU32(dentptr->size)) {
+		fat_drop_runs();
+		map->dev = cur_dev;
+		map->part_start = cur_part_info.start;
+		map->volume_id = mydata->volume_id;
+		map->start = START(dentptr);
+		map->size = FAT2CPU32(dentptr->size);
+		map->next = map->start;
+	}
+	if (map->mapped >= nclust)
+		return 0;
+	if (nclust - map->mapped > 1)
+		get_whole_fat(mydata);
+
+	while (map->mapped < nclust) {
+		clust = map->next;
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			printf("Invalid FAT entry\n");
+			fat_drop_runs();
+			return -1;
+		}
+		if (map->count == map->max) {
+			run = realloc(map->runs, (map->max + 16) * sizeof(*run));
+			if (!run) {
+				printf("Error: allocating cluster map\n");
+				fat_drop_runs();
+				return -1;
+			}
+			map->runs = run;
+			map->max += 16;
+		}
+		run = &map->runs[map->count++];
+		run->index = map->mapped;
+		run->clust = clust;
+		run->count = 1;
+
+		/* search for consecutive clusters */
+		while (1) {
+			next = get_fatent(mydata, clust + run->count - 1);
+			if (next != clust + run->count ||
+			    map->mapped + run->count >= nclust)
+				break;
+			run->count++;
+		}
+		map->mapped += run->count;
+		map->next = next;
+	}
+
+	return 0;
+}
+
+/* Find the run holding cluster @index of the file, which must be mapped */
+static struct fat_run *fat_find_run(__u32 index)
+{
+	int lo = 0, hi = fat_runs.count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (index < fat_runs.runs[mid].index)
+			hi = mid;
+		else if (index - fat_runs.runs[mid].index >=
+			 fat_runs.runs[mid].count)
+			lo = mid + 1;
+		else
+			return &fat_runs.runs[mid];
+	}
+
+	return NULL;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -311,6 +487,8 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * into 'buffer'. Update the number of bytes read in *gotsize or return -1 on
  * fatal errors.
  *
+ * Each run of consecutive clusters is read with a single disk access.
+ *
  * @mydata:	file system description
  * @dentprt:	directory entry pointer
  * @pos:	position from where to read
@@ -324,8 +502,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_run *run;
+	__u32 index, offset, clust;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -341,101 +519,57 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
-	}
+	if (fat_map_file(mydata, dentptr,
+			 div_u64(filesize + bytesperclust - 1, bytesperclust)))
+		return -1;
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	index = div_u64_rem(pos, bytesperclust, &offset);
 
 	/* align to beginning of next cluster if any */
-	if (pos) {
+	if (offset) {
 		__u8 *tmp_buffer;
 
-		actsize = min(filesize, (loff_t)bytesperclust);
+		run = fat_find_run(index);
+		clust = run->clust + index - run->index;
+		actsize = min(filesize - pos + offset, (loff_t)bytesperclust);
 		tmp_buffer = malloc_cache_aligned(actsize);
 		if (!tmp_buffer) {
 			debug("Error: allocating buffer\n");
 			return -1;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, clust, tmp_buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
 		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
+		actsize -= offset;
+		memcpy(buffer, tmp_buffer + offset, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
+		pos += actsize;
+		index++;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
+	while (pos < filesize) {
+		run = fat_find_run(index);
+		clust = run->clust + index - run->index;
+		actsize = (loff_t)(run->count - (index - run->index)) *
+			bytesperclust;
+		actsize = min(actsize, filesize - pos);
 
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, clust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
 		buffer += actsize;
+		pos += actsize;
+		index = run->index + run->count;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -623,7 +757,9 @@ static int get_fs_info(fsdata *mydata)
 		mydata->root_cluster = 0;
 	}
 
+	mydata->volume_id = get_unaligned_le32(volinfo.volume_id);
 	mydata->fatbufnum = -1;
+	mydata->fatbufblocks = FATBUFBLOCKS;
 	mydata->fat_dirty = 0;
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
@@ -1243,9 +1379,62 @@ out_free_itr:
 	return ret;
 }
 
+/* Get the handle kept by the file lookup cache for a directory entry */
+static u64 fat_dent_handle(fsdata *mydata, dir_entry *dentptr)
+{
+	return (u64)START(dentptr) << 32 | FAT2CPU32(dentptr->size);
+}
+
 int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 		     loff_t maxsize, loff_t *actread)
 {
+	dir_entry dent, *dentptr;
+	fsdata fsdata;
+	fat_itr *itr;
+	u64 handle;
+	int ret;
+
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!itr)
+		return -ENOMEM;
+	ret = fat_itr_root(itr, &fsdata);
+	if (ret)
+		goto out_free_itr;
+
+	/*
+	 * The file lookup cache holds the start cluster and size of the file,
+	 * which is all that get_contents() needs
+	 */
+	if (fs_cache_get_handle(filename, &handle)) {
+		memset(&dent, '\0', sizeof(dent));
+		dent.start = cpu_to_le16((handle >> 32) & 0xffff);
+		dent.starthi = cpu_to_le16(handle >> 48);
+		dent.size = cpu_to_le32((u32)handle);
+		dentptr = &dent;
+	} else {
+		ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+		if (ret)
+			goto out_free_both;
+		dentptr = itr->dent;
+		fs_cache_set_handle(filename, fat_dent_handle(&fsdata, dentptr));
+	}
+
+	debug("reading %s at pos %llu\n", filename, pos);
+
+	ret = get_contents(&fsdata, dentptr, pos, buffer, maxsize, actread);
+
+out_free_both:
+	free(fsdata.fatbuf);
+out_free_itr:
+	free(itr);
+	return ret;
+}
+
+int fat_map(const char *filename, loff_t offset, loff_t len, loff_t *posp)
+{
+	unsigned int bytesperclust;
+	struct fat_run *run;
+	__u32 index, rem, nclust, clust;
 	fsdata fsdata;
 	fat_itr *itr;
 	int ret;
@@ -1261,12 +1450,27 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	if (ret)
 		goto out_free_both;
 
-	debug("reading %s at pos %llu\n", filename, pos);
-
-	/* For saving default max clustersize memory allocated to malloc pool */
-	dir_entry *dentptr = itr->dent;
+	bytesperclust = fsdata.clust_size * fsdata.sect_size;
+	nclust = div_u64(offset + len + bytesperclust - 1, bytesperclust);
+	if (fat_map_file(&fsdata, itr->dent, nclust)) {
+		ret = -EIO;
+		goto out_free_both;
+	}
 
-	ret = get_contents(&fsdata, dentptr, pos, buffer, maxsize, actread);
+	index = div_u64_rem(offset, bytesperclust, &rem);
+	run = fat_find_run(index);
+	clust = run->clust + index - run->index;
+	*posp = (loff_t)clust_to_sect(&fsdata, clust) * fsdata.sect_size + rem;
+	ret = 0;
+
+	/* Runs can be split where the map was extended, so join them up */
+	while (run->index + run->count < nclust) {
+		if (run[1].clust != run->clust + run->count) {
+			ret = -ENXIO;
+			break;
+		}
+		run++;
+	}
 
 out_free_both:
 	free(fsdata.fatbuf);
@@ -212,10 +212,10 @@ static int disk_write(__u32 block, __u32 nr_blocks, void *buf)
  */
 static int flush_dirty_fat_buffer(fsdata *mydata)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
+	int getsize = mydata->dirty_last - mydata->dirty_first + 1;
+	__u8 *bufptr = mydata->fatbuf + mydata->dirty_first * mydata->sect_size;
+	__u32 startblock = mydata->fatbufnum * mydata->fatbufblocks +
+		mydata->dirty_first;
 
 	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
 	      (int)mydata->fat_dirty);
@@ -223,10 +223,7 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
 		return 0;
 
-	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-	if (startblock + getsize > fatlength)
-		getsize = fatlength - startblock;
-
+	/* Only the sectors which were modified are written */
 	startblock += mydata->fat_sect;
 
 	/* Write FAT buf */
@@ -430,6 +427,22 @@ fill_dir_slot(fat_itr *itr, const char *l_name, const char *shortname)
 	return 0;
 }
 
+/* Mark @len bytes at @offset in fatbuf as needing to be written back */
+static void mark_fat_dirty(fsdata *mydata, __u32 offset, __u32 len)
+{
+	__u32 first = offset / mydata->sect_size;
+	__u32 last = (offset + len - 1) / mydata->sect_size;
+
+	if (!mydata->fat_dirty) {
+		mydata->dirty_first = first;
+		mydata->dirty_last = last;
+		mydata->fat_dirty = 1;
+		return;
+	}
+	mydata->dirty_first = min(mydata->dirty_first, first);
+	mydata->dirty_last = max(mydata->dirty_last, last);
+}
+
 /*
  * Set the entry at index 'entry' in a FAT (12/16/32) table.
  */
@@ -458,12 +471,12 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
+		int getsize = mydata->fatbufblocks;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+		__u32 startblock = bufnum * mydata->fatbufblocks;
 
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+		/* Cap length if fatlength is not a multiple of fatbufblocks */
 		if (startblock + getsize > fatlength)
 			getsize = fatlength - startblock;
 
@@ -479,19 +492,24 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		mydata->fatbufnum = bufnum;
 	}
 
-	/* Mark as dirty */
-	mydata->fat_dirty = 1;
+	/* The cluster chains of files are changing */
+	fat_drop_runs();
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
 		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		mark_fat_dirty(mydata, offset * 4, 4);
 		break;
 	case 16:
 		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		mark_fat_dirty(mydata, offset * 2, 2);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
+		/* Entries 0 and 3 of each group of four fit in one word */
+		mark_fat_dirty(mydata, off16 * 2,
+			       (offset & 0x3) % 3 ? 4 : 2);
 
 		switch (offset & 0x3) {
 		case 0:
@@ -1351,6 +1369,10 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 		goto exit;
 	}
 
+	/* Clusters are allocated by scanning the FAT, so keep it in memory */
+	if (size)
+		get_whole_fat(mydata);
+
 	retdent = find_directory_entry(itr, l_filename);
 
 	if (retdent) {
@@ -1456,6 +1478,7 @@ static int fat_dir_entries(fat_itr *itr)
 	fsdata = *dirs->fsdata;
 
 	/* allocate local fat buffer */
+	fsdata.fatbufblocks = FATBUFBLOCKS;
 	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (!fsdata.fatbuf) {
 		debug("Error: allocating memory\n");
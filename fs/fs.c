@@ -13,11 +13,13 @@
 #include <env.h>
 #include <lmb.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <image.h>
 #include <sandboxfs.h>
 #include <semihostingfs.h>
 #include <ubifs_uboot.h>
@@ -29,6 +31,7 @@
 #include <efi_loader.h>
 #include <squashfs.h>
 #include <erofs.h>
+#include <linux/list.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -180,6 +183,25 @@ struct fstype_info {
 	int (*unlink)(const char *filename);
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
+	/*
+	 * Optional: look up a file once so that it can be read many times.
+	 * On success return 0, an opaque handle via 'handlep' and the size
+	 * of the file via 'sizep'. On error return -errno. See fs_file_open().
+	 */
+	int (*open)(const char *filename, void **handlep, loff_t *sizep);
+	/* Read from a file opened by open(), only called with len > 0 */
+	int (*pread)(void *handle, void *buf, loff_t offset, loff_t len,
+		     loff_t *actread);
+	/* Drop a handle returned by open() */
+	void (*release)(void *handle);
+	/*
+	 * Optional: find where part of a file is stored. If the 'len' bytes
+	 * at 'offset' are held in one piece on the device, as they are, return
+	 * 0 and their byte position in the partition via 'posp'. Return
+	 * -ENXIO if they are not, or -errno on error. See fs_map().
+	 */
+	int (*map)(const char *filename, loff_t offset, loff_t len,
+		   loff_t *posp);
 };
 
 static struct fstype_info fstypes[] = {
@@ -208,6 +230,7 @@ static struct fstype_info fstypes[] = {
 		.readdir = fat_readdir,
 		.closedir = fat_closedir,
 		.ln = fs_ln_unsupported,
+		.map = fat_map,
 	},
 #endif
 
@@ -233,6 +256,10 @@ static struct fstype_info fstypes[] = {
 		.opendir = fs_opendir_unsupported,
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
+		.open = ext4fs_open_file,
+		.pread = ext4fs_pread,
+		.release = ext4fs_release,
+		.map = ext4fs_map,
 	},
 #endif
 #ifdef CONFIG_SANDBOX
@@ -416,6 +443,122 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+/**
+ * struct fs_mount - a filesystem which stays mounted between calls
+ *
+ * @desc: Block device, NULL once the device has been removed
+ * @part: Partition number, 0 for the whole device
+ * @partition: Partition information
+ * @fstype: Filesystem type (FS_TYPE_...)
+ * @sibling: Node in the list of mounts
+ * @files: Files open on this filesystem (struct fs_file)
+ */
+struct fs_mount {
+	struct blk_desc *desc;
+	int part;
+	struct disk_partition partition;
+	int fstype;
+	struct list_head sibling;
+	struct list_head files;
+};
+
+/**
+ * struct fs_file - a file open on a mounted filesystem
+ *
+ * @mnt: Filesystem holding the file
+ * @sibling: Node in the mount's list of files
+ * @handle: Handle returned by the filesystem's open() method, NULL if none.
+ *	This is only set while @mnt is the active mount.
+ * @size: Size of the file, -1 if not known
+ * @path: Path of the file
+ */
+struct fs_file {
+	struct fs_mount *mnt;
+	struct list_head sibling;
+	void *handle;
+	loff_t size;
+	char path[];
+};
+
+static LIST_HEAD(fs_mounts);
+
+/*
+ * Mount whose state the filesystem driver holds. The fs_...() calls leave it
+ * open when they are done, so the next call on it does not probe it again.
+ */
+static struct fs_mount *fs_active_mount;
+
+/* Stop using the driver state of the active mount, without closing it */
+static void fs_mount_detach(void)
+{
+	struct fs_mount *mnt = fs_active_mount;
+	struct fstype_info *info;
+	struct fs_file *file;
+
+	if (!mnt)
+		return;
+
+	info = fs_get_info(mnt->fstype);
+	list_for_each_entry(file, &mnt->files, sibling) {
+		if (file->handle) {
+			info->release(file->handle);
+			file->handle = NULL;
+		}
+	}
+	fs_active_mount = NULL;
+}
+
+/* Close the active mount, so that another filesystem can be probed */
+static void fs_mount_deactivate(void)
+{
+	struct fs_mount *mnt = fs_active_mount;
+
+	if (!mnt)
+		return;
+
+	fs_mount_detach();
+	fs_get_info(mnt->fstype)->close();
+	fs_type = FS_TYPE_ANY;
+	fs_cache_select(NULL, 0, NULL, FS_TYPE_ANY);
+}
+
+/* Make @mnt the active mount, probing the filesystem again if needed */
+static int fs_mount_activate(struct fs_mount *mnt)
+{
+	if (fs_active_mount == mnt)
+		return 0;
+	if (!mnt->desc)
+		return -ENODEV;
+
+	fs_mount_deactivate();
+	/* Close anything selected by fs_set_blk_dev() and not closed yet */
+	if (fs_type != FS_TYPE_ANY)
+		fs_close();
+
+	if (fs_get_info(mnt->fstype)->probe(mnt->desc, &mnt->partition))
+		return -EIO;
+	fs_active_mount = mnt;
+
+	return 0;
+}
+
+int fs_set_mount(struct fs_mount *mnt)
+{
+	int ret;
+
+	ret = fs_mount_activate(mnt);
+	if (ret)
+		return ret;
+
+	fs_dev_desc = mnt->desc;
+	fs_dev_part = mnt->part;
+	fs_partition = mnt->partition;
+	fs_type = mnt->fstype;
+	fs_cache_select(fs_dev_desc, fs_dev_part, &fs_partition, fs_type);
+
+	return 0;
+}
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -437,6 +580,8 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	}
 #endif
 
+	fs_mount_deactivate();
+
 	part = part_get_info_by_dev_and_name_or_num(ifname, dev_part_str, &fs_dev_desc,
 						    &fs_partition, 1);
 	if (part < 0)
@@ -453,6 +598,8 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_cache_select(fs_dev_desc, part, &fs_partition,
+					fs_type);
 			return 0;
 		}
 	}
@@ -466,6 +613,12 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	struct fstype_info *info;
 	int ret, i;
 
+	/* A mounted filesystem does not need to be probed again */
+	if (fs_active_mount && fs_active_mount->desc == desc &&
+	    fs_active_mount->part == part)
+		return fs_set_mount(fs_active_mount);
+	fs_mount_deactivate();
+
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
 	else
@@ -478,6 +631,8 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_cache_select(fs_dev_desc, part, &fs_partition,
+					fs_type);
 			return 0;
 		}
 	}
@@ -489,9 +644,12 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	/* A mounted filesystem stays open until it is unmounted */
+	if (!fs_active_mount)
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
+	fs_cache_select(NULL, 0, NULL, FS_TYPE_ANY);
 }
 
 int fs_uuid(char *uuid_str)
@@ -520,20 +678,37 @@ int fs_exists(const char *filename)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->exists(filename);
+	if (!fs_cache_get_exists(filename, &ret)) {
+		ret = info->exists(filename);
+		fs_cache_set_exists(filename, ret);
+	}
 
 	fs_close();
 
 	return ret;
 }
 
+/* Get the size of a file, from the lookup cache if possible */
+static int fs_size_cached(struct fstype_info *info, const char *filename,
+			  loff_t *size)
+{
+	int ret;
+
+	if (fs_cache_get_size(filename, size, &ret))
+		return ret;
+	ret = info->size(filename, size);
+	fs_cache_set_size(filename, *size, ret);
+
+	return ret;
+}
+
 int fs_size(const char *filename, loff_t *size)
 {
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->size(filename, size);
+	ret = fs_size_cached(info, filename, size);
 
 	fs_close();
 
@@ -551,7 +726,7 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	loff_t read_len;
 
 	/* get the actual size of the file */
-	ret = info->size(filename, &size);
+	ret = fs_size_cached(info, filename, &size);
 	if (ret)
 		return ret;
 	if (offset >= size) {
@@ -575,6 +750,56 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 }
 #endif
 
+/*
+ * Read a file a piece at a time so that, if it is a FIT, its images can be
+ * hashed while the data is still in the cache. The FIT header is read in one
+ * piece once its size is known. Once the file turns out not to be a FIT, or
+ * to have no external data to hash, the rest of it is read in one go.
+ */
+static int fs_read_stream(struct fstype_info *info, const char *filename,
+			  ulong addr, loff_t offset, loff_t len,
+			  loff_t *actread)
+{
+	loff_t size, pos, chunk, got = 0;
+	void *buf;
+	int ret;
+
+	ret = fs_size_cached(info, filename, &size);
+	if (ret)
+		return ret;
+	if (offset >= size) {
+		/* Let the filesystem report the error */
+		buf = map_sysmem(addr, len);
+		ret = info->read(filename, buf, offset, len, actread);
+		unmap_sysmem(buf);
+		return ret;
+	}
+	size -= offset;
+	if (len && len < size)
+		size = len;
+
+	fit_stream_load_start(addr);
+	for (pos = 0; pos < size; pos += got) {
+		chunk = size - pos;
+		if (fit_stream_load_active())
+			chunk = min_t(loff_t, chunk, fit_stream_load_want());
+		buf = map_sysmem(addr + pos, chunk);
+		ret = info->read(filename, buf, offset + pos, chunk, &got);
+		unmap_sysmem(buf);
+		if (ret)
+			break;
+		fit_stream_load_data(pos, got);
+		if (got != chunk) {
+			pos += got;
+			break;
+		}
+	}
+	fit_stream_load_end();
+	*actread = pos;
+
+	return ret;
+}
+
 static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 		    int do_lmb_check, loff_t *actread)
 {
@@ -594,9 +819,17 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * We don't actually know how many bytes are being read, since len==0
 	 * means read the whole file.
 	 */
-	buf = map_sysmem(addr, len);
-	ret = info->read(filename, buf, offset, len, actread);
-	unmap_sysmem(buf);
+	/* squashfs cannot read from an offset, so the file must be read whole */
+	if (CONFIG_IS_ENABLED(FIT_STREAM_VERIFY) && do_lmb_check &&
+	    info->fstype != FS_TYPE_SQUASHFS) {
+		ret = fs_read_stream(info, filename, addr, offset, len,
+				     actread);
+	} else {
+		fit_stream_drop();
+		buf = map_sysmem(addr, len);
+		ret = info->read(filename, buf, offset, len, actread);
+		unmap_sysmem(buf);
+	}
 
 	/* If we requested a specific number of bytes, check we got it */
 	if (ret == 0 && len && *actread != len)
@@ -612,6 +845,50 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+int fs_map(const char *filename, loff_t offset, loff_t len, void **bufp,
+	   loff_t *actmap)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	lbaint_t start, blkcnt;
+	loff_t size, pos;
+	void *buf;
+	int ret;
+
+	if (!info->map || !fs_dev_desc) {
+		ret = -ENOSYS;
+		goto out;
+	}
+	ret = fs_size_cached(info, filename, &size);
+	if (ret)
+		goto out;
+	if (offset >= size) {
+		ret = -ENXIO;
+		goto out;
+	}
+	if (!len || len > size - offset)
+		len = size - offset;
+
+	ret = info->map(filename, offset, len, &pos);
+	if (ret)
+		goto out;
+	start = pos >> fs_dev_desc->log2blksz;
+	blkcnt = ((pos & (fs_dev_desc->blksz - 1)) + len +
+		  fs_dev_desc->blksz - 1) >> fs_dev_desc->log2blksz;
+	if (start + blkcnt > fs_partition.size) {
+		ret = -ERANGE;
+		goto out;
+	}
+	ret = blk_dmap(fs_dev_desc, fs_partition.start + start, blkcnt, &buf);
+	if (ret)
+		goto out;
+	*bufp = buf + (pos & (fs_dev_desc->blksz - 1));
+	*actmap = len;
+out:
+	fs_close();
+
+	return ret;
+}
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -622,6 +899,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	buf = map_sysmem(addr, len);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
+	fs_invalidate(fs_dev_desc);
 
 	if (ret < 0 && len != *actwrite) {
 		log_err("** Unable to write file %s **\n", filename);
@@ -691,6 +969,7 @@ int fs_unlink(const char *filename)
 	struct fstype_info *info = fs_get_info(fs_type);
 
 	ret = info->unlink(filename);
+	fs_invalidate(fs_dev_desc);
 
 	fs_close();
 
@@ -704,6 +983,7 @@ int fs_mkdir(const char *dirname)
 	struct fstype_info *info = fs_get_info(fs_type);
 
 	ret = info->mkdir(dirname);
+	fs_invalidate(fs_dev_desc);
 
 	fs_close();
 
@@ -716,6 +996,7 @@ int fs_ln(const char *fname, const char *target)
 	int ret;
 
 	ret = info->ln(fname, target);
+	fs_invalidate(fs_dev_desc);
 
 	if (ret < 0) {
 		log_err("** Unable to create link %s -> %s **\n", fname, target);
@@ -726,6 +1007,218 @@ int fs_ln(const char *fname, const char *target)
 	return ret;
 }
 
+/* Drop what is known about the files of @mnt, closing it if active */
+static void fs_mount_forget(struct fs_mount *mnt)
+{
+	struct fs_file *file;
+
+	list_for_each_entry(file, &mnt->files, sibling)
+		file->size = -1;
+	if (mnt != fs_active_mount)
+		return;
+	/* If an fs_...() call is in progress, its fs_close() closes it */
+	if (fs_type != FS_TYPE_ANY)
+		fs_mount_detach();
+	else
+		fs_mount_deactivate();
+}
+
+void fs_invalidate(struct blk_desc *desc)
+{
+	struct fs_mount *mnt;
+
+	fs_cache_invalidate(desc);
+	if (CONFIG_IS_ENABLED(FS_FAT))
+		fat_invalidate(desc);
+	if (CONFIG_IS_ENABLED(FS_EXT4))
+		ext4fs_invalidate(desc);
+
+	list_for_each_entry(mnt, &fs_mounts, sibling) {
+		if (!desc || mnt->desc == desc)
+			fs_mount_forget(mnt);
+	}
+}
+
+void fs_remove_dev(struct blk_desc *desc)
+{
+	struct fs_mount *mnt;
+
+	fs_invalidate(desc);
+	/* Files stay open until their owner closes them, but cannot be read */
+	list_for_each_entry(mnt, &fs_mounts, sibling) {
+		if (mnt->desc == desc)
+			mnt->desc = NULL;
+	}
+}
+
+int fs_mount(struct blk_desc *desc, int part, struct fs_mount **mntp)
+{
+	struct fs_mount *mnt;
+
+	mnt = calloc(1, sizeof(*mnt));
+	if (!mnt)
+		return -ENOMEM;
+
+	fs_mount_deactivate();
+	if (fs_set_blk_dev_with_part(desc, part)) {
+		free(mnt);
+		return -ENODEV;
+	}
+	mnt->desc = desc;
+	mnt->part = part;
+	mnt->partition = fs_partition;
+	mnt->fstype = fs_type;
+	INIT_LIST_HEAD(&mnt->files);
+	list_add(&mnt->sibling, &fs_mounts);
+
+	/* Keep the filesystem open for the next call */
+	fs_active_mount = mnt;
+	fs_close();
+	*mntp = mnt;
+
+	return 0;
+}
+
+void fs_unmount(struct fs_mount *mnt)
+{
+	struct fs_file *file, *next;
+
+	if (!mnt)
+		return;
+
+	if (mnt == fs_active_mount)
+		fs_mount_deactivate();
+	list_for_each_entry_safe(file, next, &mnt->files, sibling) {
+		list_del(&file->sibling);
+		free(file);
+	}
+	list_del(&mnt->sibling);
+	free(mnt);
+}
+
+void fs_detach(struct fs_mount *mnt)
+{
+	if (!mnt)
+		return;
+
+	fs_mount_forget(mnt);
+	mnt->desc = NULL;
+}
+
+/* Look up @file if needed, with its filesystem selected */
+static int fs_file_lookup(struct fs_file *file, struct fstype_info *info)
+{
+	loff_t size;
+	void *handle;
+	int ret;
+
+	if (info->open) {
+		if (file->handle)
+			return 0;
+		ret = info->open(file->path, &handle, &size);
+		if (ret)
+			return ret;
+		file->handle = handle;
+	} else {
+		if (file->size >= 0)
+			return 0;
+		ret = fs_size_cached(info, file->path, &size);
+		if (ret)
+			return ret;
+	}
+	file->size = size;
+
+	return 0;
+}
+
+int fs_file_open(struct fs_mount *mnt, const char *filename,
+		 struct fs_file **filep)
+{
+	struct fs_file *file;
+	int ret;
+
+	file = calloc(1, sizeof(*file) + strlen(filename) + 1);
+	if (!file)
+		return -ENOMEM;
+	file->mnt = mnt;
+	file->size = -1;
+	strcpy(file->path, filename);
+
+	ret = fs_set_mount(mnt);
+	if (ret) {
+		free(file);
+		return ret;
+	}
+	ret = fs_file_lookup(file, fs_get_info(fs_type));
+	if (ret) {
+		fs_close();
+		free(file);
+		return -ENOENT;
+	}
+	list_add(&file->sibling, &mnt->files);
+	fs_close();
+	*filep = file;
+
+	return 0;
+}
+
+int fs_file_size(struct fs_file *file, loff_t *sizep)
+{
+	int ret;
+
+	if (file->size < 0) {
+		ret = fs_set_mount(file->mnt);
+		if (ret)
+			return ret;
+		ret = fs_file_lookup(file, fs_get_info(fs_type));
+		fs_close();
+		if (ret)
+			return -EIO;
+	}
+	*sizep = file->size;
+
+	return 0;
+}
+
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread)
+{
+	struct fstype_info *info;
+	int ret;
+
+	*actread = 0;
+	ret = fs_set_mount(file->mnt);
+	if (ret)
+		return ret;
+
+	info = fs_get_info(fs_type);
+	ret = fs_file_lookup(file, info);
+	if (!ret && len && offset < file->size) {
+		len = min(len, file->size - offset);
+		if (file->handle)
+			ret = info->pread(file->handle, buf, offset, len,
+					  actread);
+		else
+			ret = info->read(file->path, buf, offset, len,
+					 actread);
+	}
+	fs_close();
+
+	return ret ? -EIO : 0;
+}
+
+void fs_file_close(struct fs_file *file)
+{
+	if (!file)
+		return;
+
+	/* Only the active mount has handles */
+	if (file->handle)
+		fs_get_info(file->mnt->fstype)->release(file->handle);
+	list_del(&file->sibling);
+	free(file);
+}
+
 int do_size(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 	    int fstype)
 {
@@ -754,6 +1247,8 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 	loff_t bytes;
 	loff_t pos;
 	loff_t len_read;
+	bool in_place = false;
+	void *buf;
 	int ret;
 	unsigned long time;
 	char *ep;
@@ -768,7 +1263,10 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 		return 1;
 	}
 
-	if (argc >= 4) {
+	/* '-' uses the data where it is, if the device and layout allow it */
+	if (argc >= 4 && !strcmp(argv[3], "-"))
+		in_place = true;
+	if (argc >= 4 && !in_place) {
 		addr = hextoul(argv[3], &ep);
 		if (ep == argv[3] || *ep != '\0')
 			return CMD_RET_USAGE;
@@ -798,7 +1296,19 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 		pos = 0;
 
 	time = get_timer(0);
-	ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+	if (in_place) {
+		ret = fs_map(filename, pos, bytes, &buf, &len_read);
+		if (!ret) {
+			addr = map_to_sysmem(buf);
+		} else {
+			/* Fall back to reading the file to the load address */
+			in_place = false;
+			if (fs_set_blk_dev(argv[1], argv[2], fstype))
+				return 1;
+		}
+	}
+	if (!in_place)
+		ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
 	time = get_timer(time);
 	if (ret < 0) {
 		log_err("Failed to load '%s'\n", filename);
@@ -810,7 +1320,8 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 				(argc > 4) ? argv[4] : "", map_sysmem(addr, 0),
 				len_read);
 
-	printf("%llu bytes read in %lu ms", len_read, time);
+	printf("%llu bytes %s in %lu ms", len_read,
+	       in_place ? "mapped" : "read", time);
 	if (time > 0) {
 		puts(" (");
 		print_size(div_u64(len_read, time) * 1000, "/s");
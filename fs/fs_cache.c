@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of file lookups in the filesystem layer
+ *
+ * A boot flow looks up the same few files again and again: a script checks
+ * that a file exists, asks for its size and then reads it, and each of these
+ * mounts the filesystem and walks the directories from the root. This keeps
+ * the result of recent lookups, keyed by block device, partition and path.
+ *
+ * Entries are dropped whenever something is written to or erased from the
+ * device, and when the device goes away.
+ */
+
+#define LOG_CATEGORY LOGC_CORE
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <fs.h>
+#include <log.h>
+#include <part.h>
+
+/* Longest path which is cached */
+#define FS_CACHE_PATH_MAX	128
+
+enum {
+	FS_CACHE_HAVE_EXISTS	= 1 << 0,
+	FS_CACHE_HAVE_SIZE	= 1 << 1,
+	FS_CACHE_HAVE_HANDLE	= 1 << 2,
+};
+
+/**
+ * struct fs_cache_entry - what is known about a file
+ *
+ * @desc: Block device, NULL if the entry is unused
+ * @part: Partition number
+ * @part_start: Start of the partition, in blocks
+ * @fstype: Filesystem type (FS_TYPE_...)
+ * @flags: Which of the values below are valid (FS_CACHE_HAVE_...)
+ * @last_used: Value of the clock when the entry was last used
+ * @exists: Value returned by the exists() method
+ * @size_ret: Value returned by the size() method
+ * @size: Size returned by the size() method
+ * @handle: Handle recorded by the filesystem
+ * @path: Path of the file
+ */
+struct fs_cache_entry {
+	struct blk_desc *desc;
+	int part;
+	lbaint_t part_start;
+	int fstype;
+	uint flags;
+	ulong last_used;
+	int exists;
+	int size_ret;
+	loff_t size;
+	u64 handle;
+	char path[FS_CACHE_PATH_MAX];
+};
+
+/**
+ * struct fs_cache_sel - the filesystem selected by the fs layer
+ *
+ * @desc: Block device, NULL if lookups are not cached
+ * @part: Partition number
+ * @part_start: Start of the partition, in blocks
+ * @fstype: Filesystem type (FS_TYPE_...)
+ */
+struct fs_cache_sel {
+	struct blk_desc *desc;
+	int part;
+	lbaint_t part_start;
+	int fstype;
+};
+
+static struct fs_cache_entry fs_cache[CONFIG_FS_CACHE_ENTRIES];
+static struct fs_cache_sel fs_cache_cur;
+static struct fs_cache_stats fs_cache_stats;
+static ulong fs_cache_clock;
+
+void fs_cache_select(struct blk_desc *desc, int part,
+		     struct disk_partition *info, int fstype)
+{
+	fs_cache_cur.desc = desc;
+	fs_cache_cur.part = part;
+	fs_cache_cur.part_start = desc ? info->start : 0;
+	fs_cache_cur.fstype = fstype;
+}
+
+static struct fs_cache_entry *fs_cache_find(const char *path)
+{
+	struct fs_cache_entry *ent;
+
+	if (!fs_cache_cur.desc || strlen(path) >= FS_CACHE_PATH_MAX)
+		return NULL;
+
+	for (ent = fs_cache; ent < fs_cache + ARRAY_SIZE(fs_cache); ent++) {
+		if (ent->desc == fs_cache_cur.desc &&
+		    ent->part == fs_cache_cur.part &&
+		    ent->part_start == fs_cache_cur.part_start &&
+		    ent->fstype == fs_cache_cur.fstype &&
+		    !strcmp(ent->path, path)) {
+			ent->last_used = ++fs_cache_clock;
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
+/* Find the entry for @path, taking over the least recently used if needed */
+static struct fs_cache_entry *fs_cache_add(const char *path)
+{
+	struct fs_cache_entry *ent, *victim = NULL;
+
+	if (!fs_cache_cur.desc || strlen(path) >= FS_CACHE_PATH_MAX)
+		return NULL;
+
+	ent = fs_cache_find(path);
+	if (ent)
+		return ent;
+
+	for (ent = fs_cache; ent < fs_cache + ARRAY_SIZE(fs_cache); ent++) {
+		if (!ent->desc) {
+			victim = ent;
+			break;
+		}
+		if (!victim || ent->last_used < victim->last_used)
+			victim = ent;
+	}
+	if (victim->desc) {
+		log_debug("evict %s\n", victim->path);
+		fs_cache_stats.evictions++;
+	}
+
+	memset(victim, '\0', sizeof(*victim));
+	victim->desc = fs_cache_cur.desc;
+	victim->part = fs_cache_cur.part;
+	victim->part_start = fs_cache_cur.part_start;
+	victim->fstype = fs_cache_cur.fstype;
+	victim->last_used = ++fs_cache_clock;
+	strcpy(victim->path, path);
+
+	return victim;
+}
+
+/* Look up @path and count a hit if it has all of @flags */
+static struct fs_cache_entry *fs_cache_lookup(const char *path, uint flags)
+{
+	struct fs_cache_entry *ent;
+
+	if (!fs_cache_cur.desc)
+		return NULL;
+
+	ent = fs_cache_find(path);
+	if (!ent || (ent->flags & flags) != flags) {
+		fs_cache_stats.misses++;
+		return NULL;
+	}
+	fs_cache_stats.hits++;
+
+	return ent;
+}
+
+bool fs_cache_get_exists(const char *path, int *existsp)
+{
+	struct fs_cache_entry *ent;
+
+	ent = fs_cache_lookup(path, FS_CACHE_HAVE_EXISTS);
+	if (!ent)
+		return false;
+	*existsp = ent->exists;
+
+	return true;
+}
+
+void fs_cache_set_exists(const char *path, int exists)
+{
+	struct fs_cache_entry *ent = fs_cache_add(path);
+
+	if (ent) {
+		ent->exists = exists;
+		ent->flags |= FS_CACHE_HAVE_EXISTS;
+	}
+}
+
+bool fs_cache_get_size(const char *path, loff_t *sizep, int *retp)
+{
+	struct fs_cache_entry *ent;
+
+	ent = fs_cache_lookup(path, FS_CACHE_HAVE_SIZE);
+	if (!ent)
+		return false;
+	*sizep = ent->size;
+	*retp = ent->size_ret;
+
+	return true;
+}
+
+void fs_cache_set_size(const char *path, loff_t size, int ret)
+{
+	struct fs_cache_entry *ent = fs_cache_add(path);
+
+	if (ent) {
+		ent->size = size;
+		ent->size_ret = ret;
+		ent->flags |= FS_CACHE_HAVE_SIZE;
+		/* Anything with a size exists */
+		if (!ret && !(ent->flags & FS_CACHE_HAVE_EXISTS)) {
+			ent->exists = 1;
+			ent->flags |= FS_CACHE_HAVE_EXISTS;
+		}
+	}
+}
+
+bool fs_cache_get_handle(const char *path, u64 *handlep)
+{
+	struct fs_cache_entry *ent;
+
+	ent = fs_cache_lookup(path, FS_CACHE_HAVE_HANDLE);
+	if (!ent)
+		return false;
+	*handlep = ent->handle;
+
+	return true;
+}
+
+void fs_cache_set_handle(const char *path, u64 handle)
+{
+	struct fs_cache_entry *ent = fs_cache_add(path);
+
+	if (ent) {
+		ent->handle = handle;
+		ent->flags |= FS_CACHE_HAVE_HANDLE;
+	}
+}
+
+void fs_cache_invalidate(struct blk_desc *desc)
+{
+	struct fs_cache_entry *ent;
+
+	for (ent = fs_cache; ent < fs_cache + ARRAY_SIZE(fs_cache); ent++) {
+		if (ent->desc && (!desc || ent->desc == desc)) {
+			ent->desc = NULL;
+			fs_cache_stats.invalidations++;
+		}
+	}
+}
+
+void fs_cache_get_stats(struct fs_cache_stats *stats)
+{
+	struct fs_cache_entry *ent;
+
+	*stats = fs_cache_stats;
+	stats->used = 0;
+	stats->size = ARRAY_SIZE(fs_cache);
+	for (ent = fs_cache; ent < fs_cache + ARRAY_SIZE(fs_cache); ent++) {
+		if (ent->desc)
+			stats->used++;
+	}
+}
+
+void fs_cache_clear(void)
+{
+	memset(fs_cache, '\0', sizeof(fs_cache));
+	memset(&fs_cache_stats, '\0', sizeof(fs_cache_stats));
+	fs_cache_clock = 0;
+}
+
+int do_fs_cache(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct fs_cache_stats stats;
+	struct fs_cache_entry *ent;
+	char name[16];
+
+	if (argc > 2)
+		return CMD_RET_USAGE;
+	if (argc == 2) {
+		if (strcmp(argv[1], "clear"))
+			return CMD_RET_USAGE;
+		fs_cache_clear();
+		return CMD_RET_SUCCESS;
+	}
+
+	fs_cache_get_stats(&stats);
+	printf("Entries:       %d / %d\n", stats.used, stats.size);
+	printf("Hits:          %lu\n", stats.hits);
+	printf("Misses:        %lu\n", stats.misses);
+	printf("Evictions:     %lu\n", stats.evictions);
+	printf("Invalidations: %lu\n", stats.invalidations);
+	if (!stats.used)
+		return CMD_RET_SUCCESS;
+
+	printf("\n%-10s %4s %-6s %10s  %s\n", "Device", "Part", "Exists",
+	       "Size", "Path");
+	for (ent = fs_cache; ent < fs_cache + ARRAY_SIZE(fs_cache); ent++) {
+		if (!ent->desc)
+			continue;
+		snprintf(name, sizeof(name), "%s %d",
+			 blk_get_if_type_name(ent->desc->if_type),
+			 ent->desc->devnum);
+		printf("%-10s %4d ", name, ent->part);
+		if (ent->flags & FS_CACHE_HAVE_EXISTS)
+			printf("%-6s ", ent->exists ? "yes" : "no");
+		else
+			printf("%-6s ", "?");
+		if ((ent->flags & FS_CACHE_HAVE_SIZE) && !ent->size_ret)
+			printf("%10lld  ", (long long)ent->size);
+		else
+			printf("%10s  ", "-");
+		printf("%s\n", ent->path);
+	}
+
+	return CMD_RET_SUCCESS;
+}
@@ -20,12 +20,30 @@
 #include <squashfs.h>
 #include <part.h>
 
+#include "sqfs_cache.h"
 #include "sqfs_decompressor.h"
 #include "sqfs_filesystem.h"
 #include "sqfs_utils.h"
 
 static struct squashfs_ctxt ctxt;
 
+/* Decompressed metadata blocks, each SQFS_METADATA_BLOCK_SIZE bytes */
+static struct sqfs_cache sqfs_meta_cache = {
+	.count = CONFIG_SQUASHFS_METADATA_CACHE_BLOCKS,
+};
+
+/* Decompressed fragment blocks, each the filesystem's block size */
+static struct sqfs_cache sqfs_frag_cache = {
+	.count = CONFIG_SQUASHFS_FRAGMENT_CACHE_BLOCKS,
+};
+
+/* Filesystem which the cached blocks come from */
+static struct {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	struct squashfs_super_block sblk;
+} sqfs_cache_owner;
+
 static int sqfs_disk_read(__u32 block, __u32 nr_blocks, void *buf)
 {
 	ulong ret;
@@ -77,131 +95,203 @@ static int sqfs_count_tokens(const char *filename)
 }
 
 /*
- * Calculates how many blocks are needed for the buffer used in sqfs_disk_read.
- * The memory section (e.g. inode table) start offset and its end (i.e. the next
- * table start) must be specified. It also calculates the offset from which to
- * start reading the buffer.
+ * Reads @len bytes at byte position @pos of the filesystem. @bufp is set to
+ * the buffer holding them, which the caller must free, and @datap to the
+ * first byte within it.
  */
-static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
+static int sqfs_disk_read_bytes(u64 pos, u64 len, unsigned char **bufp,
+				unsigned char **datap)
 {
-	u64 start_, table_size;
+	u64 start, offset, n_blks;
+
+	start = lldiv(pos, ctxt.cur_dev->blksz);
+	offset = pos - start * ctxt.cur_dev->blksz;
+	n_blks = DIV_ROUND_UP(len + offset, ctxt.cur_dev->blksz);
 
-	table_size = le64_to_cpu(end) - le64_to_cpu(start);
-	start_ = le64_to_cpu(start) / ctxt.cur_dev->blksz;
-	*offset = le64_to_cpu(start) - (start_ * ctxt.cur_dev->blksz);
+	*bufp = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!*bufp)
+		return -ENOMEM;
+
+	if (sqfs_disk_read(start, n_blks, *bufp) < 0) {
+		free(*bufp);
+		*bufp = NULL;
+		return -EINVAL;
+	}
+	*datap = *bufp + offset;
 
-	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
+	return 0;
 }
 
 /*
- * Retrieves fragment block entry and returns true if the fragment block is
- * compressed
+ * Gets the decompressed metadata block at byte position @pos, from the cache
+ * if possible. If @src is not NULL it holds @src_len bytes of the filesystem
+ * starting at @pos, otherwise the block is read from the disk. The entry
+ * returned is only valid until the next block is added to the cache.
  */
-static int sqfs_frag_lookup(u32 inode_fragment_index,
-			    struct squashfs_fragment_block_entry *e)
+static int sqfs_get_metablock(u64 pos, unsigned char *src, u64 src_len,
+			      struct sqfs_cache_entry **entp)
 {
-	u64 start, n_blks, src_len, table_offset, start_block;
-	unsigned char *metadata_buffer, *metadata, *table;
-	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct sqfs_cache_entry *ent;
+	unsigned char *buf = NULL;
 	unsigned long dest_len;
-	int block, offset, ret;
-	u16 header;
+	u32 data_size;
+	bool comp;
+	int ret;
 
-	metadata_buffer = NULL;
-	entries = NULL;
-	table = NULL;
+	ent = sqfs_cache_get(&sqfs_meta_cache, pos);
+	if (ent) {
+		*entp = ent;
+		return 0;
+	}
 
-	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
-		return -EINVAL;
+	if (!src) {
+		if (pos >= get_unaligned_le64(&sblk->bytes_used))
+			return -EINVAL;
+		src_len = min_t(u64, get_unaligned_le64(&sblk->bytes_used) - pos,
+				SQFS_HEADER_SIZE + SQFS_METADATA_BLOCK_SIZE);
+		ret = sqfs_disk_read_bytes(pos, src_len, &buf, &src);
+		if (ret)
+			return ret;
+	}
 
-	start = get_unaligned_le64(&sblk->fragment_table_start) /
-		ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
-				  sblk->export_table_start,
-				  &table_offset);
+	if (src_len < SQFS_HEADER_SIZE ||
+	    sqfs_read_metablock(src, 0, &comp, &data_size) ||
+	    data_size + SQFS_HEADER_SIZE > src_len) {
+		ret = -EINVAL;
+		goto out;
+	}
 
-	/* Allocate a proper sized buffer to store the fragment index table */
-	table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!table) {
+	ent = sqfs_cache_victim(&sqfs_meta_cache, SQFS_METADATA_BLOCK_SIZE);
+	if (!ent) {
 		ret = -ENOMEM;
 		goto out;
 	}
 
-	if (sqfs_disk_read(start, n_blks, table) < 0) {
-		ret = -EINVAL;
-		goto out;
+	if (comp) {
+		dest_len = SQFS_METADATA_BLOCK_SIZE;
+		ret = sqfs_decompress(&ctxt, ent->data, &dest_len,
+				      src + SQFS_HEADER_SIZE, data_size);
+		if (ret) {
+			ret = -EINVAL;
+			goto out;
+		}
+	} else {
+		memcpy(ent->data, src + SQFS_HEADER_SIZE, data_size);
+		dest_len = data_size;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+	sqfs_cache_insert(&sqfs_meta_cache, ent, pos, dest_len,
+			  data_size + SQFS_HEADER_SIZE);
+	*entp = ent;
 
-	/*
-	 * Get the start offset of the metadata block that contains the right
-	 * fragment block entry
-	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+out:
+	free(buf);
 
-	start = start_block / ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
-				  sblk->fragment_table_start, &table_offset);
+	return ret;
+}
 
-	metadata_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!metadata_buffer) {
-		ret = -ENOMEM;
-		goto out;
-	}
+/*
+ * Gets the decompressed fragment block described by @e, from the cache if
+ * possible. The entry returned is only valid until the next fragment block is
+ * added to the cache.
+ */
+static int sqfs_get_fragment(struct squashfs_fragment_block_entry *e,
+			     bool comp, struct sqfs_cache_entry **entp)
+{
+	u32 block_size = get_unaligned_le32(&ctxt.sblk->block_size);
+	u32 src_len = SQFS_BLOCK_SIZE(e->size);
+	unsigned char *buf, *src;
+	struct sqfs_cache_entry *ent;
+	unsigned long dest_len;
+	int ret;
 
-	if (sqfs_disk_read(start, n_blks, metadata_buffer) < 0) {
-		ret = -EINVAL;
-		goto out;
+	ent = sqfs_cache_get(&sqfs_frag_cache, e->start);
+	if (ent) {
+		*entp = ent;
+		return 0;
 	}
 
-	/* Every metadata block starts with a 16-bit header */
-	header = get_unaligned_le16(metadata_buffer + table_offset);
-	metadata = metadata_buffer + table_offset + SQFS_HEADER_SIZE;
+	if (src_len > block_size)
+		return -EINVAL;
 
-	if (!metadata || !header) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	ret = sqfs_disk_read_bytes(e->start, src_len, &buf, &src);
+	if (ret)
+		return ret;
 
-	entries = malloc(SQFS_METADATA_BLOCK_SIZE);
-	if (!entries) {
+	ent = sqfs_cache_victim(&sqfs_frag_cache, block_size);
+	if (!ent) {
 		ret = -ENOMEM;
 		goto out;
 	}
 
-	if (SQFS_COMPRESSED_METADATA(header)) {
-		src_len = SQFS_METADATA_SIZE(header);
-		dest_len = SQFS_METADATA_BLOCK_SIZE;
-		ret = sqfs_decompress(&ctxt, entries, &dest_len, metadata,
+	if (comp) {
+		dest_len = block_size;
+		ret = sqfs_decompress(&ctxt, ent->data, &dest_len, src,
 				      src_len);
 		if (ret) {
 			ret = -EINVAL;
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		memcpy(ent->data, src, src_len);
+		dest_len = src_len;
 	}
 
-	*e = entries[offset];
-	ret = SQFS_COMPRESSED_BLOCK(e->size);
+	sqfs_cache_insert(&sqfs_frag_cache, ent, e->start, dest_len, src_len);
+	*entp = ent;
 
 out:
-	free(entries);
-	free(metadata_buffer);
-	free(table);
+	free(buf);
 
 	return ret;
 }
 
 /*
- * The entry name is a flexible array member, and we don't know its size before
- * actually reading the entry. So we need a first copy to retrieve this size so
- * we can finally copy the whole struct.
+ * Retrieves fragment block entry and returns true if the fragment block is
+ * compressed
  */
+static int sqfs_frag_lookup(u32 inode_fragment_index,
+			    struct squashfs_fragment_block_entry *e)
+{
+	struct squashfs_fragment_block_entry *entries;
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	unsigned char *buf, *index;
+	struct sqfs_cache_entry *ent;
+	u64 start_block;
+	int block, offset, ret;
+
+	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
+		return -EINVAL;
+
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
+	/*
+	 * Get the start offset of the metadata block that contains the right
+	 * fragment block entry
+	 */
+	ret = sqfs_disk_read_bytes(get_unaligned_le64(&sblk->fragment_table_start) +
+				   block * sizeof(u64), sizeof(u64), &buf,
+				   &index);
+	if (ret)
+		return ret;
+	start_block = get_unaligned_le64(index);
+	free(buf);
+
+	ret = sqfs_get_metablock(start_block, NULL, 0, &ent);
+	if (ret)
+		return ret;
+
+	if ((offset + 1) * sizeof(*entries) > ent->len)
+		return -EINVAL;
+
+	entries = ent->data;
+	*e = entries[offset];
+
+	return SQFS_COMPRESSED_BLOCK(e->size);
+}
+
 static int sqfs_read_entry(struct squashfs_directory_entry **dest, void *src)
 {
 	struct squashfs_directory_entry *tmp;
@@ -634,52 +724,95 @@ out:
 }
 
 /*
- * Inode and directory tables are stored as a series of metadata blocks, and
- * given the compressed size of this table, we can calculate how much metadata
- * blocks are needed to store the result of the decompression, since a
- * decompressed metadata block should have a size of 8KiB.
+ * Inode and directory tables are stored as a series of metadata blocks. This
+ * decompresses the blocks from byte position @start up to @end into a table,
+ * SQFS_METADATA_BLOCK_SIZE bytes apart, stopping after the first block which
+ * is not full. If @pos_list is not NULL it is set to a list holding, for each
+ * block, the position of the next one relative to @start, which is how inodes
+ * refer to entries in the directory table.
+ *
+ * Blocks are taken from the metadata cache where possible. The disk is only
+ * read if one of them is missing, and then the rest of the table is read in
+ * one go.
+ *
+ * Return: number of blocks in the table, or a negative error
  */
-static int sqfs_count_metablks(void *table, u32 offset, int table_size)
+static int sqfs_read_metadata_table(u64 start, u64 end, unsigned char **table,
+				    u32 **pos_list)
 {
-	int count = 0, cur_size = 0, ret;
-	u32 data_size;
-	bool comp;
+	unsigned char *buf = NULL, *src = NULL, *new_table;
+	struct sqfs_cache_entry *ent;
+	int count = 0, max = 0, ret;
+	u64 pos = start, src_pos = 0;
+	u32 *new_list;
+
+	*table = NULL;
+	if (pos_list)
+		*pos_list = NULL;
 
-	do {
-		ret = sqfs_read_metablock(table, offset + cur_size, &comp,
-					  &data_size);
-		if (ret)
-			return -EINVAL;
-		cur_size += data_size + SQFS_HEADER_SIZE;
-		count++;
-	} while (cur_size < table_size);
+	while (pos < end) {
+		if (count == max) {
+			max = max ? max * 2 : 16;
+			new_table = realloc(*table, max * SQFS_METADATA_BLOCK_SIZE);
+			if (!new_table) {
+				printf("Error: failed to allocate squashfs table of size %i, increasing CONFIG_SYS_MALLOC_LEN could help\n",
+				       max * SQFS_METADATA_BLOCK_SIZE);
+				ret = -ENOMEM;
+				goto err;
+			}
+			*table = new_table;
+
+			if (pos_list) {
+				new_list = realloc(*pos_list, max * sizeof(u32));
+				if (!new_list) {
+					ret = -ENOMEM;
+					goto err;
+				}
+				*pos_list = new_list;
+			}
+		}
 
-	return count;
-}
+		ent = sqfs_cache_get(&sqfs_meta_cache, pos);
+		if (!ent) {
+			if (!buf) {
+				ret = sqfs_disk_read_bytes(pos, end - pos, &buf,
+							   &src);
+				if (ret)
+					goto err;
+				src_pos = pos;
+			}
+			ret = sqfs_get_metablock(pos, src + (pos - src_pos),
+						 end - pos, &ent);
+			if (ret)
+				goto err;
+		}
 
-/*
- * Storing the metadata blocks header's positions will be useful while looking
- * for an entry in the directory table, using the reference (index and offset)
- * given by its inode.
- */
-static int sqfs_get_metablk_pos(u32 *pos_list, void *table, u32 offset,
-				int metablks_count)
-{
-	u32 data_size, cur_size = 0;
-	int j, ret = 0;
-	bool comp;
+		memcpy(*table + count * SQFS_METADATA_BLOCK_SIZE, ent->data,
+		       ent->len);
+		pos += ent->disk_len;
+		if (pos_list)
+			(*pos_list)[count] = pos - start;
+		count++;
 
-	if (!metablks_count)
-		return -EINVAL;
+		if (ent->len < SQFS_METADATA_BLOCK_SIZE)
+			break;
+	}
 
-	for (j = 0; j < metablks_count; j++) {
-		ret = sqfs_read_metablock(table, offset + cur_size, &comp,
-					  &data_size);
-		if (ret)
-			return -EINVAL;
+	if (!count) {
+		ret = -EINVAL;
+		goto err;
+	}
+	free(buf);
+
+	return count;
 
-		cur_size += data_size + SQFS_HEADER_SIZE;
-		pos_list[j] = cur_size;
+err:
+	free(buf);
+	free(*table);
+	*table = NULL;
+	if (pos_list) {
+		free(*pos_list);
+		*pos_list = NULL;
 	}
 
 	return ret;
@@ -688,188 +821,22 @@ static int sqfs_get_metablk_pos(u32 *pos_list, void *table, u32 offset,
 static int sqfs_read_inode_table(unsigned char **inode_table)
 {
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	u64 start, n_blks, table_offset, table_size;
-	int j, ret = 0, metablks_count;
-	unsigned char *src_table, *itb;
-	u32 src_len, dest_offset = 0;
-	unsigned long dest_len = 0;
-	bool compressed;
-
-	table_size = get_unaligned_le64(&sblk->directory_table_start) -
-		get_unaligned_le64(&sblk->inode_table_start);
-	start = get_unaligned_le64(&sblk->inode_table_start) /
-		ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(sblk->inode_table_start,
-				  sblk->directory_table_start, &table_offset);
-
-	/* Allocate a proper sized buffer (itb) to store the inode table */
-	itb = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!itb)
-		return -ENOMEM;
-
-	if (sqfs_disk_read(start, n_blks, itb) < 0) {
-		ret = -EINVAL;
-		goto free_itb;
-	}
-
-	/* Parse inode table (metadata block) header */
-	ret = sqfs_read_metablock(itb, table_offset, &compressed, &src_len);
-	if (ret) {
-		ret = -EINVAL;
-		goto free_itb;
-	}
-
-	/* Calculate size to store the whole decompressed table */
-	metablks_count = sqfs_count_metablks(itb, table_offset, table_size);
-	if (metablks_count < 1) {
-		ret = -EINVAL;
-		goto free_itb;
-	}
-
-	*inode_table = kcalloc(metablks_count, SQFS_METADATA_BLOCK_SIZE,
-			       GFP_KERNEL);
-	if (!*inode_table) {
-		ret = -ENOMEM;
-		printf("Error: failed to allocate squashfs inode_table of size %i, increasing CONFIG_SYS_MALLOC_LEN could help\n",
-		       metablks_count * SQFS_METADATA_BLOCK_SIZE);
-		goto free_itb;
-	}
-
-	src_table = itb + table_offset + SQFS_HEADER_SIZE;
-
-	/* Extract compressed Inode table */
-	for (j = 0; j < metablks_count; j++) {
-		sqfs_read_metablock(itb, table_offset, &compressed, &src_len);
-		if (compressed) {
-			dest_len = SQFS_METADATA_BLOCK_SIZE;
-			ret = sqfs_decompress(&ctxt, *inode_table +
-					      dest_offset, &dest_len,
-					      src_table, src_len);
-			if (ret) {
-				free(*inode_table);
-				*inode_table = NULL;
-				goto free_itb;
-			}
-
-			dest_offset += dest_len;
-		} else {
-			memcpy(*inode_table + (j * SQFS_METADATA_BLOCK_SIZE),
-			       src_table, src_len);
-		}
-
-		/*
-		 * Offsets to the decompression destination, to the metadata
-		 * buffer 'itb' and to the decompression source, respectively.
-		 */
-
-		table_offset += src_len + SQFS_HEADER_SIZE;
-		src_table += src_len + SQFS_HEADER_SIZE;
-	}
+	int ret;
 
-free_itb:
-	free(itb);
+	ret = sqfs_read_metadata_table(get_unaligned_le64(&sblk->inode_table_start),
+				       get_unaligned_le64(&sblk->directory_table_start),
+				       inode_table, NULL);
 
-	return ret;
+	return ret < 0 ? ret : 0;
 }
 
 static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
 {
-	u64 start, n_blks, table_offset, table_size;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	int j, ret = 0, metablks_count = -1;
-	unsigned char *src_table, *dtb;
-	u32 src_len, dest_offset = 0;
-	unsigned long dest_len = 0;
-	bool compressed;
-
-	*dir_table = NULL;
-	*pos_list = NULL;
-	/* DIRECTORY TABLE */
-	table_size = get_unaligned_le64(&sblk->fragment_table_start) -
-		get_unaligned_le64(&sblk->directory_table_start);
-	start = get_unaligned_le64(&sblk->directory_table_start) /
-		ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(sblk->directory_table_start,
-				  sblk->fragment_table_start, &table_offset);
-
-	/* Allocate a proper sized buffer (dtb) to store the directory table */
-	dtb = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!dtb)
-		return -ENOMEM;
-
-	if (sqfs_disk_read(start, n_blks, dtb) < 0)
-		goto out;
-
-	/* Parse directory table (metadata block) header */
-	ret = sqfs_read_metablock(dtb, table_offset, &compressed, &src_len);
-	if (ret)
-		goto out;
-
-	/* Calculate total size to store the whole decompressed table */
-	metablks_count = sqfs_count_metablks(dtb, table_offset, table_size);
-	if (metablks_count < 1)
-		goto out;
-
-	*dir_table = malloc(metablks_count * SQFS_METADATA_BLOCK_SIZE);
-	if (!*dir_table)
-		goto out;
-
-	*pos_list = malloc(metablks_count * sizeof(u32));
-	if (!*pos_list)
-		goto out;
-
-	ret = sqfs_get_metablk_pos(*pos_list, dtb, table_offset,
-				   metablks_count);
-	if (ret) {
-		metablks_count = -1;
-		goto out;
-	}
-
-	src_table = dtb + table_offset + SQFS_HEADER_SIZE;
-
-	/* Extract compressed Directory table */
-	dest_offset = 0;
-	for (j = 0; j < metablks_count; j++) {
-		sqfs_read_metablock(dtb, table_offset, &compressed, &src_len);
-		if (compressed) {
-			dest_len = SQFS_METADATA_BLOCK_SIZE;
-			ret = sqfs_decompress(&ctxt, *dir_table +
-					      (j * SQFS_METADATA_BLOCK_SIZE),
-					      &dest_len, src_table, src_len);
-			if (ret) {
-				metablks_count = -1;
-				goto out;
-			}
 
-			if (dest_len < SQFS_METADATA_BLOCK_SIZE) {
-				dest_offset += dest_len;
-				break;
-			}
-
-			dest_offset += dest_len;
-		} else {
-			memcpy(*dir_table + (j * SQFS_METADATA_BLOCK_SIZE),
-			       src_table, src_len);
-		}
-
-		/*
-		 * Offsets to the decompression destination, to the metadata
-		 * buffer 'dtb' and to the decompression source, respectively.
-		 */
-		table_offset += src_len + SQFS_HEADER_SIZE;
-		src_table += src_len + SQFS_HEADER_SIZE;
-	}
-
-out:
-	if (metablks_count < 1) {
-		free(*dir_table);
-		free(*pos_list);
-		*dir_table = NULL;
-		*pos_list = NULL;
-	}
-	free(dtb);
-
-	return metablks_count;
+	return sqfs_read_metadata_table(get_unaligned_le64(&sblk->directory_table_start),
+					get_unaligned_le64(&sblk->fragment_table_start),
+					dir_table, pos_list);
 }
 
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
@@ -1103,6 +1070,17 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 
 	ctxt.sblk = sblk;
 
+	/* Drop cached blocks which come from another filesystem */
+	if (sqfs_cache_owner.dev != fs_dev_desc ||
+	    sqfs_cache_owner.part_start != fs_partition->start ||
+	    memcmp(&sqfs_cache_owner.sblk, sblk, sizeof(*sblk))) {
+		sqfs_cache_free(&sqfs_meta_cache);
+		sqfs_cache_free(&sqfs_frag_cache);
+		sqfs_cache_owner.dev = fs_dev_desc;
+		sqfs_cache_owner.part_start = fs_partition->start;
+		sqfs_cache_owner.sblk = *sblk;
+	}
+
 	ret = sqfs_decompressor_init(&ctxt);
 	if (ret) {
 		goto error;
@@ -1314,10 +1292,13 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
-	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
+	u64 start, n_blks, table_size, data_offset, data_end = 0, sparse_size;
+	char *dir = NULL, *datablock = NULL, *ra_buf = NULL;
+	char *file = NULL, *resolved, *data;
 	int ret, j, i_number, datablk_count = 0;
+	u64 ra_start = 0, ra_end = 0;
+	u32 block_size, ra_size = 0;
+	struct sqfs_cache_entry *frag;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	struct squashfs_fragment_block_entry frag_entry;
 	struct squashfs_file_info finfo = {0};
@@ -1434,70 +1415,97 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		len = finfo.size;
 	}
 
+	block_size = get_unaligned_le32(&sblk->block_size);
 	if (datablk_count) {
-		data_offset = finfo.start;
-		datablock = malloc(get_unaligned_le32(&sblk->block_size));
+		datablock = malloc(block_size);
 		if (!datablock) {
 			ret = -ENOMEM;
 			goto out;
 		}
+
+		/*
+		 * Data blocks follow each other on the disk, so read as many
+		 * of them as fit in the readahead buffer at once, but nothing
+		 * past the last one needed
+		 */
+		data_end = finfo.start;
+		for (j = 0; j < datablk_count && (u64)j * block_size < len; j++)
+			data_end += SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
+		ra_size = max_t(u32, CONFIG_SQUASHFS_READAHEAD_SIZE * 1024,
+				block_size + ctxt.cur_dev->blksz);
+		ra_size = roundup(ra_size, ctxt.cur_dev->blksz);
+		ra_size = min_t(u64, ra_size,
+				roundup(data_end - finfo.start, ctxt.cur_dev->blksz) +
+				ctxt.cur_dev->blksz);
+		ra_buf = malloc_cache_aligned(ra_size);
+		if (!ra_buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
 	}
 
+	data_offset = finfo.start;
 	for (j = 0; j < datablk_count; j++) {
-		char *data_buffer;
-
-		start = lldiv(data_offset, ctxt.cur_dev->blksz);
 		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
-		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
-		n_blks = DIV_ROUND_UP(table_size + table_offset,
-				      ctxt.cur_dev->blksz);
+		if (table_size > block_size) {
+			ret = -EINVAL;
+			goto out;
+		}
 
 		/* Don't load any data for sparse blocks */
 		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
 			data = NULL;
 		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
+			if (data_offset < ra_start ||
+			    data_offset + table_size > ra_end) {
+				start = lldiv(data_offset, ctxt.cur_dev->blksz);
+				n_blks = min_t(u64, ra_size / ctxt.cur_dev->blksz,
+					       DIV_ROUND_UP(data_end - start *
+							    ctxt.cur_dev->blksz,
+							    ctxt.cur_dev->blksz));
+				ret = sqfs_disk_read(start, n_blks, ra_buf);
+				if (ret < 0) {
+					/*
+					 * Possible causes: too many data blocks or too large
+					 * SquashFS block size. Tip: re-compile the SquashFS
+					 * image with mksquashfs's -b <block_size> option.
+					 */
+					printf("Error: too many data blocks to be read.\n");
+					goto out;
+				}
+				ra_start = start * ctxt.cur_dev->blksz;
+				ra_end = ra_start + n_blks * ctxt.cur_dev->blksz;
 			}
 
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
-
-			data = data_buffer + table_offset;
+			data = ra_buf + (data_offset - ra_start);
 		}
 
 		/* Load the data */
 		if (finfo.blk_sizes[j] == 0) {
 			/* This is a sparse block */
-			sparse_size = get_unaligned_le32(&sblk->block_size);
+			sparse_size = block_size;
 			if ((*actread + sparse_size) > len)
 				sparse_size = len - *actread;
 			memset(buf + *actread, 0, sparse_size);
 			*actread += sparse_size;
 		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
-			dest_len = get_unaligned_le32(&sblk->block_size);
-			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
-					      data, table_size);
-			if (ret)
-				goto out;
-
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
+			dest_len = block_size;
+			if (*actread + block_size <= len) {
+				/* The whole block fits, so skip the copy */
+				ret = sqfs_decompress(&ctxt, buf + *actread,
+						      &dest_len, data, table_size);
+				if (ret)
+					goto out;
+			} else {
+				ret = sqfs_decompress(&ctxt, datablock,
+						      &dest_len, data, table_size);
+				if (ret)
+					goto out;
+
+				if ((*actread + dest_len) > len)
+					dest_len = len - *actread;
+				memcpy(buf + *actread, datablock, dest_len);
+			}
 			*actread += dest_len;
 		} else {
 			if ((*actread + table_size) > len)
@@ -1506,8 +1514,7 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 			*actread += table_size;
 		}
 
-		data_offset += table_size;
-		free(data_buffer);
+		data_offset += SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
 		if (*actread >= len)
 			break;
 	}
@@ -1520,53 +1527,21 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
+	ret = sqfs_get_fragment(&frag_entry, finfo.comp, &frag);
+	if (ret)
 		goto out;
-	}
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	if (finfo.offset + finfo.size - *actread > frag->len) {
+		ret = -EINVAL;
 		goto out;
-
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
 	}
 
+	memcpy(buf + *actread, frag->data + finfo.offset,
+	       finfo.size - *actread);
+	*actread = finfo.size;
+
 out:
-	free(fragment);
+	free(ra_buf);
 	free(datablock);
 	free(file);
 	free(dir);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Cache of decompressed SquashFS blocks
+ *
+ * Every lookup decompresses the inode and directory tables, and every file
+ * with a tail decompresses a whole fragment block to get at it. A boot flow
+ * looks up a handful of files in the same few directories, so the same
+ * blocks are decompressed over and over. This keeps the most recently used
+ * ones, keyed by their position on the disk.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <linux/string.h>
+
+#include "sqfs_cache.h"
+
+struct sqfs_cache_entry *sqfs_cache_get(struct sqfs_cache *cache, u64 pos)
+{
+	struct sqfs_cache_entry *ent;
+	int i;
+
+	if (!cache->entries)
+		return NULL;
+
+	for (i = 0; i < cache->count; i++) {
+		ent = &cache->entries[i];
+		if (ent->last_used && ent->pos == pos) {
+			ent->last_used = ++cache->clock;
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
+struct sqfs_cache_entry *sqfs_cache_victim(struct sqfs_cache *cache,
+					   u32 block_size)
+{
+	struct sqfs_cache_entry *ent, *victim = NULL;
+	int i;
+
+	if (cache->entries && cache->block_size != block_size)
+		sqfs_cache_free(cache);
+
+	if (!cache->entries) {
+		cache->entries = calloc(cache->count, sizeof(*ent));
+		if (!cache->entries)
+			return NULL;
+		cache->block_size = block_size;
+	}
+
+	for (i = 0; i < cache->count; i++) {
+		ent = &cache->entries[i];
+		if (!victim || ent->last_used < victim->last_used)
+			victim = ent;
+	}
+
+	if (!victim->data) {
+		victim->data = malloc_cache_aligned(block_size);
+		if (!victim->data)
+			return NULL;
+	}
+	victim->last_used = 0;
+
+	return victim;
+}
+
+void sqfs_cache_insert(struct sqfs_cache *cache, struct sqfs_cache_entry *ent,
+		       u64 pos, u32 len, u32 disk_len)
+{
+	ent->pos = pos;
+	ent->len = len;
+	ent->disk_len = disk_len;
+	ent->last_used = ++cache->clock;
+}
+
+void sqfs_cache_free(struct sqfs_cache *cache)
+{
+	int i;
+
+	if (!cache->entries)
+		return;
+
+	for (i = 0; i < cache->count; i++)
+		free(cache->entries[i].data);
+	free(cache->entries);
+	cache->entries = NULL;
+	cache->clock = 0;
+}
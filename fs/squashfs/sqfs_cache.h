@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Cache of decompressed SquashFS blocks
+ */
+
+#ifndef SQFS_CACHE_H
+#define SQFS_CACHE_H
+
+#include <linux/types.h>
+
+/**
+ * struct sqfs_cache_entry - a decompressed block
+ *
+ * @pos: Position of the block on the disk, in bytes from the start of the
+ *	filesystem
+ * @len: Number of bytes of decompressed data
+ * @disk_len: Number of bytes the block takes on the disk, including any header
+ * @last_used: Value of the cache clock when the entry was last used, 0 if the
+ *	entry is unused
+ * @data: Decompressed data, allocated when the entry is first used
+ */
+struct sqfs_cache_entry {
+	u64 pos;
+	u32 len;
+	u32 disk_len;
+	ulong last_used;
+	void *data;
+};
+
+/**
+ * struct sqfs_cache - a set of decompressed blocks, least recently used first
+ *
+ * @count: Number of entries
+ * @block_size: Size of the data buffer of each entry
+ * @clock: Incremented on each access, for finding the least recently used
+ *	entry
+ * @entries: The entries, NULL until the cache is first used
+ */
+struct sqfs_cache {
+	int count;
+	u32 block_size;
+	ulong clock;
+	struct sqfs_cache_entry *entries;
+};
+
+/**
+ * sqfs_cache_get() - Look up a block in the cache
+ *
+ * @cache: Cache to search
+ * @pos: Position of the block on the disk
+ * Return: the entry for the block, or NULL if it is not in the cache
+ */
+struct sqfs_cache_entry *sqfs_cache_get(struct sqfs_cache *cache, u64 pos);
+
+/**
+ * sqfs_cache_victim() - Get an entry to decompress a block into
+ *
+ * This takes the least recently used entry and marks it unused. Once the data
+ * is in place, sqfs_cache_insert() makes it available to sqfs_cache_get().
+ *
+ * @cache: Cache to use
+ * @block_size: Size of the data buffer needed. If this is not the size used
+ *	so far, the cache is emptied first.
+ * Return: the entry, or NULL if out of memory
+ */
+struct sqfs_cache_entry *sqfs_cache_victim(struct sqfs_cache *cache,
+					   u32 block_size);
+
+/**
+ * sqfs_cache_insert() - Record the block held by an entry
+ *
+ * @cache: Cache containing the entry
+ * @ent: Entry returned by sqfs_cache_victim()
+ * @pos: Position of the block on the disk
+ * @len: Number of bytes of decompressed data
+ * @disk_len: Number of bytes the block takes on the disk
+ */
+void sqfs_cache_insert(struct sqfs_cache *cache, struct sqfs_cache_entry *ent,
+		       u64 pos, u32 len, u32 disk_len);
+
+/**
+ * sqfs_cache_free() - Drop all the blocks and free the memory they use
+ *
+ * @cache: Cache to empty
+ */
+void sqfs_cache_free(struct sqfs_cache *cache);
+
+#endif /* SQFS_CACHE_H */
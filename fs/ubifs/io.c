@@ -66,6 +66,7 @@
 #include <linux/slab.h>
 #include <u-boot/crc.h>
 #else
+#include <time.h>
 #include <linux/compat.h>
 #include <linux/err.h>
 #endif
@@ -97,8 +98,16 @@ int ubifs_leb_read(const struct ubifs_info *c, int lnum, void *buf, int offs,
 		   int len, int even_ebadmsg)
 {
 	int err;
+#ifdef __UBOOT__
+	ulong start = timer_get_us();
+#endif
 
 	err = ubi_read(c->ubi, lnum, buf, offs, len);
+#ifdef __UBOOT__
+	ubifs_stats.media_reads++;
+	ubifs_stats.media_bytes += len;
+	ubifs_stats.media_us += timer_get_us() - start;
+#endif
 	/*
 	 * In case of %-EBADMSG print the error message only if the
 	 * @even_ebadmsg is true.
@@ -1177,7 +1177,13 @@ int ubifs_lookup_level0(struct ubifs_info *c, const union ubifs_key *key,
 {
 	int err, exact;
 	struct ubifs_znode *znode;
+#ifndef __UBOOT__
 	unsigned long time = get_seconds();
+#else
+	unsigned long time = ++c->tnc_clock;
+
+	ubifs_stats.lookups++;
+#endif
 
 	dbg_tnck(key, "search key ");
 	ubifs_assert(key_type(c, key) < UBIFS_INVALID_KEY);
@@ -1196,6 +1202,10 @@ int ubifs_lookup_level0(struct ubifs_info *c, const union ubifs_key *key,
 
 		exact = ubifs_search_zbranch(c, znode, key, n);
 
+#ifdef __UBOOT__
+		/* Keep the leaf as recent as its parents for ubifs_tnc_trim() */
+		znode->time = time;
+#endif
 		if (znode->level == 0)
 			break;
 
@@ -249,6 +249,73 @@ long ubifs_destroy_tnc_subtree(struct ubifs_znode *znode)
 	}
 }
 
+#ifdef __UBOOT__
+/**
+ * ubifs_tnc_trim - drop the least recently used znodes from the TNC.
+ * @c: UBIFS file-system description object
+ * @max: number of clean znodes which may stay in the TNC
+ *
+ * The TNC is kept between commands so that loading a file does not read the
+ * index from the media again. This function bounds its size: subtrees which
+ * were not used for the longest time are freed until at most @max clean znodes
+ * are left. A znode is never younger than its parent, so freeing whole
+ * subtrees in level order drops the oldest znodes first. Returns the number of
+ * freed znodes.
+ */
+long ubifs_tnc_trim(struct ubifs_info *c, long max)
+{
+	long total_freed = 0;
+
+	while (c->zroot.znode && atomic_long_read(&c->clean_zn_cnt) > max) {
+		struct ubifs_znode *znode, *zprev = NULL;
+		unsigned long oldest = c->tnc_clock, cutoff;
+		long pass_freed = 0;
+
+		znode = ubifs_tnc_levelorder_next(c->zroot.znode, NULL);
+		while (znode) {
+			if (!ubifs_zn_dirty(znode) && znode->time < oldest)
+				oldest = znode->time;
+			znode = ubifs_tnc_levelorder_next(c->zroot.znode,
+							  znode);
+		}
+
+		/* Drop the older half of what is cached, then check again */
+		cutoff = oldest + (c->tnc_clock - oldest) / 2;
+		znode = ubifs_tnc_levelorder_next(c->zroot.znode, NULL);
+		while (znode) {
+			long freed;
+
+			if (!ubifs_zn_dirty(znode) && !znode->cnext &&
+			    znode->time <= cutoff) {
+				if (znode->parent)
+					znode->parent->zbranch[znode->iip].znode = NULL;
+				else
+					c->zroot.znode = NULL;
+
+				freed = ubifs_destroy_tnc_subtree(znode);
+				atomic_long_sub(freed, &ubifs_clean_zn_cnt);
+				atomic_long_sub(freed, &c->clean_zn_cnt);
+				pass_freed += freed;
+				znode = zprev;
+			}
+
+			if (!c->zroot.znode)
+				break;
+
+			zprev = znode;
+			znode = ubifs_tnc_levelorder_next(c->zroot.znode, znode);
+		}
+
+		if (!pass_freed)
+			break;
+		total_freed += pass_freed;
+	}
+
+	ubifs_stats.znodes_trimmed += total_freed;
+	return total_freed;
+}
+#endif
+
 /**
  * read_znode - read an indexing node from flash and fill znode.
  * @c: UBIFS file-system description object
@@ -428,7 +495,12 @@ struct ubifs_znode *ubifs_load_znode(struct ubifs_info *c,
 
 	zbr->znode = znode;
 	znode->parent = parent;
+#ifndef __UBOOT__
 	znode->time = get_seconds();
+#else
+	znode->time = c->tnc_clock;
+	ubifs_stats.znode_reads++;
+#endif
 	znode->iip = iip;
 
 	return znode;
@@ -455,6 +527,9 @@ int ubifs_tnc_read_node(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 	int err, type = key_type(c, key);
 	struct ubifs_wbuf *wbuf;
 
+#ifdef __UBOOT__
+	ubifs_stats.node_reads++;
+#endif
 	/*
 	 * 'zbr' has to point to on-flash node. The node may sit in a bud and
 	 * may even be in a write buffer, so we have to take care about this.
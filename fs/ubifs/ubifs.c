@@ -17,6 +17,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <memalign.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include "ubifs.h"
 #include <part.h>
@@ -141,6 +142,9 @@ atomic_long_t ubifs_clean_zn_cnt;
 
 #endif
 
+/* Read path counters, shown by the ubifsstat command */
+struct ubifs_stats ubifs_stats;
+
 /**
  * ubifs_decompress - decompress data.
  * @in_buf: data to decompress
@@ -615,6 +619,7 @@ out_mem:
 		free(dir);
 
 out:
+	ubifs_tnc_trim(c, CONFIG_UBIFS_TNC_CACHE_ZNODES);
 	ubi_close_volume(c->ubi);
 	return ret;
 }
@@ -626,6 +631,7 @@ int ubifs_exists(const char *filename)
 
 	c->ubi = ubi_open_volume(c->vi.ubi_num, c->vi.vol_id, UBI_READONLY);
 	inum = ubifs_findfile(ubifs_sb, (char *)filename);
+	ubifs_tnc_trim(c, CONFIG_UBIFS_TNC_CACHE_ZNODES);
 	ubi_close_volume(c->ubi);
 
 	return inum != 0;
@@ -657,6 +663,7 @@ int ubifs_size(const char *filename, loff_t *size)
 
 	ubifs_iput(inode);
 out:
+	ubifs_tnc_trim(c, CONFIG_UBIFS_TNC_CACHE_ZNODES);
 	ubi_close_volume(c->ubi);
 	return err;
 }
@@ -672,23 +679,14 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+static int decompress_block(struct ubifs_info *c, struct inode *inode,
+			    void *addr, unsigned int block,
+			    struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	ulong start = timer_get_us();
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -699,8 +697,10 @@ static int read_block(struct inode *inode, void *addr, unsigned int block,
 	out_len = UBIFS_BLOCK_SIZE;
 	err = ubifs_decompress(c, &dn->data, dlen, addr, &out_len,
 			       le16_to_cpu(dn->compr_type));
+	ubifs_stats.decompress_us += timer_get_us() - start;
 	if (err || len != out_len)
 		goto dump;
+	ubifs_stats.decompress_bytes += len;
 
 	/*
 	 * Data length can be less than a full block, even for blocks that are
@@ -719,6 +719,92 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decompress_block(c, inode, addr, block, dn);
+}
+
+/**
+ * bulk_read - read a run of blocks with a single media read.
+ * @c: UBIFS file-system description object
+ * @inode: inode to read from
+ * @addr: where to put the data
+ * @block: first block to read
+ * @max_blocks: number of whole blocks which may be written to @addr
+ *
+ * Data nodes which follow each other in the same LEB are read in one go into
+ * the bulk-read buffer and decompressed from there. A long file is read one
+ * such run at a time. Returns the number of blocks filled in, %0 if @block
+ * should rather be read on its own, or a negative error code.
+ */
+static int bulk_read(struct ubifs_info *c, struct inode *inode, void *addr,
+		     unsigned int block, int max_blocks)
+{
+	struct bu_info *bu = &c->bu;
+	void *buf;
+	int err, i, n;
+
+	/* One block is read just as well without the bulk-read buffer */
+	if (!c->bulk_read || max_blocks < 2)
+		return 0;
+
+	data_key_init(c, &bu->key, inode->i_ino, block);
+	bu->buf_len = c->max_bu_buf_len;
+	err = ubifs_tnc_get_bu_keys(c, bu);
+	if (err)
+		return err;
+
+	/* Leave out nodes for blocks which do not fit the destination */
+	if (bu->blk_cnt > max_blocks)
+		bu->blk_cnt = max_blocks;
+	while (bu->cnt &&
+	       key_block(c, &bu->zbranch[bu->cnt - 1].key) >= block + bu->blk_cnt)
+		bu->cnt -= 1;
+	if (bu->cnt < 2)
+		return 0;
+
+	err = ubifs_tnc_bulk_read(c, bu);
+	if (err) {
+		ubifs_warn(c, "ignoring error %d and skipping bulk-read", err);
+		return 0;
+	}
+	ubifs_stats.bulk_reads++;
+	ubifs_stats.bulk_nodes += bu->cnt;
+
+	buf = bu->buf;
+	for (i = 0, n = 0; i < bu->blk_cnt; i++) {
+		struct ubifs_zbranch *zbr = &bu->zbranch[n];
+
+		if (n < bu->cnt && key_block(c, &zbr->key) == block + i) {
+			err = decompress_block(c, inode, addr, block + i, buf);
+			if (err)
+				return err;
+			buf += ALIGN(zbr->len, 8);
+			n++;
+		} else {
+			/* Not in the index, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		}
+		addr += UBIFS_BLOCK_SIZE;
+	}
+
+	return bu->blk_cnt;
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		       struct page *page, int last_block_size)
 {
@@ -839,8 +925,9 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	unsigned long inum;
 	struct inode *inode;
 	struct page page;
+	ulong start = timer_get_us();
 	int err = 0;
-	int i;
+	int i, n;
 	int count;
 	int last_block_size = 0;
 
@@ -890,19 +977,33 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	page.addr = buf;
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
-	for (i = 0; i < count; i++) {
+	for (i = 0; i < count; i += n) {
 		/*
-		 * Make sure to not read beyond the requested size
+		 * Whole blocks go straight to the destination, so the last
+		 * one is always left to do_readpage()
 		 */
-		if (((i + 1) == count) && (size < inode->i_size))
-			last_block_size = size - (i * PAGE_SIZE);
-
-		err = do_readpage(c, inode, &page, last_block_size);
-		if (err)
+		n = bulk_read(c, inode, page.addr,
+			      page.index << UBIFS_BLOCKS_PER_PAGE_SHIFT,
+			      count - i - 1);
+		if (n < 0) {
+			err = n;
 			break;
+		}
+		if (!n) {
+			/*
+			 * Make sure to not read beyond the requested size
+			 */
+			if (((i + 1) == count) && (size < inode->i_size))
+				last_block_size = size - (i * PAGE_SIZE);
+
+			err = do_readpage(c, inode, &page, last_block_size);
+			if (err)
+				break;
+			n = 1;
+		}
 
-		page.addr += PAGE_SIZE;
-		page.index++;
+		page.addr += n * PAGE_SIZE;
+		page.index += n;
 	}
 
 	if (err) {
@@ -911,11 +1012,15 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	} else {
 		*actread = size;
 	}
+	ubifs_stats.file_reads++;
+	ubifs_stats.file_bytes += *actread;
+	ubifs_stats.file_us += timer_get_us() - start;
 
 put_inode:
 	ubifs_iput(inode);
 
 out:
+	ubifs_tnc_trim(c, CONFIG_UBIFS_TNC_CACHE_ZNODES);
 	ubi_close_volume(c->ubi);
 	return err;
 }
@@ -924,6 +1029,43 @@ void ubifs_close(void)
 {
 }
 
+static unsigned long kib_per_sec(unsigned long long bytes,
+				 unsigned long long us)
+{
+	return us ? div64_u64((bytes >> 10) * 1000000, us) : 0;
+}
+
+void ubifs_show_stats(void)
+{
+	struct ubifs_stats *st = &ubifs_stats;
+
+	printf("index:      %lu lookups, %lu znodes read, %lu dropped",
+	       st->lookups, st->znode_reads, st->znodes_trimmed);
+	if (ubifs_sb) {
+		struct ubifs_info *c = ubifs_sb->s_fs_info;
+
+		printf(", %ld cached",
+		       atomic_long_read(&c->clean_zn_cnt));
+	}
+	printf("\n");
+	printf("leaves:     %lu single reads, %lu data nodes in %lu bulk-reads\n",
+	       st->node_reads, st->bulk_nodes, st->bulk_reads);
+	printf("media:      %lu reads, %llu bytes in %llu us (%lu KiB/s)\n",
+	       st->media_reads, st->media_bytes, st->media_us,
+	       kib_per_sec(st->media_bytes, st->media_us));
+	printf("decompress: %llu bytes in %llu us (%lu KiB/s)\n",
+	       st->decompress_bytes, st->decompress_us,
+	       kib_per_sec(st->decompress_bytes, st->decompress_us));
+	printf("files:      %lu reads, %llu bytes in %llu us (%lu KiB/s)\n",
+	       st->file_reads, st->file_bytes, st->file_us,
+	       kib_per_sec(st->file_bytes, st->file_us));
+}
+
+void ubifs_reset_stats(void)
+{
+	memset(&ubifs_stats, '\0', sizeof(ubifs_stats));
+}
+
 /* Compat wrappers for common/cmd_ubifs.c */
 int ubifs_load(char *filename, u32 addr, u32 size)
 {
@@ -1403,6 +1403,42 @@ struct bu_info {
 	int eof;
 };
 
+#ifdef __UBOOT__
+/**
+ * struct ubifs_stats - read path counters, shown by the ubifsstat command.
+ * @lookups: number of TNC lookups
+ * @znode_reads: number of indexing nodes read from the media
+ * @znodes_trimmed: number of znodes dropped from the TNC between commands
+ * @node_reads: number of leaf nodes read one at a time
+ * @bulk_reads: number of bulk-reads
+ * @bulk_nodes: number of data nodes read by bulk-reads
+ * @media_reads: number of reads from the UBI volume
+ * @media_bytes: number of bytes read from the UBI volume
+ * @media_us: time spent reading from the UBI volume in microseconds
+ * @decompress_bytes: number of bytes produced by the decompressors
+ * @decompress_us: time spent decompressing data nodes in microseconds
+ * @file_reads: number of file reads
+ * @file_bytes: number of bytes returned by file reads
+ * @file_us: time spent in file reads in microseconds
+ */
+struct ubifs_stats {
+	unsigned long lookups;
+	unsigned long znode_reads;
+	unsigned long znodes_trimmed;
+	unsigned long node_reads;
+	unsigned long bulk_reads;
+	unsigned long bulk_nodes;
+	unsigned long media_reads;
+	unsigned long long media_bytes;
+	unsigned long long media_us;
+	unsigned long long decompress_bytes;
+	unsigned long long decompress_us;
+	unsigned long file_reads;
+	unsigned long long file_bytes;
+	unsigned long long file_us;
+};
+#endif
+
 /**
  * struct ubifs_node_range - node length range description data structure.
  * @len: fixed node length
@@ -1830,6 +1866,9 @@ struct ubifs_debug_info;
  * @mount_opts: UBIFS-specific mount options
  *
  * @dbg: debugging-related information
+ *
+ * @tnc_clock: incremented on every TNC lookup, used to age znodes since U-Boot
+ *             has no wall clock
  */
 struct ubifs_info {
 	struct super_block *vfs_sb;
@@ -2062,12 +2101,17 @@ struct ubifs_info {
 
 #ifndef __UBOOT__
 	struct ubifs_debug_info *dbg;
+#else
+	unsigned long tnc_clock;
 #endif
 };
 
 extern struct list_head ubifs_infos;
 extern spinlock_t ubifs_infos_lock;
 extern atomic_long_t ubifs_clean_zn_cnt;
+#ifdef __UBOOT__
+extern struct ubifs_stats ubifs_stats;
+#endif
 extern struct kmem_cache *ubifs_inode_slab;
 extern const struct super_operations ubifs_super_operations;
 extern const struct xattr_handler *ubifs_xattr_handlers[];
@@ -2231,6 +2275,9 @@ struct ubifs_znode *ubifs_load_znode(struct ubifs_info *c,
 				     struct ubifs_znode *parent, int iip);
 int ubifs_tnc_read_node(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 			void *node);
+#ifdef __UBOOT__
+long ubifs_tnc_trim(struct ubifs_info *c, long max);
+#endif
 
 /* tnc_commit.c */
 int ubifs_tnc_start_commit(struct ubifs_info *c, struct ubifs_zbranch *zroot);
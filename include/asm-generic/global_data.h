@@ -230,6 +230,18 @@ struct global_data {
 	 */
 	void *dm_priv_base;
 # endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_TABLE)
+	/**
+	 * @uclass_table: uclasses indexed by ID, used by uclass_find()
+	 */
+	struct uclass_table *uclass_table;
+#endif
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+	/**
+	 * @dm_lazy: devicetree nodes waiting to be bound, see lists_defer_fdt()
+	 */
+	struct lists_lazy *dm_lazy;
+#endif
 #endif
 #ifdef CONFIG_TIMER
 	/**
@@ -529,6 +541,22 @@ static_assert(sizeof(struct global_data) == GD_SIZE);
 #define gd_dm_priv_base()		NULL
 #endif
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_TABLE)
+#define gd_set_uclass_table(tab)	gd->uclass_table = tab
+#define gd_uclass_table()		gd->uclass_table
+#else
+#define gd_set_uclass_table(tab)
+#define gd_uclass_table()		((struct uclass_table *)NULL)
+#endif
+
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+#define gd_set_dm_lazy(lazy)		gd->dm_lazy = lazy
+#define gd_dm_lazy()			gd->dm_lazy
+#else
+#define gd_set_dm_lazy(lazy)
+#define gd_dm_lazy()			((struct lists_lazy *)NULL)
+#endif
+
 #ifdef CONFIG_GENERATE_ACPI_TABLE
 #define gd_acpi_ctx()		gd->acpi_ctx
 #define gd_acpi_start()		gd->acpi_start
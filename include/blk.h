@@ -121,11 +121,6 @@ struct blk_desc {
 
 #if CONFIG_IS_ENABLED(BLOCK_CACHE)
 
-/**
- * blkcache_init() - initialize the block cache list pointers
- */
-int blkcache_init(void);
-
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
@@ -170,8 +165,11 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * The cache is made up of @entries page-sized slots, grouped into sets of a
+ * few ways each. Requests larger than @blocks bypass the cache.
+ *
+ * @param blocks - maximum blocks per cached request
+ * @param entries - number of slots in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
@@ -181,9 +179,12 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
+	unsigned evictions;
+	unsigned entries; /* current slot count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned ways; /* slots per set */
+	unsigned slot_size; /* bytes per slot */
 };
 
 /**
@@ -271,6 +272,23 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * map() - get direct access to blocks held in memory
+	 *
+	 * Devices whose contents are already in memory, such as RAM disks
+	 * and memory-mapped images, can return a pointer to the blocks so
+	 * that callers can use the data in place instead of copying it into
+	 * a buffer. The data must only be read through this pointer.
+	 *
+	 * @dev:	Device to map
+	 * @start:	Start block number to map (0=first)
+	 * @blkcnt:	Number of blocks which must be accessible
+	 * @ptrp:	Returns a pointer to the contents of block @start
+	 * @return 0 if OK, -ve error number if the blocks cannot be mapped
+	 */
+	int (*map)(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		   void **ptrp);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -288,6 +306,79 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_dmap() - get direct access to blocks of a memory-backed device
+ *
+ * See struct blk_ops.map()
+ *
+ * @block_dev:	Block device to map
+ * @start:	Start block number to map (0=first)
+ * @blkcnt:	Number of blocks which must be accessible
+ * @ptrp:	Returns a pointer to the contents of block @start
+ * Return: 0 if OK, -ENOSYS if the device does not support this, -ERANGE if
+ * the blocks are beyond the end of the device, other -ve on error
+ */
+int blk_dmap(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
+	     void **ptrp);
+
+/**
+ * struct blk_readahead_stats - statistics of the readahead window
+ *
+ * @reads:	Number of read requests made through blk_dread()
+ * @merged:	Number of those requests served entirely from the window
+ * @issued:	Number of read requests issued to the device
+ * @blocks:	Number of blocks read from the device by those requests
+ */
+struct blk_readahead_stats {
+	ulong reads;
+	ulong merged;
+	ulong issued;
+	lbaint_t blocks;
+};
+
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+/**
+ * blk_set_readahead_max() - limit the readahead window of a device
+ *
+ * Drivers call this from probe to report the largest number of blocks they
+ * can transfer in one request. The window never grows beyond this, nor
+ * beyond CONFIG_BLOCK_READAHEAD_SIZE.
+ *
+ * @dev:	Block device to update
+ * @blocks:	Maximum number of blocks per read request
+ */
+void blk_set_readahead_max(struct udevice *dev, lbaint_t blocks);
+
+/**
+ * blk_readahead_invalidate() - discard the readahead window of a device
+ *
+ * This must be called when the device contents may have changed behind the
+ * back of the block uclass, e.g. because a removable card was replaced.
+ *
+ * @dev:	Block device to update
+ */
+void blk_readahead_invalidate(struct udevice *dev);
+
+/**
+ * blk_get_readahead_stats() - get and reset readahead statistics
+ *
+ * @dev:	Block device to check
+ * @stats:	Returns the statistics gathered since the last call
+ */
+void blk_get_readahead_stats(struct udevice *dev,
+			     struct blk_readahead_stats *stats);
+#else
+static inline void blk_set_readahead_max(struct udevice *dev,
+					 lbaint_t blocks) {}
+static inline void blk_readahead_invalidate(struct udevice *dev) {}
+
+static inline void blk_get_readahead_stats(struct udevice *dev,
+					   struct blk_readahead_stats *stats)
+{
+	*stats = (struct blk_readahead_stats){};
+}
+#endif
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -493,6 +584,12 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
+static inline int blk_dmap(struct blk_desc *block_dev, lbaint_t start,
+			   lbaint_t blkcnt, void **ptrp)
+{
+	return -ENOSYS;
+}
+
 /**
  * struct blk_driver - Driver for block interface types
  *
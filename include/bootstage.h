@@ -209,6 +209,10 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_UBI_SCAN,
+	BOOTSTAGE_ID_ACCUM_UBI_EC,
+	BOOTSTAGE_ID_ACCUM_UBI_VOL,
+	BOOTSTAGE_ID_ACCUM_UBI_FM,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
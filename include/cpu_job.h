@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running jobs on secondary cores
+ *
+ * U-Boot itself only runs on the boot core. With CPU_JOB, self-contained
+ * work such as decompressing or hashing an image can be handed to the other
+ * cores of the SoC while the boot core carries on. There is no scheduler:
+ * each secondary core (a worker) has its own stack and a small ring of jobs
+ * which it runs in order.
+ *
+ * A job runs concurrently with the boot core, so it must only touch the
+ * memory it was given. It may allocate memory, since malloc() takes a lock
+ * while workers are running, but it must not print, use devices or start
+ * other jobs. The same applies to anything it calls, apart from
+ * WATCHDOG_RESET() which does nothing on a worker.
+ */
+
+#ifndef __CPU_JOB_H
+#define __CPU_JOB_H
+
+#include <linux/types.h>
+
+enum cpu_job_state {
+	CPU_JOB_IDLE,
+	CPU_JOB_QUEUED,
+	CPU_JOB_DONE,
+};
+
+/**
+ * struct cpu_job - a job for a secondary core
+ *
+ * This is owned by the caller and must stay around until cpu_job_wait()
+ * returns, or cpu_job_wait_timeout() returns a value other than -ETIMEDOUT.
+ *
+ * @func:	function to run
+ * @arg:	argument for @func
+ * @ret:	return value of @func, valid once @state is CPU_JOB_DONE
+ * @state:	state of the job (enum cpu_job_state)
+ */
+struct cpu_job {
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+	int state;
+};
+
+#if CONFIG_IS_ENABLED(CPU_JOB)
+/**
+ * cpu_job_queue() - run a function on a secondary core
+ *
+ * The secondary cores are started on first use. If none can be started or
+ * all of them have a full ring, the job is run straight away instead.
+ *
+ * @job:	job to fill in and queue
+ * @func:	function to run
+ * @arg:	argument for @func
+ */
+void cpu_job_queue(struct cpu_job *job, int (*func)(void *arg), void *arg);
+
+/**
+ * cpu_job_wait_timeout() - wait for a job to complete
+ *
+ * The watchdog is kept alive while waiting. If the job has not completed
+ * after @timeout_ms and its worker has not started it yet, it is run on the
+ * boot core instead.
+ *
+ * @job:	job passed to cpu_job_queue()
+ * @timeout_ms:	time to wait for the worker in milliseconds
+ * Return: value returned by the job function, or -ETIMEDOUT if the job is
+ * still running on its worker. In that case the job must be left alone,
+ * since the worker still uses it; its work can be redone on the boot core
+ * if that is safe.
+ */
+int cpu_job_wait_timeout(struct cpu_job *job, ulong timeout_ms);
+
+/**
+ * cpu_job_wait() - wait for a job to complete
+ *
+ * This is cpu_job_wait_timeout() with CONFIG_CPU_JOB_TIMEOUT, except that
+ * it carries on waiting, with the watchdog kept alive, if the job is still
+ * running on its worker after that.
+ *
+ * @job:	job passed to cpu_job_queue()
+ * Return: value returned by the job function
+ */
+int cpu_job_wait(struct cpu_job *job);
+
+/**
+ * cpu_job_stop() - finish all jobs and stop the secondary cores
+ *
+ * This must be called before booting an OS, which expects to start the
+ * secondary cores itself. The cores are started again if another job is
+ * queued.
+ *
+ * Return: 0 if OK, -EBUSY if a core did not stop. It is then still running
+ * U-Boot code, so the OS must not be booted.
+ */
+int cpu_job_stop(void);
+
+/**
+ * cpu_job_on_worker() - check whether the caller runs as a job
+ *
+ * Return: true if running on a secondary core, false on the boot core
+ */
+bool cpu_job_on_worker(void);
+
+/**
+ * cpu_job_lock() - take a lock shared with the secondary cores
+ *
+ * This does nothing while no secondary core is running, so it can be used
+ * from code which also runs before relocation.
+ *
+ * @lock:	lock, 0 when free
+ */
+void cpu_job_lock(int *lock);
+
+/**
+ * cpu_job_unlock() - release a lock taken with cpu_job_lock()
+ *
+ * @lock:	lock to release
+ */
+void cpu_job_unlock(int *lock);
+
+/**
+ * cpu_job_worker() - run jobs until told to stop
+ *
+ * This is called by the architecture code on the secondary core, with the
+ * stack passed to arch_cpu_job_start()
+ *
+ * @worker:	worker number
+ */
+void cpu_job_worker(int worker);
+
+/**
+ * arch_cpu_job_start() - start a secondary core
+ *
+ * The core must call cpu_job_worker() with the same @worker and give itself
+ * back to the firmware when that returns.
+ *
+ * @worker:	worker number, starting at 0
+ * @stack_top:	top of the stack for the core
+ * Return: 0 if OK, -ENODEV if there is no such core, other -ve on error
+ */
+int arch_cpu_job_start(int worker, void *stack_top);
+
+/**
+ * arch_cpu_job_stop() - wait for a secondary core to stop
+ *
+ * @worker:	worker number
+ * Return: 0 if OK, -ve on error
+ */
+int arch_cpu_job_stop(int worker);
+
+/**
+ * arch_cpu_job_on_worker() - check whether the caller runs on a worker
+ *
+ * Return: true if so
+ */
+bool arch_cpu_job_on_worker(void);
+
+/**
+ * arch_cpu_job_idle() - wait a little, or until arch_cpu_job_wake()
+ */
+void arch_cpu_job_idle(void);
+
+/**
+ * arch_cpu_job_wake() - wake up cores in arch_cpu_job_idle()
+ */
+void arch_cpu_job_wake(void);
+#else
+static inline void cpu_job_queue(struct cpu_job *job, int (*func)(void *arg),
+				 void *arg)
+{
+	job->ret = func(arg);
+	job->state = CPU_JOB_DONE;
+}
+
+static inline int cpu_job_wait_timeout(struct cpu_job *job,
+				       ulong timeout_ms)
+{
+	return job->ret;
+}
+
+static inline int cpu_job_wait(struct cpu_job *job)
+{
+	return job->ret;
+}
+
+static inline int cpu_job_stop(void)
+{
+	return 0;
+}
+
+static inline bool cpu_job_on_worker(void)
+{
+	return false;
+}
+
+static inline void cpu_job_lock(int *lock)
+{
+}
+
+static inline void cpu_job_unlock(int *lock)
+{
+}
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
+#include <linux/errno.h>
 
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
@@ -64,6 +65,127 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   struct driver *drv, bool pre_reloc_only);
 
+/**
+ * lists_use_hash() - Select whether drivers are found using hash tables
+ *
+ * With CONFIG_DM_DRIVER_HASH, drivers are found by name or compatible string
+ * using hash tables, once the full malloc() is available. This allows
+ * searching the linker list instead, e.g. to compare the two in tests. The
+ * hash tables are never used if there are too many drivers for them.
+ *
+ * @use: true to use the hash tables, false to search the linker list
+ */
+#if CONFIG_IS_ENABLED(DM_DRIVER_HASH)
+void lists_use_hash(bool use);
+#else
+static inline void lists_use_hash(bool use) {}
+#endif
+
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * lists_lazy_start() - Start recording devicetree nodes instead of binding
+ *
+ * While scanning the devicetree after this, a node may be recorded rather
+ * than bound. It is bound later, when its uclass is first used or when a
+ * device is looked up by its node. Only nodes without subnodes, whose parent
+ * does not look after its children (as buses do), whose driver and uclass
+ * have no bind() or post_bind() method and whose uclass does not exist yet
+ * are recorded.
+ *
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int lists_lazy_start(void);
+
+/**
+ * lists_lazy_stop() - Stop recording devicetree nodes
+ *
+ * Nodes which are found after this are bound straight away. Nodes which were
+ * recorded earlier are still bound when needed.
+ */
+void lists_lazy_stop(void);
+
+/**
+ * lists_lazy_free() - Forget all recorded devicetree nodes
+ *
+ * This is used when driver model is set up again, since the nodes were
+ * recorded for devices which no longer exist.
+ */
+void lists_lazy_free(void);
+
+/**
+ * lists_defer_fdt() - Record a devicetree node to be bound later, if possible
+ *
+ * @parent: Parent device for the device that would be created
+ * @node: Devicetree node to record
+ * @pre_reloc_only: Value to pass to lists_bind_fdt() later
+ * Return: true if the node was recorded, false if it should be bound now
+ */
+bool lists_defer_fdt(struct udevice *parent, ofnode node, bool pre_reloc_only);
+
+/**
+ * lists_bind_deferred() - Bind the devicetree nodes recorded for a uclass
+ *
+ * @id: Uclass ID, normally for a uclass which has just been created
+ */
+void lists_bind_deferred(enum uclass_id id);
+
+/**
+ * lists_bind_deferred_node() - Bind a devicetree node, if it was recorded
+ *
+ * All the nodes recorded for the same uclass are bound, in the order they
+ * were found, so that the devices are numbered as they would be otherwise.
+ *
+ * @node: Devicetree node to bind
+ * Return: 0 if OK or @node was not recorded, -ve on error
+ */
+int lists_bind_deferred_node(ofnode node);
+
+/**
+ * lists_drop_deferred() - Forget the nodes recorded for a parent device
+ *
+ * This must be called before @parent is unbound.
+ *
+ * @parent: Parent device
+ */
+void lists_drop_deferred(struct udevice *parent);
+
+/**
+ * lists_deferred_count() - Get the number of devicetree nodes still recorded
+ *
+ * Return: number of nodes which have not been bound yet
+ */
+int lists_deferred_count(void);
+#else
+static inline int lists_lazy_start(void)
+{
+	return -ENOSYS;
+}
+
+static inline void lists_lazy_stop(void) {}
+
+static inline void lists_lazy_free(void) {}
+
+static inline bool lists_defer_fdt(struct udevice *parent, ofnode node,
+				   bool pre_reloc_only)
+{
+	return false;
+}
+
+static inline void lists_bind_deferred(enum uclass_id id) {}
+
+static inline int lists_bind_deferred_node(ofnode node)
+{
+	return 0;
+}
+
+static inline void lists_drop_deferred(struct udevice *parent) {}
+
+static inline int lists_deferred_count(void)
+{
+	return 0;
+}
+#endif
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -479,6 +479,18 @@ int of_count_phandle_with_args(const struct device_node *np,
 			       const char *list_name, const char *cells_name,
 			       int cells_count);
 
+/**
+ * of_phandle_scan() - Build a table of the nodes which have a phandle
+ *
+ * This lets of_find_node_by_phandle() find nodes in the live tree without
+ * walking the whole tree each time. The table covers the tree at gd->of_root
+ * when this is called. Nodes which are given a phandle later are added to the
+ * table when they are first looked up.
+ *
+ * Return: 0 if OK, -ENOMEM if not enough memory
+ */
+int of_phandle_scan(void);
+
 /**
  * of_alias_scan() - Scan all properties of the 'aliases' node
  *
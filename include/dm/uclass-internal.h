@@ -329,6 +329,27 @@ static inline int uclass_pre_remove_device(struct udevice *dev) { return 0; }
  */
 int uclass_get_count(void);
 
+/**
+ * struct uclass_table - uclasses indexed by ID
+ *
+ * This is filled in as uclasses are created or found, so that uclass_find()
+ * only needs to search the list of uclasses once for each ID.
+ *
+ * @complete:	true if the table holds every uclass, i.e. there were none
+ *		when it was set up, so that IDs not in the table have no uclass
+ * @finds:	Number of calls to uclass_find()
+ * @walks:	Number of those calls which searched the list of uclasses
+ * @steps:	Number of uclasses looked at by those searches
+ * @uc:		uclass for each ID, or NULL if not known yet
+ */
+struct uclass_table {
+	bool complete;
+	ulong finds;
+	ulong walks;
+	ulong steps;
+	struct uclass *uc[UCLASS_COUNT];
+};
+
 /**
  * uclass_find() - Find uclass by its id
  *
@@ -337,6 +358,18 @@ int uclass_get_count(void);
  */
 struct uclass *uclass_find(enum uclass_id key);
 
+/**
+ * uclass_table_init() - Set up the table used by uclass_find()
+ *
+ * This is called when driver model starts. Any existing table is emptied.
+ * No table is set up until the full malloc() is available, e.g. before
+ * relocation. Without a table, or if it cannot be allocated, uclass_find()
+ * searches the list of uclasses instead.
+ *
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int uclass_table_init(void);
+
 /**
  * uclass_destroy() - Destroy a uclass
  *
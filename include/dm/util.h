@@ -57,6 +57,14 @@ void dm_dump_static_driver_info(void);
  */
 void dm_dump_mem(struct dm_stats *stats);
 
+/**
+ * dm_dump_lookups() - Dump stats on how uclasses were found
+ *
+ * This shows how many calls to uclass_find() used the table of uclasses and
+ * how many had to search the list of uclasses.
+ */
+void dm_dump_lookups(void);
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA_INST) && CONFIG_IS_ENABLED(READ_ONLY)
 void *dm_priv_to_rw(void *priv);
 #else
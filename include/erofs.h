@@ -16,4 +16,17 @@ void erofs_close(void);
 void erofs_closedir(struct fs_dir_stream *dirs);
 int erofs_uuid(char *uuid_str);
 
+/**
+ * erofs_show_stats() - Print the counters of the pcluster cache
+ *
+ * This shows how often a read was served from a decompressed physical
+ * cluster kept by an earlier read, and how often one was replaced.
+ */
+void erofs_show_stats(void);
+
+/**
+ * erofs_reset_stats() - Clear the counters of the pcluster cache
+ */
+void erofs_reset_stats(void);
+
 #endif /* _EROFS_H */
@@ -152,6 +152,11 @@ void ext4fs_reinit_global(void);
 int ext4fs_ls(const char *dirname);
 int ext4fs_exists(const char *filename);
 int ext4fs_size(const char *filename, loff_t *size);
+int ext4fs_open_file(const char *filename, void **handlep, loff_t *sizep);
+int ext4fs_pread(void *handle, void *buf, loff_t offset, loff_t len,
+		 loff_t *actread);
+void ext4fs_release(void *handle);
+int ext4fs_map(const char *filename, loff_t offset, loff_t len, loff_t *posp);
 void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot);
 int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
@@ -163,6 +168,16 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actread);
 int ext4_read_superblock(char *buffer);
 int ext4fs_uuid(char *uuid_str);
+
+/**
+ * ext4fs_invalidate() - forget what is known about the files on a device
+ *
+ * This drops the cached block runs of the last file read, after the device
+ * was written to behind the back of the filesystem.
+ *
+ * @desc:	block device, or NULL for all devices
+ */
+void ext4fs_invalidate(struct blk_desc *desc);
 void ext_cache_init(struct ext_block_cache *cache);
 void ext_cache_fini(struct ext_block_cache *cache);
 int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size);
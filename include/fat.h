@@ -21,12 +21,15 @@ struct disk_partition;
 #define PREFETCH_BLOCKS		2
 
 #define MAX_CLUSTSIZE	CONFIG_FS_FAT_MAX_CLUSTSIZE
+/* Largest FAT which is read in one go, in bytes */
+#define MAX_FATCACHE	(IS_ENABLED(CONFIG_SPL_BUILD) ? 0 : \
+			 CONFIG_FS_FAT_CACHE_SIZE * 1024ULL)
 
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
 #define FATBUFBLOCKS	6
-#define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
+#define FATBUFSIZE	(mydata->sect_size * mydata->fatbufblocks)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
@@ -169,10 +172,13 @@ typedef struct dir_slot {
  */
 typedef struct {
 	__u8	*fatbuf;	/* Current FAT buffer */
+	__u32	fatbufblocks;	/* Length of fatbuf in sectors */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
 	__u8	fat_dirty;      /* Set if fatbuf has been modified */
+	__u32	dirty_first;	/* First modified sector in fatbuf */
+	__u32	dirty_last;	/* Last modified sector in fatbuf */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
@@ -182,6 +188,7 @@ typedef struct {
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
 	int	fats;		/* Number of FATs */
+	u32	volume_id;	/* Volume ID from the boot sector */
 } fsdata;
 
 struct fat_itr;
@@ -210,6 +217,7 @@ int file_fat_write(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actwrite);
 int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		  loff_t *actread);
+int fat_map(const char *filename, loff_t offset, loff_t len, loff_t *posp);
 int fat_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
 void fat_closedir(struct fs_dir_stream *dirs);
@@ -218,6 +226,16 @@ int fat_mkdir(const char *dirname);
 void fat_close(void);
 void *fat_next_cluster(fat_itr *itr, unsigned int *nbytes);
 
+/**
+ * fat_invalidate() - forget what is known about the files on a device
+ *
+ * This drops the cached cluster runs of the last file read, after the
+ * device was written to behind the back of the filesystem.
+ *
+ * @desc:	block device, or NULL for all devices
+ */
+void fat_invalidate(struct blk_desc *desc);
+
 /**
  * fat_uuid() - get FAT volume ID
  *
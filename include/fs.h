@@ -151,6 +151,25 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * fs_map() - get a pointer to file data, without copying it
+ *
+ * This works when the device previously set by fs_set_blk_dev() holds its
+ * data in memory and the filesystem stores the requested part of the file in
+ * one piece, uncompressed. The data must only be read.
+ *
+ * @filename:	full path of the file
+ * @offset:	offset in the file of the data
+ * @len:	the number of bytes wanted. Use 0 for the rest of the file.
+ * @bufp:	returns a pointer to the data
+ * @actmap:	returns the number of bytes available at @bufp
+ * Return:	0 if OK, -ENOSYS if the device or filesystem cannot do this,
+ *		-ENXIO if the data is not stored in one piece, other -ve error
+ *		number on error
+ */
+int fs_map(const char *filename, loff_t offset, loff_t len, void **bufp,
+	   loff_t *actmap);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
@@ -255,6 +274,289 @@ int fs_unlink(const char *filename);
  */
 int fs_mkdir(const char *filename);
 
+/*
+ * Handles to mounted filesystems and open files
+ *
+ * The calls above probe the filesystem and look up the file every time, which
+ * is slow when a file is read a small piece at a time. A mounted filesystem
+ * is probed once and stays open between calls, for as long as nothing else
+ * is selected with fs_set_blk_dev(). Files opened on it are looked up once.
+ */
+struct fs_mount;
+struct fs_file;
+
+/**
+ * fs_mount() - Mount the filesystem on a partition
+ *
+ * @desc: Block device
+ * @part: Partition number, 0 for the whole device
+ * @mntp: Returns the mounted filesystem
+ * Return: 0 if OK, -ENODEV if no filesystem was found, -ENOMEM if out of
+ *	memory
+ */
+int fs_mount(struct blk_desc *desc, int part, struct fs_mount **mntp);
+
+/**
+ * fs_unmount() - Unmount a filesystem
+ *
+ * Any files still open on it are closed.
+ *
+ * @mnt: Filesystem to unmount, may be NULL
+ */
+void fs_unmount(struct fs_mount *mnt);
+
+/**
+ * fs_detach() - Stop using a filesystem whose volume has gone away
+ *
+ * The files open on it stay open, but cannot be read, so that their owner
+ * can still close them. The filesystem must still be unmounted.
+ *
+ * @mnt: Filesystem to detach, may be NULL
+ */
+void fs_detach(struct fs_mount *mnt);
+
+/**
+ * fs_set_mount() - Select a mounted filesystem for the next call
+ *
+ * This does the same job as fs_set_blk_dev(), for use with the calls which
+ * take a filename, but does not probe the filesystem if it is still open.
+ *
+ * @mnt: Filesystem to use
+ * Return: 0 if OK, -EIO if the filesystem could not be probed again, -ENODEV
+ *	if its device has been removed
+ */
+int fs_set_mount(struct fs_mount *mnt);
+
+/**
+ * fs_file_open() - Open a file on a mounted filesystem
+ *
+ * Like the calls above, this leaves no filesystem selected.
+ *
+ * @mnt: Filesystem holding the file
+ * @filename: Full path of the file
+ * @filep: Returns the open file
+ * Return: 0 if OK, -ENOENT if the file was not found, other -ve on error
+ */
+int fs_file_open(struct fs_mount *mnt, const char *filename,
+		 struct fs_file **filep);
+
+/**
+ * fs_file_size() - Get the size of an open file
+ *
+ * @file: File to check
+ * @sizep: Returns the size of the file
+ * Return: 0 if OK, -ve on error
+ */
+int fs_file_size(struct fs_file *file, loff_t *sizep);
+
+/**
+ * fs_pread() - Read from an open file
+ *
+ * Reading stops at the end of the file, so fewer than @len bytes may be read.
+ * Unlike fs_read(), a @len of 0 reads nothing.
+ *
+ * @file: File to read
+ * @buf: Buffer to read into
+ * @offset: Position in the file to read from
+ * @len: Number of bytes to read
+ * @actread: Returns the number of bytes read
+ * Return: 0 if OK, -ve on error
+ */
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread);
+
+/**
+ * fs_file_close() - Close an open file
+ *
+ * @file: File to close, may be NULL
+ */
+void fs_file_close(struct fs_file *file);
+
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_FS_LOADER)
+/**
+ * fs_invalidate() - Forget what is known about the filesystems on a device
+ *
+ * This must be called when the contents of a device may have changed. It
+ * drops the cached file lookups and closes any mounted filesystem on the
+ * device, so that it is probed again when next used.
+ *
+ * @desc: Block device, or NULL for all devices
+ */
+void fs_invalidate(struct blk_desc *desc);
+
+/**
+ * fs_remove_dev() - Forget a block device which is being removed
+ *
+ * This does the same as fs_invalidate() and also detaches any filesystem
+ * mounted on the device, so that it is not probed on a later device which
+ * happens to reuse @desc. The mounts must still be unmounted by their owners.
+ *
+ * @desc: Block device being removed
+ */
+void fs_remove_dev(struct blk_desc *desc);
+#else
+static inline void fs_invalidate(struct blk_desc *desc)
+{
+}
+
+static inline void fs_remove_dev(struct blk_desc *desc)
+{
+}
+#endif
+
+struct disk_partition;
+
+/**
+ * struct fs_cache_stats - statistics of the file lookup cache
+ *
+ * @hits: Number of lookups answered from the cache
+ * @misses: Number of lookups which went to the filesystem
+ * @evictions: Number of entries reused for another file
+ * @invalidations: Number of entries dropped because the device changed
+ * @used: Number of entries in use
+ * @size: Number of entries in the cache
+ */
+struct fs_cache_stats {
+	ulong hits;
+	ulong misses;
+	ulong evictions;
+	ulong invalidations;
+	int used;
+	int size;
+};
+
+#if CONFIG_IS_ENABLED(FS_CACHE)
+/**
+ * fs_cache_select() - Select the filesystem that lookups refer to
+ *
+ * This is called by the fs layer once it has found the filesystem on a
+ * partition. Only filesystems on a block device are cached.
+ *
+ * @desc: Block device, or NULL to stop caching until the next call
+ * @part: Partition number
+ * @info: Partition information
+ * @fstype: Filesystem type (FS_TYPE_...)
+ */
+void fs_cache_select(struct blk_desc *desc, int part,
+		     struct disk_partition *info, int fstype);
+
+/**
+ * fs_cache_get_exists() - Look up whether a file exists
+ *
+ * @path: Path of the file
+ * @existsp: Returns the value returned by the filesystem's exists() method
+ * Return: true if found in the cache, false if the filesystem must be asked
+ */
+bool fs_cache_get_exists(const char *path, int *existsp);
+
+/**
+ * fs_cache_set_exists() - Record whether a file exists
+ *
+ * @path: Path of the file
+ * @exists: Value returned by the filesystem's exists() method
+ */
+void fs_cache_set_exists(const char *path, int exists);
+
+/**
+ * fs_cache_get_size() - Look up the size of a file
+ *
+ * @path: Path of the file
+ * @sizep: Returns the size of the file
+ * @retp: Returns the value returned by the filesystem's size() method
+ * Return: true if found in the cache, false if the filesystem must be asked
+ */
+bool fs_cache_get_size(const char *path, loff_t *sizep, int *retp);
+
+/**
+ * fs_cache_set_size() - Record the size of a file
+ *
+ * @path: Path of the file
+ * @size: Size of the file
+ * @ret: Value returned by the filesystem's size() method
+ */
+void fs_cache_set_size(const char *path, loff_t size, int ret);
+
+/**
+ * fs_cache_get_handle() - Look up the filesystem's handle for a file
+ *
+ * The handle lets a filesystem find a file without walking the directories
+ * again, e.g. ext4 records the inode number and FAT the start cluster and
+ * size.
+ *
+ * @path: Path of the file
+ * @handlep: Returns the handle
+ * Return: true if found in the cache, false if the filesystem must look
+ */
+bool fs_cache_get_handle(const char *path, u64 *handlep);
+
+/**
+ * fs_cache_set_handle() - Record the filesystem's handle for a file
+ *
+ * @path: Path of the file
+ * @handle: Handle for the file
+ */
+void fs_cache_set_handle(const char *path, u64 handle);
+
+/**
+ * fs_cache_invalidate() - Drop the entries for a block device
+ *
+ * This is called by fs_invalidate() when the contents of a device may have
+ * changed.
+ *
+ * @desc: Block device, or NULL for all devices
+ */
+void fs_cache_invalidate(struct blk_desc *desc);
+
+/**
+ * fs_cache_get_stats() - Get the statistics of the cache
+ *
+ * @stats: Returns the statistics
+ */
+void fs_cache_get_stats(struct fs_cache_stats *stats);
+
+/**
+ * fs_cache_clear() - Empty the cache and reset its statistics
+ */
+void fs_cache_clear(void);
+#else
+static inline void fs_cache_select(struct blk_desc *desc, int part,
+				   struct disk_partition *info, int fstype)
+{
+}
+
+static inline bool fs_cache_get_exists(const char *path, int *existsp)
+{
+	return false;
+}
+
+static inline void fs_cache_set_exists(const char *path, int exists)
+{
+}
+
+static inline bool fs_cache_get_size(const char *path, loff_t *sizep,
+				     int *retp)
+{
+	return false;
+}
+
+static inline void fs_cache_set_size(const char *path, loff_t size, int ret)
+{
+}
+
+static inline bool fs_cache_get_handle(const char *path, u64 *handlep)
+{
+	return false;
+}
+
+static inline void fs_cache_set_handle(const char *path, u64 handle)
+{
+}
+
+static inline void fs_cache_invalidate(struct blk_desc *desc)
+{
+}
+#endif
+
 /*
  * Common implementation for various filesystem commands, optionally limited
  * to a specific filesystem type via the fstype parameter.
@@ -300,4 +602,15 @@ int do_fs_type(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[]);
  */
 int do_fs_types(struct cmd_tbl *cmdtp, int flag, int argc, char * const argv[]);
 
+/**
+ * do_fs_cache() - Show or clear the file lookup cache
+ *
+ * @cmdtp: Command information for fs cache
+ * @flag: Command flags (CMD_FLAG_...)
+ * @argc: Number of arguments
+ * @argv: List of arguments
+ * Return: result (see enum command_ret_t)
+ */
+int do_fs_cache(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[]);
+
 #endif /* _FS_H */
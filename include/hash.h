@@ -98,6 +98,16 @@ struct hash_algo {
 int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 		 int flag, int argc, char *const argv[]);
 
+/**
+ * hash_bench() - Show the throughput of each hash algorithm
+ *
+ * Each algorithm hashes the buffer repeatedly for a fixed time.
+ *
+ * @addr:		Address of the data to hash
+ * @len:		Number of bytes to hash each time
+ */
+void hash_bench(ulong addr, ulong len);
+
 /**
  * hash_block() - Hash a block according to the requested algorithm
  *
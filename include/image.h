@@ -860,6 +860,35 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * image_decomp_msg() - print the message shown by image_decomp()
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @type:	OS type (IH_OS_...)
+ * @is_xip:	true if the image is used where it is (load == image_start)
+ */
+void image_decomp_msg(int comp, int type, bool is_xip);
+
+/**
+ * image_decomp_data() - decompress an image without printing anything
+ *
+ * This is image_decomp() without the messages, so that it can run as a job
+ * on another core (see cpu_job.h). Decompressors may still report errors.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start Image start address (where we are decompressing from)
+ * @load_buf:	Place to decompress to
+ * @image_buf:	Address to decompress from
+ * @image_len:	Number of bytes in @image_buf to decompress
+ * @unc_len:	Available space for decompression
+ * @load_end:	Returns the end of the decompressed data
+ * Return: 0 if OK, -ENOSYS if @comp is not supported, other -ve on error
+ */
+int image_decomp_data(int comp, ulong load, ulong image_start,
+		      void *load_buf, void *image_buf, ulong image_len,
+		      uint unc_len, ulong *load_end);
+
 /**
  * Set up properties in the FDT
  *
@@ -1249,6 +1278,193 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+/* Size of the pieces a loader reads while hashing a FIT, to stay in cache */
+#define FIT_STREAM_CHUNK	(256 * 1024)
+
+/* Maximum number of hash subnodes of one image hashed while loading */
+#define FIT_STREAM_MAX_HASHES	2
+
+/**
+ * struct fit_hash_stream - hashes of one FIT image computed as it is loaded
+ *
+ * @data:	address the image data is loaded to
+ * @size:	size of the image data
+ * @done:	number of bytes hashed so far
+ * @count:	number of entries in @hash
+ * @hash:	progressive hash context for each hash subnode of the image
+ */
+struct fit_hash_stream {
+	const void *data;
+	size_t size;
+	size_t done;
+	int count;
+	struct {
+		struct hash_algo *algo;
+		void *ctx;
+	} hash[FIT_STREAM_MAX_HASHES];
+};
+
+#if CONFIG_IS_ENABLED(FIT_STREAM_VERIFY) && !defined(USE_HOSTCC)
+/**
+ * fit_hash_stream_init() - start hashing an image before it is loaded
+ *
+ * This sets up a progressive hash context for each hash subnode of the
+ * image which uses an algorithm with progressive support. Images without
+ * such a subnode, and ciphered images, leave @st with no contexts; they are
+ * then hashed as usual by fit_image_verify_with_data().
+ *
+ * @st:		stream to set up
+ * @fit:	FIT holding the image node
+ * @image_noffset: offset of the image node in @fit
+ * @data:	address the image data will be loaded to
+ * @size:	size of the image data
+ * Return: 0 if OK, -ENOMEM if a hash context could not be allocated
+ */
+int fit_hash_stream_init(struct fit_hash_stream *st, const void *fit,
+			 int image_noffset, const void *data, size_t size);
+
+/**
+ * fit_hash_stream_update() - hash the next part of an image
+ *
+ * @st:		stream for the image
+ * @buf:	next bytes of the image data, in load order
+ * @len:	number of bytes in @buf
+ */
+void fit_hash_stream_update(struct fit_hash_stream *st, const void *buf,
+			    size_t len);
+
+/**
+ * fit_hash_stream_finish() - finish hashing an image
+ *
+ * If the whole image was hashed, the digests are recorded so that the next
+ * fit_image_verify_with_data() on the same data does not need to read it
+ * again. The contexts are freed in any case.
+ *
+ * @st:		stream for the image
+ */
+void fit_hash_stream_finish(struct fit_hash_stream *st);
+
+/**
+ * fit_stream_get_digest() - get a digest computed while loading
+ *
+ * A digest is only handed out once, so that verifying the image a second
+ * time (e.g. after it was modified in memory) hashes the data again. Only
+ * digests from the current load are used, see fit_stream_drop().
+ *
+ * @data:	image data
+ * @size:	size of the image data
+ * @algo:	name of the hash algorithm
+ * @value:	returns the digest, FIT_MAX_HASH_LEN bytes
+ * @value_len:	returns the length of the digest
+ * Return: true if a digest was found, false if the data must be hashed
+ */
+bool fit_stream_get_digest(const void *data, size_t size, const char *algo,
+			   uint8_t *value, int *value_len);
+
+/**
+ * fit_stream_drop() - forget all digests computed while loading
+ *
+ * This must be called whenever memory holding loaded images may have been
+ * written.
+ */
+void fit_stream_drop(void);
+
+/**
+ * fit_stream_check_cmd() - drop digests before running a command
+ *
+ * Any command which may write to memory (e.g. 'mw', 'cp', a raw 'mmc read')
+ * drops the digests, so that only commands known to leave memory alone can
+ * sit between loading a FIT and booting it.
+ *
+ * @name:	name of the command about to run
+ */
+void fit_stream_check_cmd(const char *name);
+
+/**
+ * fit_stream_load_start() - tell that a file is being loaded to memory
+ *
+ * This is used by loaders which do not know whether they are loading a
+ * FIT, such as 'tftpboot' or 'load'. If the file starts with a FIT header,
+ * the images with external data are hashed as they arrive. Digests from a
+ * previous load are dropped.
+ *
+ * @addr:	load address of the file
+ */
+void fit_stream_load_start(ulong addr);
+
+/**
+ * fit_stream_load_data() - tell that part of the file was loaded
+ *
+ * The data must arrive in order. A gap or overlap stops the hashing for
+ * the rest of the file.
+ *
+ * @offset:	offset in the file of the data, which is already in memory
+ * @len:	number of bytes
+ */
+void fit_stream_load_data(ulong offset, ulong len);
+
+/**
+ * fit_stream_load_active() - check whether the current load is being hashed
+ *
+ * Return: true until the file is known not to be a FIT, or hashing stopped
+ */
+bool fit_stream_load_active(void);
+
+/**
+ * fit_stream_load_want() - get the size of the next piece to load
+ *
+ * Loaders which can choose how much to read at a time use this to read the
+ * FIT header in as few pieces as possible, then the images in pieces of
+ * FIT_STREAM_CHUNK bytes.
+ *
+ * Return: number of bytes to read next, while fit_stream_load_active()
+ */
+ulong fit_stream_load_want(void);
+
+/**
+ * fit_stream_load_end() - tell that the file is loaded
+ *
+ * Images which are not complete are dropped.
+ */
+void fit_stream_load_end(void);
+#else
+static inline int fit_hash_stream_init(struct fit_hash_stream *st,
+				       const void *fit, int image_noffset,
+				       const void *data, size_t size)
+{
+	st->count = 0;
+
+	return 0;
+}
+
+static inline void fit_hash_stream_update(struct fit_hash_stream *st,
+					  const void *buf, size_t len) {}
+static inline void fit_hash_stream_finish(struct fit_hash_stream *st) {}
+
+static inline bool fit_stream_get_digest(const void *data, size_t size,
+					 const char *algo, uint8_t *value,
+					 int *value_len)
+{
+	return false;
+}
+
+static inline void fit_stream_drop(void) {}
+static inline void fit_stream_check_cmd(const char *name) {}
+static inline void fit_stream_load_start(ulong addr) {}
+static inline void fit_stream_load_data(ulong offset, ulong len) {}
+static inline bool fit_stream_load_active(void)
+{
+	return false;
+}
+
+static inline ulong fit_stream_load_want(void)
+{
+	return FIT_STREAM_CHUNK;
+}
+
+static inline void fit_stream_load_end(void) {}
+#endif
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
@@ -1155,4 +1155,67 @@ struct abuf;
  */
 int zstd_decompress(struct abuf *in, struct abuf *out);
 
+/**
+ * struct zstd_frame - a frame within Zstandard data
+ *
+ * Frames are independent of each other, so once their sizes are known they
+ * can be decompressed in any order, or at the same time.
+ *
+ * @src: Start of the compressed frame
+ * @src_len: Size of the compressed frame
+ * @dst_off: Offset of the frame's output within the decompressed data
+ * @dst_len: Size of the frame's output, 0 for a skippable frame
+ */
+struct zstd_frame {
+	const void *src;
+	size_t src_len;
+	size_t dst_off;
+	size_t dst_len;
+};
+
+/**
+ * zstd_find_frames() - Find the frames in Zstandard data
+ *
+ * This only reads the frame and block headers. It fails if the content size
+ * of a frame is not recorded in its header, since the output offset of the
+ * following frames is then unknown.
+ *
+ * @in: Input buffer holding one or more frames
+ * @frames: Returns the frames found, may be NULL if @max_frames is 0
+ * @max_frames: Maximum number of frames to put in @frames
+ * Return: number of frames in @in, which may be more than @max_frames,
+ *	-ENOENT if a frame does not record its content size, -EINVAL if the
+ *	data is not valid
+ */
+int zstd_find_frames(struct abuf *in, struct zstd_frame *frames,
+		     int max_frames);
+
+/**
+ * zstd_decompress_frame() - Decompress a single frame
+ *
+ * This only touches @frame, @workspace and the frame's part of @out, so it
+ * can run as a job on another core while other frames are decompressed.
+ *
+ * @frame: Frame to decompress, as found by zstd_find_frames()
+ * @workspace: Workspace of ZSTD_DCtxWorkspaceBound() bytes
+ * @out: Output buffer for all the frames
+ * Return: 0 if OK, -ENOSPC if @out is too small, -EINVAL if the frame is
+ *	not valid
+ */
+int zstd_decompress_frame(const struct zstd_frame *frame, void *workspace,
+			  struct abuf *out);
+
+/**
+ * zstd_decompress_frames() - Decompress Zstandard data frame by frame
+ *
+ * The frames are shared out between the secondary cores when CPU_JOB is
+ * enabled, with the boot core taking its share too.
+ *
+ * @in: Input buffer to decompress
+ * @out: Output buffer to hold the results (must be large enough)
+ * Return: size of the decompressed data, or -ve on error (see
+ *	zstd_find_frames() and zstd_decompress_frame())
+ */
+int zstd_decompress_frames(struct abuf *in, struct abuf *out);
+
 #endif  /* ZSTD_H */
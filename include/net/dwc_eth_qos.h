@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Synopsys DWC Ethernet QOS controller statistics
+ */
+
+#ifndef __NET_DWC_ETH_QOS_H
+#define __NET_DWC_ETH_QOS_H
+
+#include <linux/types.h>
+
+struct udevice;
+
+/**
+ * struct eqos_stats - DMA ring statistics
+ *
+ * @rx_packets:		packets handed to the network stack
+ * @tx_packets:		packets transmitted
+ * @rx_missed:		packets dropped by the DMA for lack of RX descriptors
+ * @rx_overflows:	packets dropped because the RX FIFO overflowed
+ * @rx_refills:		number of RX refill batches given back to the DMA
+ * @rx_refilled:	number of RX descriptors given back to the DMA
+ * @tx_stalls:		transmits which timed out waiting for the DMA
+ */
+struct eqos_stats {
+	ulong rx_packets;
+	ulong tx_packets;
+	ulong rx_missed;
+	ulong rx_overflows;
+	ulong rx_refills;
+	ulong rx_refilled;
+	ulong tx_stalls;
+};
+
+/**
+ * struct eqos_rings - DMA ring sizes
+ *
+ * @rx_descs:		number of RX descriptors
+ * @tx_descs:		number of TX descriptors
+ * @rx_refill_batch:	number of RX descriptors given back to the DMA at once
+ */
+struct eqos_rings {
+	uint rx_descs;
+	uint tx_descs;
+	uint rx_refill_batch;
+};
+
+/**
+ * eqos_get_stats() - Get the DMA ring statistics of a controller
+ *
+ * @dev: Ethernet device
+ * @rings: Returns the ring sizes
+ * @stats: Returns the statistics since the last time they were cleared
+ * @clear: true to clear the statistics after reading them
+ * Return: 0 if OK, -ENODEV if @dev is not an active DWC Ethernet QOS device
+ */
+int eqos_get_stats(struct udevice *dev, struct eqos_rings *rings,
+		   struct eqos_stats *stats, bool clear);
+
+#endif
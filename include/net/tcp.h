@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client for network loaders
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <net.h>
+
+/**
+ * struct ip_tcp_hdr - IP and TCP header, without options
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* sequence number		*/
+	u32		tcp_ack;	/* acknowledgment number	*/
+	u8		tcp_hlen;	/* 4 bits header length, 4 reserved */
+	u8		tcp_flags;	/* control flags		*/
+	u16		tcp_win;	/* receive window		*/
+	u16		tcp_xsum;	/* checksum			*/
+	u16		tcp_urg;	/* urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+#define TCP_FIN		BIT(0)
+#define TCP_SYN		BIT(1)
+#define TCP_RST		BIT(2)
+#define TCP_PSH		BIT(3)
+#define TCP_ACK		BIT(4)
+#define TCP_URG		BIT(5)
+
+/* TCP options */
+#define TCP_OPT_EOL		0
+#define TCP_OPT_NOP		1
+#define TCP_OPT_MSS		2
+#define TCP_OPT_WS		3
+
+/* Options sent with our SYN: MSS and window scale (with a NOP pad) */
+#define TCP_SYN_OPT_SIZE	8
+
+/* Largest segment we accept, for a standard 1500 byte Ethernet MTU */
+#define TCP_MSS			(1500 - IP_TCP_HDR_SIZE)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_CLOSE_WAIT,
+	TCP_FIN_WAIT_1,
+	TCP_FIN_WAIT_2,
+	TCP_CLOSING,
+	TCP_LAST_ACK,
+};
+
+/**
+ * struct tcp_ops - callbacks for the user of a TCP connection
+ *
+ * @connected:	the three-way handshake completed
+ * @receive:	in-order data received from the peer; called with each byte
+ *		of the stream exactly once
+ * @closed:	the connection ended: 0 if the peer closed it gracefully
+ *		(FIN), -ECONNREFUSED, -ECONNRESET or -ETIMEDOUT otherwise
+ */
+struct tcp_ops {
+	void (*connected)(void);
+	void (*receive)(const uchar *data, unsigned int len);
+	void (*closed)(int err);
+};
+
+/**
+ * struct tcp_stats - counters for the current connection
+ *
+ * @segs_in:		segments received
+ * @segs_out:		segments sent
+ * @bytes_in:		payload bytes passed to tcp_ops->receive
+ * @ooo_segs:		segments received ahead of a hole
+ * @dup_acks:		duplicate ACKs sent for out-of-order segments
+ * @retransmits:	segments retransmitted after a timeout
+ * @fast_retransmits:	segments retransmitted after three duplicate ACKs
+ */
+struct tcp_stats {
+	ulong segs_in;
+	ulong segs_out;
+	ulong bytes_in;
+	ulong ooo_segs;
+	ulong dup_acks;
+	ulong retransmits;
+	ulong fast_retransmits;
+};
+
+/**
+ * tcp_connect() - open a connection
+ *
+ * This sends a SYN to @dest and must be called from within net_loop().
+ * Progress is reported through @ops. Any connection left over from a
+ * previous net_loop() is dropped.
+ *
+ * @dest:	IP address of the server
+ * @dport:	TCP port of the server
+ * @ops:	callbacks for the connection
+ * Return: 0 if OK, -ENOMEM if the reassembly buffer could not be allocated
+ */
+int tcp_connect(struct in_addr dest, u16 dport, const struct tcp_ops *ops);
+
+/**
+ * tcp_write() - queue data to send to the peer
+ *
+ * The data is copied and kept until it is acknowledged.
+ *
+ * @buf:	data to send
+ * @len:	number of bytes to send
+ * Return: 0 if OK, -ENOTCONN if not connected, -ENOSPC if the data does
+ *	not fit in the send buffer
+ */
+int tcp_write(const void *buf, unsigned int len);
+
+/**
+ * tcp_close() - close our side of the connection by sending a FIN
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - reset the connection
+ *
+ * This sends a RST if the connection is open and frees the connection
+ * state. No callbacks are made after this.
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_get_state() - get the state of the connection
+ *
+ * Return: connection state
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_get_stats() - get the counters of the last connection
+ *
+ * @stats:	returns the counters
+ */
+void tcp_get_stats(struct tcp_stats *stats);
+
+/**
+ * tcp_receive() - process a received TCP segment
+ *
+ * Called by net_process_received_packet().
+ *
+ * @ip:		IP packet holding the segment
+ * @len:	length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+/**
+ * net_set_tcp_header() - fill in the IP and TCP headers of a segment
+ *
+ * @pkt:	start of the IP header
+ * @dest:	destination IP address
+ * @dport:	destination port
+ * @sport:	source port
+ * @payload_len: number of payload bytes following the headers
+ * @action:	TCP flags
+ * @tcp_seq_num: sequence number
+ * @tcp_ack_num: acknowledgment number
+ * Return: size of the IP and TCP headers, including options
+ */
+int net_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+#endif /* __TCP_H__ */
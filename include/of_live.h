@@ -9,11 +9,43 @@
 #ifndef _OF_LIVE_H
 #define _OF_LIVE_H
 
+#include <linux/types.h>
+
 struct device_node;
+struct property;
+
+/**
+ * struct of_live_prebuilt - Live tree generated at build time
+ *
+ * With CONFIG_OF_LIVE_PREBUILT, dtoc generates the live tree for U-Boot's own
+ * devicetree, so that it does not need to be unflattened at runtime. This is
+ * only used if the devicetree is unchanged, e.g. no overlays were applied.
+ *
+ * @root: Root node of the tree
+ * @props: All the properties in the tree
+ * @value_offset: Offset of each property value in the devicetree, or 0 if
+ *	the property was added by dtoc and has its own value
+ * @prop_count: Number of properties in @props and @value_offset
+ * @fdt_size: Size of the devicetree this was generated from
+ * @fdt_crc: CRC32 of the devicetree this was generated from
+ */
+struct of_live_prebuilt {
+	struct device_node *root;
+	struct property *props;
+	const u32 *value_offset;
+	int prop_count;
+	u32 fdt_size;
+	u32 fdt_crc;
+};
+
+extern struct of_live_prebuilt of_live_prebuilt;
 
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
  *
+ * This uses the tree generated at build time, if enabled and generated from
+ * @fdt_blob, else unflattens the tree.
+ *
  * @fdt_blob: Input tree to convert
  * @rootp: Returns live tree that was created
  * Return: 0 if OK, -ve on error
@@ -162,6 +162,33 @@ void *os_realloc(void *ptr, size_t length);
  */
 void os_usleep(unsigned long usec);
 
+/**
+ * os_thread_create() - start a host thread
+ *
+ * @func:	function to run in the thread
+ * @arg:	argument for @func
+ * Return:	thread handle, or NULL on error
+ */
+void *os_thread_create(void (*func)(void *arg), void *arg);
+
+/**
+ * os_thread_join() - wait for a host thread to finish
+ *
+ * This also frees the thread handle.
+ *
+ * @thread:	handle from os_thread_create()
+ * Return:	0 if OK, -1 on error
+ */
+int os_thread_join(void *thread);
+
+/**
+ * os_thread_is_self() - check whether the caller runs in a host thread
+ *
+ * @thread:	handle from os_thread_create()
+ * Return:	true if the caller is @thread
+ */
+bool os_thread_is_self(void *thread);
+
 /**
  * Gets a monotonic increasing number of nano seconds from the OS
  *
@@ -416,7 +443,9 @@ int os_read_file(const char *name, void **bufp, int *sizep);
 /**
  * os_map_file() - Map a file from the host filesystem into memory
  *
- * This can be useful when to provide a backing store for an emulated device
+ * This can be useful when to provide a backing store for an emulated device.
+ * With OS_O_RDONLY the mapping is read-only. Changes made to the file through
+ * other means are visible in the mapping.
  *
  * @pathname:	File pathname to map
  * @os_flags:	Flags, like OS_O_RDONLY, OS_O_RDWR
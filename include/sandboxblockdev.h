@@ -15,6 +15,8 @@ struct host_block_dev {
 #endif
 	char *filename;
 	int fd;
+	void *buf;
+	int size;
 };
 
 /**
@@ -31,4 +31,17 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	       loff_t size, loff_t *actread);
 void ubifs_close(void);
 
+/**
+ * ubifs_show_stats() - Print the UBIFS read path counters
+ *
+ * This shows how much of the index was read and cached, how data nodes were
+ * read and the time spent reading the media, decompressing and loading files.
+ */
+void ubifs_show_stats(void);
+
+/**
+ * ubifs_reset_stats() - Clear the UBIFS read path counters
+ */
+void ubifs_reset_stats(void);
+
 #endif /* __UBIFS_UBOOT_H__ */
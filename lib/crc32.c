@@ -84,7 +84,7 @@ static void __efi_runtime make_crc_table(void)
   }
   crc_table_empty = 0;
 }
-#elif !defined(CONFIG_ARM64_CRC32)
+#else
 /* ========================================================================
  * Table of CRC-32's of all single-byte values (made by make_crc_table)
  */
@@ -170,6 +170,47 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+#if defined(CONFIG_ARM64_CRC32) && !defined(USE_HOSTCC)
+/*
+ * The CRC32 instructions are optional in ARMv8.0, so they are only used when
+ * ID_AA64ISAR0_EL1.CRC32 says they are there
+ */
+static bool __efi_runtime crc32_insn_present(void)
+{
+	u64 isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> 16) & 0xf;
+}
+
+static uint32_t __efi_runtime crc32_arm64(uint32_t crc, const Bytef *buf,
+					  uInt len)
+{
+	while (len && ((uintptr_t)buf & 7)) {
+		crc = __builtin_aarch64_crc32b(crc, *buf++);
+		len--;
+	}
+	for (; len >= 8; len -= 8, buf += 8)
+		crc = __builtin_aarch64_crc32x(crc,
+					       le64_to_cpu(*(const u64 *)buf));
+	if (len & 4) {
+		crc = __builtin_aarch64_crc32w(crc,
+					       le32_to_cpu(*(const u32 *)buf));
+		buf += 4;
+	}
+	if (len & 2) {
+		crc = __builtin_aarch64_crc32h(crc,
+					       le16_to_cpu(*(const u16 *)buf));
+		buf += 2;
+	}
+	if (len & 1)
+		crc = __builtin_aarch64_crc32b(crc, *buf);
+
+	return crc;
+}
+#endif
+
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -184,15 +225,13 @@ const uint32_t * ZEXPORT get_crc_table()
  */
 uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
-#ifdef CONFIG_ARM64_CRC32
-    crc = cpu_to_le32(crc);
-    while (len--)
-        crc = __builtin_aarch64_crc32b(crc, *buf++);
-    return le32_to_cpu(crc);
-#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
+#if defined(CONFIG_ARM64_CRC32) && !defined(USE_HOSTCC)
+    if (crc32_insn_present())
+        return le32_to_cpu(crc32_arm64(cpu_to_le32(crc), buf, len));
+#endif
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
     if (crc_table_empty)
       make_crc_table();
@@ -227,7 +266,6 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     }
 
     return le32_to_cpu(crc);
-#endif
 }
 #undef DO_CRC
 
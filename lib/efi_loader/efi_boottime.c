@@ -615,20 +615,29 @@ efi_status_t efi_remove_all_protocols(const efi_handle_t handle)
 /**
  * efi_delete_handle() - delete handle
  *
+ * The handle is kept if any of its protocols cannot be removed.
+ *
  * @handle: handle to delete
+ * Return: status code
  */
-void efi_delete_handle(efi_handle_t handle)
+efi_status_t efi_delete_handle(efi_handle_t handle)
 {
 	efi_status_t ret;
 
 	ret = efi_remove_all_protocols(handle);
 	if (ret == EFI_INVALID_PARAMETER) {
 		log_err("Can't remove invalid handle %p\n", handle);
-		return;
+		return ret;
+	}
+	if (ret != EFI_SUCCESS) {
+		log_err("Can't remove the protocols of handle %p\n", handle);
+		return ret;
 	}
 
 	list_del(&handle->link);
 	free(handle);
+
+	return EFI_SUCCESS;
 }
 
 /**
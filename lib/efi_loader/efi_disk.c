@@ -684,6 +684,8 @@ static int efi_disk_probe(void *ctx, struct event *event)
  */
 static int efi_disk_delete_raw(struct udevice *dev)
 {
+	struct efi_simple_file_system_protocol *volume = NULL;
+	struct efi_device_path *dp = NULL;
 	efi_handle_t handle;
 	struct blk_desc *desc;
 	struct efi_disk_obj *diskobj;
@@ -694,10 +696,16 @@ static int efi_disk_delete_raw(struct udevice *dev)
 	desc = dev_get_uclass_plat(dev);
 	if (desc->if_type != IF_TYPE_EFI_LOADER) {
 		diskobj = container_of(handle, struct efi_disk_obj, header);
-		efi_free_pool(diskobj->dp);
+		dp = diskobj->dp;
+		volume = diskobj->volume;
 	}
 
-	efi_delete_handle(handle);
+	/* Anything still installed may be in use, so keep it all */
+	if (efi_delete_handle(handle) != EFI_SUCCESS)
+		return -1;
+	if (dp)
+		efi_free_pool(dp);
+	efi_simple_file_system_delete(volume);
 	dev_tag_del(dev, DM_TAG_EFI);
 
 	return 0;
@@ -715,6 +723,8 @@ static int efi_disk_delete_raw(struct udevice *dev)
  */
 static int efi_disk_delete_part(struct udevice *dev)
 {
+	struct efi_simple_file_system_protocol *volume;
+	struct efi_device_path *dp;
 	efi_handle_t handle;
 	struct efi_disk_obj *diskobj;
 
@@ -722,9 +732,14 @@ static int efi_disk_delete_part(struct udevice *dev)
 		return -1;
 
 	diskobj = container_of(handle, struct efi_disk_obj, header);
+	volume = diskobj->volume;
+	dp = diskobj->dp;
 
-	efi_free_pool(diskobj->dp);
-	efi_delete_handle(handle);
+	/* Anything still installed may be in use, so keep it all */
+	if (efi_delete_handle(handle) != EFI_SUCCESS)
+		return -1;
+	efi_free_pool(dp);
+	efi_simple_file_system_delete(volume);
 	dev_tag_del(dev, DM_TAG_EFI);
 
 	return 0;
@@ -25,6 +25,9 @@ struct file_system {
 	struct efi_device_path *dp;
 	struct blk_desc *desc;
 	int part;
+	struct fs_mount *mnt;
+	int refs;		/* number of open file handles */
+	bool deleted;		/* volume gone, freed when the last is closed */
 };
 #define to_fs(x) container_of(x, struct file_system, base)
 
@@ -35,6 +38,9 @@ struct file_handle {
 	int isdir;
 	u64 open_mode;
 
+	/* for reading a file: */
+	struct fs_file *file;
+
 	/* for reading a directory: */
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
@@ -53,9 +59,25 @@ static char *basename(struct file_handle *fh)
 	return fh->path;
 }
 
+/**
+ * set_blk_dev() - select the file system of a file handle
+ *
+ * The file system is mounted on first use and stays mounted, so that it is
+ * not probed again for each call.
+ *
+ * @fh:		file handle
+ * Return:	0 for success
+ */
 static int set_blk_dev(struct file_handle *fh)
 {
-	return fs_set_blk_dev_with_part(fh->fs->desc, fh->fs->part);
+	struct file_system *fs = fh->fs;
+
+	if (fs->deleted)
+		return -1;
+	if (!fs->mnt && fs_mount(fs->desc, fs->part, &fs->mnt))
+		return -1;
+
+	return fs_set_mount(fs->mnt);
 }
 
 /**
@@ -234,10 +256,18 @@ static struct efi_file_handle *file_open(struct file_system *fs,
 
 		/* figure out if file is a directory: */
 		fh->isdir = is_dir(fh);
+
+		/*
+		 * Look the file up once for all the reads. If this fails,
+		 * reading and getting the size fail as they did before.
+		 */
+		if (!fh->isdir)
+			fs_file_open(fs->mnt, fh->path, &fh->file);
 	} else {
 		fh->isdir = 1;
 		strcpy(fh->path, "");
 	}
+	fs->refs++;
 
 	return &fh->base;
 
@@ -362,10 +392,24 @@ out:
 	return EFI_EXIT(ret);
 }
 
+/* Free a file system, unmounting it */
+static void file_system_free(struct file_system *fs)
+{
+	fs_unmount(fs->mnt);
+	free(fs);
+}
+
 static efi_status_t file_close(struct file_handle *fh)
 {
-	fs_closedir(fh->dirs);
+	struct file_system *fs = fh->fs;
+
+	/* A directory stream would select the device, which may be gone */
+	if (!fs->deleted)
+		fs_closedir(fh->dirs);
+	fs_file_close(fh->file);
 	free(fh);
+	if (!--fs->refs && fs->deleted)
+		file_system_free(fs);
 	return EFI_SUCCESS;
 }
 
@@ -400,6 +444,12 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 static efi_status_t efi_get_file_size(struct file_handle *fh,
 				      loff_t *file_size)
 {
+	if (fh->file) {
+		if (fs_file_size(fh->file, file_size))
+			return EFI_DEVICE_ERROR;
+		return EFI_SUCCESS;
+	}
+
 	if (set_blk_dev(fh))
 		return EFI_DEVICE_ERROR;
 
@@ -468,10 +518,8 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 		return ret;
 	}
 
-	if (set_blk_dev(fh))
-		return EFI_DEVICE_ERROR;
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (!fh->file || fs_pread(fh->file, buffer, fh->offset, *buffer_size,
+				  &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -868,6 +916,10 @@ static efi_status_t EFIAPI efi_file_getinfo(struct efi_file_handle *file,
 		efi_uintn_t required_size;
 		int r;
 
+		if (fh->fs->deleted) {
+			ret = EFI_DEVICE_ERROR;
+			goto error;
+		}
 		if (fh->fs->part >= 1)
 			r = part_get_info(fh->fs->desc, fh->fs->part, &part);
 		else
@@ -1166,3 +1218,20 @@ efi_simple_file_system(struct blk_desc *desc, int part,
 
 	return &fs->base;
 }
+
+void efi_simple_file_system_delete(struct efi_simple_file_system_protocol *v)
+{
+	struct file_system *fs;
+
+	if (!v)
+		return;
+
+	fs = to_fs(v);
+	fs->deleted = true;
+	fs->desc = NULL;
+	/* Open files keep it until they are closed, but cannot be read */
+	if (fs->refs)
+		fs_detach(fs->mnt);
+	else
+		file_system_free(fs);
+}
@@ -13,8 +13,10 @@
 #include <linux/libfdt.h>
 #include <of_live.h>
 #include <malloc.h>
+#include <dm/of.h>
 #include <dm/of_access.h>
 #include <linux/err.h>
+#include <u-boot/crc.h>
 
 static void *unflatten_dt_alloc(void **mem, unsigned long size,
 				unsigned long align)
@@ -303,12 +305,47 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes)
 	return 0;
 }
 
+/**
+ * of_live_use_prebuilt() - Use the live tree generated at build time
+ *
+ * The tree is only used if @blob is the devicetree that it was generated
+ * from. Its property values are then pointed into @blob, as they would be by
+ * unflatten_device_tree()
+ *
+ * @blob: Devicetree in use
+ * @rootp: Returns the root of the live tree
+ * Return: 0 if OK, -ENOENT if the tree was not generated from @blob
+ */
+static int of_live_use_prebuilt(const void *blob, struct device_node **rootp)
+{
+	const struct of_live_prebuilt *pre = &of_live_prebuilt;
+	int i;
+
+	if (fdt_check_header(blob) || fdt_totalsize(blob) != pre->fdt_size ||
+	    crc32(0, blob, pre->fdt_size) != pre->fdt_crc)
+		return -ENOENT;
+
+	for (i = 0; i < pre->prop_count; i++) {
+		if (pre->value_offset[i])
+			pre->props[i].value = (void *)blob + pre->value_offset[i];
+	}
+	*rootp = pre->root;
+
+	return 0;
+}
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
-	int ret;
+	int ret = -ENOENT;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	if (CONFIG_IS_ENABLED(OF_LIVE_PREBUILT)) {
+		ret = of_live_use_prebuilt(fdt_blob, rootp);
+		if (ret)
+			log_debug("Devicetree has changed, unflattening it\n");
+	}
+	if (ret)
+		ret = unflatten_device_tree(fdt_blob, rootp);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
@@ -318,7 +355,11 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 		debug("Failed to scan live tree aliases: err=%d\n", ret);
 		return ret;
 	}
+	/* The phandle table only speeds up lookups, so carry on without it */
+	ret = of_phandle_scan();
+	if (ret)
+		log_warning("Failed to scan live tree phandles: err=%d\n", ret);
 	debug("%s: stop\n", __func__);
 
-	return ret;
+	return 0;
 }
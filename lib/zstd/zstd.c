@@ -7,12 +7,240 @@
 
 #include <common.h>
 #include <abuf.h>
+#include <cpu_job.h>
 #include <log.h>
 #include <malloc.h>
 #include <linux/zstd.h>
 
+/* Number of cores which can decompress frames at the same time */
+#if CONFIG_IS_ENABLED(CPU_JOB)
+#define ZSTD_LANES	(CONFIG_CPU_JOB_WORKERS + 1)
+#else
+#define ZSTD_LANES	1
+#endif
+
+/**
+ * struct zstd_lane - frames decompressed by one core
+ *
+ * @job: Job running the lane on a secondary core
+ * @frames: All the frames
+ * @count: Number of frames
+ * @first: First frame handled by this lane
+ * @step: Number of lanes, i.e. the distance to the next frame of this lane
+ * @workspace: Decompression workspace for this lane
+ * @out: Output buffer for all the frames
+ */
+struct zstd_lane {
+	struct cpu_job job;
+	const struct zstd_frame *frames;
+	int count;
+	int first;
+	int step;
+	void *workspace;
+	struct abuf *out;
+};
+
+/* Read the header of the frame at @src, which has its output at @dst_off */
+static int zstd_read_frame(const u8 *src, size_t left, size_t dst_off,
+			   struct zstd_frame *frame)
+{
+	unsigned long long dst_len;
+	size_t src_len;
+
+	src_len = ZSTD_findFrameCompressedSize(src, left);
+	if (ZSTD_isError(src_len) || src_len > left)
+		return -EINVAL;
+	dst_len = ZSTD_getFrameContentSize(src, left);
+	if (dst_len == ZSTD_CONTENTSIZE_UNKNOWN)
+		return -ENOENT;
+	if (dst_len == ZSTD_CONTENTSIZE_ERROR || dst_len > SIZE_MAX - dst_off)
+		return -EINVAL;
+	frame->src = src;
+	frame->src_len = src_len;
+	frame->dst_off = dst_off;
+	frame->dst_len = dst_len;
+
+	return 0;
+}
+
+int zstd_find_frames(struct abuf *in, struct zstd_frame *frames,
+		     int max_frames)
+{
+	const u8 *src = abuf_data(in);
+	size_t left = abuf_size(in);
+	struct zstd_frame frame;
+	size_t dst_off = 0;
+	int count, ret;
+
+	for (count = 0; left; count++) {
+		ret = zstd_read_frame(src, left, dst_off, &frame);
+		if (ret)
+			return ret;
+		if (count < max_frames)
+			frames[count] = frame;
+		dst_off += frame.dst_len;
+		src += frame.src_len;
+		left -= frame.src_len;
+	}
+
+	return count;
+}
+
+/**
+ * zstd_collect_frames() - Find the frames in Zstandard data, in one pass
+ *
+ * @in: Input buffer holding one or more frames
+ * @framesp: Returns an allocated list of the frames, to be freed by the
+ *	caller, if the return value is positive
+ * Return: number of frames, or -ve error as for zstd_find_frames()
+ */
+static int zstd_collect_frames(struct abuf *in, struct zstd_frame **framesp)
+{
+	struct zstd_frame *frames = NULL, *new;
+	const u8 *src = abuf_data(in);
+	size_t left = abuf_size(in);
+	size_t dst_off = 0;
+	int count, size = 0;
+	int ret;
+
+	if (!left)
+		return 0;
+	for (count = 0; left; count++) {
+		if (count == size) {
+			size = size ? size * 2 : 8;
+			new = realloc(frames, size * sizeof(*frames));
+			if (!new) {
+				ret = -ENOMEM;
+				goto err;
+			}
+			frames = new;
+		}
+		ret = zstd_read_frame(src, left, dst_off, &frames[count]);
+		if (ret)
+			goto err;
+		dst_off += frames[count].dst_len;
+		src += frames[count].src_len;
+		left -= frames[count].src_len;
+	}
+	*framesp = frames;
+
+	return count;
+err:
+	free(frames);
+	return ret;
+}
+
+int zstd_decompress_frame(const struct zstd_frame *frame, void *workspace,
+			  struct abuf *out)
+{
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	if (frame->dst_off + frame->dst_len > abuf_size(out))
+		return -ENOSPC;
+	dctx = ZSTD_initDCtx(workspace, ZSTD_DCtxWorkspaceBound());
+	if (!dctx)
+		return -ENOMEM;
+	ret = ZSTD_decompressDCtx(dctx, abuf_data(out) + frame->dst_off,
+				  frame->dst_len, frame->src, frame->src_len);
+	if (ZSTD_isError(ret) || ret != frame->dst_len)
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Decompress the frames of a lane, run on any core */
+static int zstd_lane_run(void *arg)
+{
+	struct zstd_lane *lane = arg;
+	int i, ret;
+
+	for (i = lane->first; i < lane->count; i += lane->step) {
+		ret = zstd_decompress_frame(&lane->frames[i], lane->workspace,
+					    lane->out);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Decompress frames found by zstd_collect_frames(), then free them */
+static int zstd_decompress_list(struct zstd_frame *frames, int count,
+				struct abuf *out)
+{
+	struct zstd_frame *last = &frames[count - 1];
+	struct zstd_lane lanes[ZSTD_LANES];
+	int num_lanes, i, err;
+	size_t wsize;
+	int ret;
+
+	if (last->dst_off + last->dst_len > abuf_size(out)) {
+		log_debug("output too small for %zx bytes\n",
+			  last->dst_off + last->dst_len);
+		ret = -ENOSPC;
+		goto do_free;
+	}
+
+	/* A job cannot start other jobs, so do everything on this core */
+	num_lanes = cpu_job_on_worker() ? 1 : min(count, ZSTD_LANES);
+	wsize = ZSTD_DCtxWorkspaceBound();
+	for (i = 0; i < num_lanes; i++) {
+		lanes[i].workspace = malloc(wsize);
+		if (!lanes[i].workspace)
+			break;
+	}
+	num_lanes = i;
+	if (!num_lanes) {
+		ret = -ENOMEM;
+		goto do_free;
+	}
+	for (i = 0; i < num_lanes; i++) {
+		lanes[i].frames = frames;
+		lanes[i].count = count;
+		lanes[i].first = i;
+		lanes[i].step = num_lanes;
+		lanes[i].out = out;
+	}
+
+	/* The boot core takes the first lane while the others run as jobs */
+	for (i = 1; i < num_lanes; i++)
+		cpu_job_queue(&lanes[i].job, zstd_lane_run, &lanes[i]);
+	ret = zstd_lane_run(&lanes[0]);
+	/* This only returns once the worker is done with the lane */
+	for (i = 1; i < num_lanes; i++) {
+		err = cpu_job_wait(&lanes[i].job);
+		if (err && !ret)
+			ret = err;
+	}
+	for (i = 0; i < num_lanes; i++)
+		free(lanes[i].workspace);
+	if (ret) {
+		log_err("zstd frame error %d\n", ret);
+		goto do_free;
+	}
+	log_debug("%d frames in %d lanes\n", count, num_lanes);
+	ret = last->dst_off + last->dst_len;
+do_free:
+	free(frames);
+	return ret;
+}
+
+int zstd_decompress_frames(struct abuf *in, struct abuf *out)
+{
+	struct zstd_frame *frames;
+	int count;
+
+	count = zstd_collect_frames(in, &frames);
+	if (count <= 0)
+		return count;
+
+	return zstd_decompress_list(frames, count, out);
+}
+
 int zstd_decompress(struct abuf *in, struct abuf *out)
 {
+	struct zstd_frame *frames;
 	ZSTD_DStream *dstream;
 	ZSTD_inBuffer in_buf;
 	ZSTD_outBuffer out_buf;
@@ -20,6 +248,18 @@ int zstd_decompress(struct abuf *in, struct abuf *out)
 	size_t wsize;
 	int ret;
 
+	/*
+	 * The stream decoder stops at the end of the first frame, so send
+	 * anything with several frames down the frame-by-frame path, which
+	 * can also use the other cores. That needs the content size of each
+	 * frame, which zstd records unless compressing from a pipe.
+	 */
+	ret = zstd_collect_frames(in, &frames);
+	if (ret > 1)
+		return zstd_decompress_list(frames, ret, out);
+	if (ret > 0)
+		free(frames);
+
 	wsize = ZSTD_DStreamWorkspaceBound(abuf_size(in));
 	workspace = malloc(wsize);
 	if (!workspace) {
@@ -0,0 +1,784 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This implements just enough of RFC 793, plus the window scale option of
+ * RFC 7323 and the retransmission timer of RFC 6298, for a loader to pull a
+ * file over a single active connection from within net_loop().
+ *
+ * The receive side advertises a fixed window. Segments which arrive ahead
+ * of a hole are kept in a small out-of-order queue and each one is answered
+ * with an immediate duplicate ACK, so that the sender repairs the hole with
+ * a fast retransmit rather than waiting for its retransmission timeout.
+ * In-order data is handed straight to the user and acknowledged every
+ * second segment.
+ *
+ * The send side only has to carry a request, so unacknowledged data is kept
+ * in a small buffer and retransmitted on timeout, or on three duplicate ACKs
+ * (there is no SACK).
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <log.h>
+#include <malloc.h>
+#include <net.h>
+#include <rand.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+
+/* Size of the send buffer, enough for a request with a long path */
+#define TCP_TX_BUF_SIZE		2048
+/* Retransmission timeout limits, in ms */
+#define TCP_RTO_INIT		1000
+#define TCP_RTO_MIN		200
+#define TCP_RTO_MAX		10000
+/* Delay before acknowledging a single in-order segment, in ms */
+#define TCP_DELACK		20
+/* Number of timeouts in a row before giving up on the connection */
+#define TCP_MAX_RETRIES		8
+#define TCP_DUP_ACK_THRESH	3
+#define TCP_OOO_SEGS		(CONFIG_PROT_TCP_WINDOW / TCP_MSS)
+
+#define seq_before(a, b)	((s32)((a) - (b)) < 0)
+#define seq_after(a, b)		seq_before(b, a)
+
+/**
+ * struct tcp_ooo_seg - a segment received ahead of a hole
+ *
+ * @seq:	sequence number of the first byte
+ * @len:	number of bytes, 0 if the slot is free
+ * @fin:	true if the segment carried a FIN
+ * @data:	payload
+ */
+struct tcp_ooo_seg {
+	u32 seq;
+	unsigned int len;
+	bool fin;
+	uchar data[TCP_MSS];
+};
+
+static enum tcp_state tcp_state;
+static const struct tcp_ops *tcp_ops;
+static struct tcp_stats tcp_stats;
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static u16 tcp_remote_port;
+static u16 tcp_our_port;
+
+/* Send side */
+static u32 snd_una;		/* oldest unacknowledged sequence number */
+static u32 snd_nxt;		/* next sequence number to send */
+static u32 snd_wnd;		/* window offered by the peer */
+static u8 snd_wscale;		/* window scale of the peer */
+static unsigned int snd_mss;	/* largest segment the peer accepts */
+static uchar snd_buf[TCP_TX_BUF_SIZE];	/* data from snd_una onwards */
+static unsigned int snd_len;	/* number of bytes in snd_buf */
+static bool snd_fin;		/* a FIN follows the data in snd_buf */
+static int dup_acks;
+
+/* Receive side */
+static u32 rcv_nxt;		/* next sequence number expected */
+static u8 rcv_wscale;		/* our window scale */
+static unsigned int rcv_mss;	/* largest segment seen from the peer */
+static unsigned int rcv_unacked; /* in-order segments not acknowledged */
+static struct tcp_ooo_seg *ooo_segs;
+
+/* Timers, all in ms */
+static ulong srtt, rttvar, rto;
+static bool rtt_valid;		/* srtt and rttvar hold a measurement */
+static bool rtt_active;		/* rtt_seq is being timed */
+static u32 rtt_seq;
+static ulong rtt_start;
+static ulong timer_start;	/* retransmission or idle timer */
+static ulong delack_start;
+static int retries;
+
+static void tcp_timeout_handler(void);
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp_state;
+}
+
+void tcp_get_stats(struct tcp_stats *stats)
+{
+	*stats = tcp_stats;
+}
+
+static void tcp_release(void)
+{
+	tcp_state = TCP_CLOSED;
+	free(ooo_segs);
+	ooo_segs = NULL;
+	net_set_timeout_handler(0, NULL);
+}
+
+/* Drop the connection and tell the user why */
+static void tcp_fail(int err)
+{
+	const struct tcp_ops *ops = tcp_ops;
+
+	tcp_release();
+	if (ops->closed)
+		ops->closed(err);
+}
+
+static u16 tcp_checksum(struct ip_tcp_hdr *ip, unsigned int tcp_len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+	uint sum;
+
+	pseudo.src = ip->ip_src;
+	pseudo.dst = ip->ip_dst;
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(tcp_len);
+
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+static u16 tcp_window(bool syn)
+{
+	ulong win = CONFIG_PROT_TCP_WINDOW;
+
+	if (!syn)
+		win >>= rcv_wscale;
+
+	return min_t(ulong, win, 0xffff);
+}
+
+int net_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	int hdr_size = IP_TCP_HDR_SIZE;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+
+	if (action & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WS;
+		opt[6] = 3;
+		opt[7] = rcv_wscale;
+		hdr_size += TCP_SYN_OPT_SIZE;
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, hdr_size + payload_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = action & TCP_ACK ? htonl(tcp_ack_num) : 0;
+	ip->tcp_hlen = ((hdr_size - IP_HDR_SIZE) / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(tcp_window(action & TCP_SYN));
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = 0;
+	ip->tcp_xsum = tcp_checksum(ip, hdr_size - IP_HDR_SIZE + payload_len);
+
+	return hdr_size;
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const uchar *data,
+			     unsigned int len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_our_port, len, IPPROTO_TCP, flags, seq, rcv_nxt);
+	tcp_stats.segs_out++;
+	if (flags & TCP_ACK)
+		rcv_unacked = 0;
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, snd_nxt, NULL, 0);
+}
+
+/* Start timing @seq if nothing is being timed yet */
+static void tcp_rtt_start(u32 seq)
+{
+	if (rtt_active)
+		return;
+	rtt_active = true;
+	rtt_seq = seq;
+	rtt_start = get_timer(0);
+}
+
+/* Update the retransmission timeout from a round trip sample (RFC 6298) */
+static void tcp_rtt_sample(ulong r)
+{
+	if (!rtt_valid) {
+		srtt = r;
+		rttvar = r / 2;
+		rtt_valid = true;
+	} else {
+		rttvar = (3 * rttvar + (srtt > r ? srtt - r : r - srtt)) / 4;
+		srtt = (7 * srtt + r) / 8;
+	}
+	rto = clamp_t(ulong, srtt + max_t(ulong, 4 * rttvar, 1),
+		      TCP_RTO_MIN, TCP_RTO_MAX);
+}
+
+/* Send whatever the peer's window allows from snd_buf, then any FIN */
+static void tcp_output(void)
+{
+	unsigned int sent, len;
+	u8 flags;
+
+	for (;;) {
+		sent = snd_nxt - snd_una;
+		if (sent >= snd_len || sent >= snd_wnd)
+			break;
+		len = min3(snd_len - sent, snd_mss, snd_wnd - sent);
+		flags = TCP_ACK;
+		if (sent + len == snd_len)
+			flags |= TCP_PSH;
+		tcp_rtt_start(snd_nxt + len);
+		tcp_send_segment(flags, snd_nxt, snd_buf + sent, len);
+		snd_nxt += len;
+	}
+
+	if (snd_fin && snd_nxt - snd_una == snd_len) {
+		tcp_send_segment(TCP_FIN | TCP_ACK, snd_nxt, NULL, 0);
+		snd_nxt++;
+	}
+}
+
+/* Resend the oldest unacknowledged segment */
+static void tcp_resend_first(void)
+{
+	unsigned int len = min(snd_len, snd_mss);
+	u8 flags = TCP_ACK;
+
+	rtt_active = false;
+	if (len)
+		flags |= TCP_PSH;
+	else
+		flags |= TCP_FIN;
+	tcp_send_segment(flags, snd_una, snd_buf, len);
+}
+
+/* Time left before the timer of the connection expires */
+static long tcp_timer_left(ulong now)
+{
+	ulong len = rto;
+	long left;
+
+	/* While idle, the timer only probes the peer; don't rush that */
+	if (snd_una == snd_nxt)
+		len = max_t(ulong, len, TCP_RTO_INIT);
+	left = len - (now - timer_start);
+	if (rcv_unacked)
+		left = min_t(long, left, TCP_DELACK - (now - delack_start));
+
+	return left;
+}
+
+static void tcp_set_timer(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	net_set_timeout_handler(max_t(long, tcp_timer_left(get_timer(0)), 1),
+				tcp_timeout_handler);
+}
+
+static void tcp_timeout_handler(void)
+{
+	ulong now = get_timer(0);
+
+	if (rcv_unacked && now - delack_start >= TCP_DELACK)
+		tcp_send_ack();
+
+	if (tcp_timer_left(now) <= 0) {
+		if (++retries > TCP_MAX_RETRIES) {
+			debug("TCP: connection timed out\n");
+			tcp_fail(-ETIMEDOUT);
+			return;
+		}
+		timer_start = now;
+		rto = min(rto * 2, (ulong)TCP_RTO_MAX);
+		if (snd_una == snd_nxt) {
+			/* Idle: make sure the peer has our latest ACK */
+			tcp_send_ack();
+		} else {
+			tcp_stats.retransmits++;
+			rtt_active = false;
+			snd_nxt = snd_una;
+			if (tcp_state == TCP_SYN_SENT) {
+				tcp_send_segment(TCP_SYN, snd_nxt, NULL, 0);
+				snd_nxt++;
+			} else {
+				tcp_output();
+			}
+		}
+	}
+
+	tcp_set_timer();
+}
+
+int tcp_connect(struct in_addr dest, u16 dport, const struct tcp_ops *ops)
+{
+	/* A connection left over from a previous net_loop() is dead */
+	if (tcp_state != TCP_CLOSED)
+		tcp_release();
+
+	ooo_segs = calloc(TCP_OOO_SEGS, sizeof(*ooo_segs));
+	if (TCP_OOO_SEGS && !ooo_segs)
+		return -ENOMEM;
+
+	tcp_ops = ops;
+	memset(&tcp_stats, '\0', sizeof(tcp_stats));
+	tcp_remote_ip = dest;
+	memset(tcp_remote_ethaddr, '\0', ARP_HLEN);
+	tcp_remote_port = dport;
+	tcp_our_port = 32768 + (rand() & 0x3fff);
+
+	snd_una = rand();
+	snd_nxt = snd_una;
+	snd_wnd = 0;
+	snd_wscale = 0;
+	snd_mss = 536;
+	snd_len = 0;
+	snd_fin = false;
+	dup_acks = 0;
+
+	rcv_nxt = 0;
+	for (rcv_wscale = 0; (CONFIG_PROT_TCP_WINDOW >> rcv_wscale) > 0xffff;)
+		rcv_wscale++;
+	rcv_mss = 0;
+	rcv_unacked = 0;
+
+	rto = TCP_RTO_INIT;
+	rtt_valid = false;
+	rtt_active = false;
+	retries = 0;
+	timer_start = get_timer(0);
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_rtt_start(snd_nxt + 1);
+	tcp_send_segment(TCP_SYN, snd_nxt, NULL, 0);
+	snd_nxt++;
+	tcp_set_timer();
+
+	return 0;
+}
+
+int tcp_write(const void *buf, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT)
+		return -ENOTCONN;
+	if (snd_len + len > TCP_TX_BUF_SIZE)
+		return -ENOSPC;
+
+	memcpy(snd_buf + snd_len, buf, len);
+	if (snd_una == snd_nxt)
+		timer_start = get_timer(0);
+	snd_len += len;
+	tcp_output();
+	tcp_set_timer();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	switch (tcp_state) {
+	case TCP_SYN_SENT:
+		tcp_release();
+		return;
+	case TCP_ESTABLISHED:
+		tcp_state = TCP_FIN_WAIT_1;
+		break;
+	case TCP_CLOSE_WAIT:
+		tcp_state = TCP_LAST_ACK;
+		break;
+	default:
+		return;
+	}
+
+	if (snd_una == snd_nxt)
+		timer_start = get_timer(0);
+	snd_fin = true;
+	tcp_output();
+	tcp_set_timer();
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+	if (tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST | TCP_ACK, snd_nxt, NULL, 0);
+	tcp_release();
+}
+
+static void tcp_parse_options(const uchar *opt, unsigned int len)
+{
+	bool wscale = false;
+
+	while (len) {
+		if (opt[0] == TCP_OPT_EOL)
+			break;
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_MSS && opt[1] == 4)
+			snd_mss = min_t(uint, get_unaligned_be16(opt + 2),
+					TCP_MSS);
+		if (opt[0] == TCP_OPT_WS && opt[1] == 3) {
+			snd_wscale = min_t(u8, opt[2], 14);
+			wscale = true;
+		}
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	/* Window scaling is only used if both sides offered it */
+	if (!wscale) {
+		snd_wscale = 0;
+		rcv_wscale = 0;
+	}
+}
+
+/* Handle the SYN-ACK for our SYN */
+static void tcp_rx_syn_sent(u8 flags, u32 seq, u32 ack, u16 win,
+			    const uchar *opt, unsigned int opt_len)
+{
+	if (!(flags & TCP_ACK) || ack != snd_nxt)
+		return;
+	if (flags & TCP_RST) {
+		tcp_fail(-ECONNREFUSED);
+		return;
+	}
+	if (!(flags & TCP_SYN))
+		return;
+
+	tcp_parse_options(opt, opt_len);
+	if (rtt_active) {
+		tcp_rtt_sample(get_timer(rtt_start));
+		rtt_active = false;
+	}
+	snd_una = ack;
+	snd_wnd = win;		/* never scaled in a SYN */
+	rcv_nxt = seq + 1;
+	retries = 0;
+	timer_start = get_timer(0);
+	tcp_state = TCP_ESTABLISHED;
+	tcp_send_ack();
+
+	if (tcp_ops->connected)
+		tcp_ops->connected();
+}
+
+/* Our FIN has been acknowledged */
+static void tcp_fin_acked(void)
+{
+	switch (tcp_state) {
+	case TCP_FIN_WAIT_1:
+		tcp_state = TCP_FIN_WAIT_2;
+		break;
+	case TCP_CLOSING:
+	case TCP_LAST_ACK:
+		tcp_release();
+		break;
+	default:
+		break;
+	}
+}
+
+static void tcp_rx_ack(u32 ack, u16 win, unsigned int len, u8 flags)
+{
+	u32 acked;
+	unsigned int data;
+
+	if (seq_after(ack, snd_nxt))
+		return;
+
+	if (seq_after(ack, snd_una)) {
+		acked = ack - snd_una;
+		data = min(acked, snd_len);
+		memmove(snd_buf, snd_buf + data, snd_len - data);
+		snd_len -= data;
+		snd_una = ack;
+		dup_acks = 0;
+		retries = 0;
+		timer_start = get_timer(0);
+		if (rtt_active && !seq_before(ack, rtt_seq)) {
+			tcp_rtt_sample(get_timer(rtt_start));
+			rtt_active = false;
+		}
+		/* Everything sent is acknowledged, so is the FIN if sent */
+		if (snd_fin && acked > data && snd_una == snd_nxt)
+			tcp_fin_acked();
+	} else if (ack == snd_una && snd_una != snd_nxt && !len &&
+		   !(flags & (TCP_SYN | TCP_FIN)) &&
+		   (u32)win << snd_wscale == snd_wnd) {
+		if (++dup_acks == TCP_DUP_ACK_THRESH) {
+			tcp_stats.fast_retransmits++;
+			tcp_resend_first();
+		}
+	}
+
+	snd_wnd = (u32)win << snd_wscale;
+	if (tcp_state != TCP_CLOSED)
+		tcp_output();
+}
+
+static void tcp_deliver(const uchar *data, unsigned int len)
+{
+	rcv_nxt += len;
+	tcp_stats.bytes_in += len;
+	tcp_ops->receive(data, len);
+}
+
+/* Keep a segment received ahead of a hole, if there is room */
+static void tcp_ooo_insert(u32 seq, const uchar *data, unsigned int len,
+			   bool fin)
+{
+	struct tcp_ooo_seg *seg, *free_seg = NULL;
+	int i;
+
+	if (len > TCP_MSS || seq - rcv_nxt + len > CONFIG_PROT_TCP_WINDOW)
+		return;
+
+	for (i = 0; i < TCP_OOO_SEGS; i++) {
+		seg = &ooo_segs[i];
+		if (!seg->len) {
+			if (!free_seg)
+				free_seg = seg;
+		} else if (seg->seq == seq && seg->len >= len) {
+			return;
+		}
+	}
+	if (!free_seg)
+		return;
+
+	free_seg->seq = seq;
+	free_seg->len = len;
+	free_seg->fin = fin;
+	memcpy(free_seg->data, data, len);
+}
+
+/*
+ * Deliver queued segments which have become in-order
+ *
+ * Return: true if a FIN was reached
+ */
+static bool tcp_ooo_drain(void)
+{
+	struct tcp_ooo_seg *seg;
+	bool progress, fin = false;
+	u32 skip;
+	int i;
+
+	do {
+		progress = false;
+		for (i = 0; i < TCP_OOO_SEGS; i++) {
+			seg = &ooo_segs[i];
+			if (!seg->len || seq_after(seg->seq, rcv_nxt))
+				continue;
+			skip = rcv_nxt - seg->seq;
+			if (skip < seg->len) {
+				tcp_deliver(seg->data + skip, seg->len - skip);
+				if (tcp_state == TCP_CLOSED)
+					return false;
+				fin |= seg->fin;
+				progress = true;
+			}
+			seg->len = 0;
+		}
+	} while (progress && !fin);
+
+	return fin;
+}
+
+static bool tcp_ooo_empty(void)
+{
+	int i;
+
+	for (i = 0; i < TCP_OOO_SEGS; i++) {
+		if (ooo_segs[i].len)
+			return false;
+	}
+
+	return true;
+}
+
+/* The peer has closed its side of the connection */
+static void tcp_rx_fin(void)
+{
+	rcv_nxt++;
+	tcp_send_ack();
+
+	switch (tcp_state) {
+	case TCP_ESTABLISHED:
+		tcp_state = TCP_CLOSE_WAIT;
+		if (tcp_ops->closed)
+			tcp_ops->closed(0);
+		break;
+	case TCP_FIN_WAIT_1:
+		tcp_state = TCP_CLOSING;
+		break;
+	case TCP_FIN_WAIT_2:
+		/* No need to linger in TIME-WAIT */
+		tcp_release();
+		break;
+	default:
+		break;
+	}
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, unsigned int len,
+			bool fin)
+{
+	bool ack_now = false;
+	u32 skip;
+
+	/* Retransmission of data we already have */
+	if (seq_before(seq, rcv_nxt)) {
+		skip = rcv_nxt - seq;
+		if (skip > len || (skip == len && !fin)) {
+			tcp_send_ack();
+			return;
+		}
+		data += skip;
+		len -= skip;
+		seq = rcv_nxt;
+	}
+
+	/* Ahead of a hole: keep it and tell the sender straight away */
+	if (seq != rcv_nxt) {
+		tcp_ooo_insert(seq, data, len, fin);
+		tcp_stats.ooo_segs++;
+		tcp_stats.dup_acks++;
+		tcp_send_ack();
+		return;
+	}
+
+	if (len) {
+		/* Filling (part of) a hole is acknowledged at once */
+		if (!tcp_ooo_empty())
+			ack_now = true;
+		tcp_deliver(data, len);
+		if (tcp_state == TCP_CLOSED)
+			return;
+		if (ack_now)
+			fin |= tcp_ooo_drain();
+		if (tcp_state == TCP_CLOSED)
+			return;
+
+		/* A short segment is likely the last of a burst */
+		rcv_mss = max(rcv_mss, len);
+		if (len < rcv_mss || ++rcv_unacked >= 2)
+			ack_now = true;
+		else if (rcv_unacked == 1)
+			delack_start = get_timer(0);
+	}
+
+	if (fin)
+		tcp_rx_fin();
+	else if (ack_now)
+		tcp_send_ack();
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	unsigned int hdr_len, data_len;
+	const uchar *data;
+	u32 seq, ack;
+	u16 win;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED || len < IP_TCP_HDR_SIZE)
+		return;
+
+	hdr_len = (ip->tcp_hlen >> 4) * 4;
+	if (hdr_len < TCP_HDR_SIZE || IP_HDR_SIZE + hdr_len > len)
+		return;
+	if (tcp_checksum(ip, len - IP_HDR_SIZE) & 0xfffe) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	if (net_read_ip(&ip->ip_src).s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_our_port)
+		return;
+
+	tcp_stats.segs_in++;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	win = ntohs(ip->tcp_win);
+	flags = ip->tcp_flags;
+	data = (uchar *)ip + IP_HDR_SIZE + hdr_len;
+	data_len = len - IP_HDR_SIZE - hdr_len;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_rx_syn_sent(flags, seq, ack, win,
+				(uchar *)ip + IP_TCP_HDR_SIZE,
+				hdr_len - TCP_HDR_SIZE);
+		goto out;
+	}
+
+	if (flags & TCP_RST) {
+		if (seq - rcv_nxt < CONFIG_PROT_TCP_WINDOW) {
+			debug("TCP: connection reset\n");
+			tcp_fail(-ECONNRESET);
+		}
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	if (snd_una == snd_nxt) {
+		timer_start = get_timer(0);
+		retries = 0;
+	}
+	tcp_rx_ack(ack, win, data_len, flags);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	/* Our ACK of the SYN-ACK was lost */
+	if (flags & TCP_SYN)
+		tcp_send_ack();
+
+	if (data_len || (flags & TCP_FIN)) {
+		switch (tcp_state) {
+		case TCP_ESTABLISHED:
+		case TCP_FIN_WAIT_1:
+		case TCP_FIN_WAIT_2:
+			tcp_rx_data(seq, data, data_len, flags & TCP_FIN);
+			break;
+		default:
+			/* The peer has already closed: repeat our ACK */
+			tcp_send_ack();
+			break;
+		}
+	}
+
+out:
+	tcp_set_timer();
+}
@@ -25,6 +25,8 @@ DECLARE_GLOBAL_DATA_PTR;
 #define WELL_KNOWN_PORT	69
 /* Millisecs to timeout for lost pkt */
 #define TIMEOUT		5000UL
+/* Lower bound of the retransmission timeout once the RTT is known */
+#define TIMEOUT_MIN	200UL
 /* Number of "loading" hashes per line (for checking the image size) */
 #define HASHES_PER_LINE	65
 
@@ -96,6 +98,20 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/* Window size to ask for in the next read request */
+static ushort	tftp_window_next;
+/* Round trip time estimate and retransmission timeout (RFC 6298), in ms */
+static ulong	tftp_srtt;
+static ulong	tftp_rttvar;
+static ulong	tftp_rto;
+static bool	tftp_rtt_valid;
+/* A round trip is being timed, until block tftp_rtt_block arrives/is acked */
+static bool	tftp_rtt_active;
+static ushort	tftp_rtt_block;
+static ulong	tftp_rtt_start;
+/* Number of nacks sent and timeouts in this transfer */
+static ulong	tftp_lost;
+static ulong	tftp_timeouts;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -174,6 +190,7 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	ptr = map_sysmem(store_addr, len);
 	memcpy(ptr, src, len);
 	unmap_sysmem(ptr);
+	fit_stream_load_data(offset, len);
 
 	if (net_boot_file_size < newsize)
 		net_boot_file_size = newsize;
@@ -181,6 +198,66 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	return 0;
 }
 
+/* Start timing a round trip, ending when @block arrives or is acked */
+static void tftp_rtt_begin(ushort block)
+{
+	if (tftp_rtt_active)
+		return;
+	tftp_rtt_active = true;
+	tftp_rtt_block = block;
+	tftp_rtt_start = get_timer(0);
+}
+
+/* Update the retransmission timeout once @block arrived or was acked */
+static void tftp_rtt_end(ushort block)
+{
+	ulong r;
+
+	if (!tftp_rtt_active || block != tftp_rtt_block)
+		return;
+	tftp_rtt_active = false;
+	r = get_timer(tftp_rtt_start);
+
+	if (!tftp_rtt_valid) {
+		tftp_srtt = r;
+		tftp_rttvar = r / 2;
+		tftp_rtt_valid = true;
+	} else {
+		tftp_rttvar = (3 * tftp_rttvar +
+			       (tftp_srtt > r ? tftp_srtt - r : r - tftp_srtt)) / 4;
+		tftp_srtt = (7 * tftp_srtt + r) / 8;
+	}
+	tftp_rto = clamp(tftp_srtt + max(4 * tftp_rttvar, 1UL),
+			 min(TIMEOUT_MIN, timeout_ms), timeout_ms);
+}
+
+/*
+ * Pick the window size for the next read request from the losses seen in
+ * this one: grow it after a clean transfer, shrink it if more than one
+ * window in eight needed a retransmission. A window cannot be changed once
+ * negotiated, so this only takes effect from the next transfer (or
+ * restart) onwards.
+ */
+static void tftp_adapt_window(bool failed)
+{
+	ulong blocks, windows, events;
+
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE) || tftp_put_active)
+		return;
+
+	blocks = tftp_block_wrap * TFTP_SEQUENCE_SIZE + tftp_cur_block;
+	windows = max(blocks / max_t(ushort, tftp_windowsize, 1), 1UL);
+	events = tftp_lost + tftp_timeouts;
+
+	if (failed || events * 8 > windows)
+		tftp_window_next = max(tftp_window_next / 2, 1);
+	else if (!events)
+		tftp_window_next = min_t(uint, tftp_window_next * 2,
+					 tftp_window_size_option);
+	debug("TFTP: %lu blocks, %lu lost, %lu timeouts, next window %d\n",
+	      blocks, tftp_lost, tftp_timeouts, tftp_window_next);
+}
+
 /* Clear our state ready for a new transfer */
 static void new_transfer(void)
 {
@@ -293,11 +370,18 @@ static void tftp_complete(void)
 	print_size(tftp_tsize, "");
 #endif
 	time_start = get_timer(time_start);
+	puts("\n\t ");	/* Line up with "Loading: " */
 	if (time_start > 0) {
-		puts("\n\t ");	/* Line up with "Loading: " */
 		print_size(net_boot_file_size /
 			time_start * 1000, "/s");
+		puts(", ");
 	}
+	printf("window %d, %lu retransmits", tftp_windowsize,
+	       tftp_lost + tftp_timeouts);
+	if (tftp_rtt_valid)
+		printf(", rtt %lu ms", tftp_srtt);
+	tftp_adapt_window(false);
+	fit_stream_load_end();
 	puts("\ndone\n");
 	if (IS_ENABLED(CONFIG_CMD_BOOTEFI)) {
 		if (!tftp_put_active)
@@ -355,9 +439,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_next > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_next, 0);
 		len = pkt - xp;
 		break;
 
@@ -480,11 +564,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				int block = ntohs(*s);
 				int ack_ok = (tftp_cur_block == block);
 
+				tftp_rtt_end(block);
 				tftp_prev_block = tftp_cur_block;
 				tftp_cur_block = (unsigned short)(block + 1);
 				update_block_number();
-				if (ack_ok)
+				if (ack_ok) {
 					tftp_send(); /* Send next data block */
+					tftp_rtt_begin(tftp_cur_block);
+				}
 			}
 		}
 #endif
@@ -569,6 +656,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 #endif
 		tftp_send(); /* Send ACK or first data block */
+		tftp_rtt_begin(tftp_put_active ? tftp_cur_block :
+			       tftp_cur_block + 1);
 		break;
 	case TFTP_DATA:
 		if (len < 2)
@@ -586,6 +675,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 * This just overwellms the server, let's just send one.
 			 */
 			if (tftp_last_nack != tftp_cur_block) {
+				/* Karn: the reply may be to either ack */
+				tftp_rtt_active = false;
+				tftp_lost++;
 				tftp_send();
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
@@ -624,10 +716,11 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			break;
 		}
 
+		tftp_rtt_end(tftp_cur_block);
 		update_block_number();
 		tftp_prev_block = tftp_cur_block;
 		timeout_count_max = tftp_timeout_count_max;
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		net_set_timeout_handler(tftp_rto, tftp_timeout_handler);
 
 		if (store_block(tftp_cur_block, pkt + 2, len)) {
 			eth_halt();
@@ -647,6 +740,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		 */
 		if (tftp_cur_block == tftp_next_ack) {
 			tftp_send();
+			tftp_rtt_begin(tftp_cur_block + 1);
 			tftp_next_ack += tftp_windowsize;
 		}
 		break;
@@ -679,11 +773,22 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 static void tftp_timeout_handler(void)
 {
-	if (++timeout_count > timeout_count_max) {
+	/*
+	 * Back off from the measured timeout towards timeout_ms. Only full
+	 * timeouts count towards the retry limit, so a short stall of the
+	 * server does not use up the retries of the whole transfer.
+	 */
+	tftp_rtt_active = false;
+	if (tftp_rto >= timeout_ms && ++timeout_count > timeout_count_max) {
+		tftp_adapt_window(true);
 		restart("Retry count exceeded");
 	} else {
-		puts("T ");
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		if (tftp_rto >= timeout_ms)
+			puts("T ");
+		if (tftp_state == STATE_DATA)
+			tftp_timeouts++;
+		tftp_rto = min(tftp_rto * 2, timeout_ms);
+		net_set_timeout_handler(tftp_rto, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -747,8 +852,14 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
+	if (tftp_window_size_option < 1)
+		tftp_window_size_option = 1;
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE) || !tftp_window_next ||
+	    tftp_window_next > tftp_window_size_option)
+		tftp_window_next = tftp_window_size_option;
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
-	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+	      tftp_block_size_option, tftp_window_next, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -817,10 +928,16 @@ void tftp_start(enum proto_t protocol)
 		printf("Load address: 0x%lx\n", tftp_load_addr);
 		puts("Loading: *\b");
 		tftp_state = STATE_SEND_RRQ;
+		fit_stream_load_start(tftp_load_addr);
 	}
 
 	time_start = get_timer(0);
 	timeout_count_max = tftp_timeout_count_max;
+	tftp_rto = timeout_ms;
+	tftp_rtt_valid = false;
+	tftp_rtt_active = false;
+	tftp_lost = 0;
+	tftp_timeouts = 0;
 
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 	net_set_udp_handler(tftp_handler);
@@ -869,12 +986,18 @@ void tftp_start_server(void)
 	printf("Using %s device\n", eth_get_name());
 	printf("Listening for TFTP transfer on %pI4\n", &net_ip);
 	printf("Load address: 0x%lx\n", tftp_load_addr);
+	fit_stream_load_start(tftp_load_addr);
 
 	puts("Loading: *\b");
 
 	timeout_count_max = tftp_timeout_count_max;
 	timeout_count = 0;
 	timeout_ms = TIMEOUT;
+	tftp_rto = timeout_ms;
+	tftp_rtt_valid = false;
+	tftp_rtt_active = false;
+	tftp_lost = 0;
+	tftp_timeouts = 0;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
 	/* Revert tftp_block_size to dflt */
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download over TCP
+ *
+ * Sends a single HTTP/1.0 GET request and streams the body of the reply
+ * straight to the load address as it arrives.
+ */
+
+#include <common.h>
+#include <display_options.h>
+#include <env.h>
+#include <errno.h>
+#include <image.h>
+#include <lmb.h>
+#include <log.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/global_data.h>
+#include <linux/sizes.h>
+#include "wget.h"
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define HASHES_PER_LINE		65
+#define WGET_HASH_SIZE		SZ_64K
+/* Longest reply header we are prepared to parse */
+#define WGET_HDR_SIZE		2048
+#define WGET_PATH_LEN		1024
+
+enum wget_state {
+	WGET_CONNECTING,
+	WGET_HEADER,
+	WGET_BODY,
+	WGET_DONE,
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+static char wget_path[WGET_PATH_LEN];
+static char wget_hdr[WGET_HDR_SIZE + 1];
+static unsigned int wget_hdr_len;
+static ulong wget_content_len;	/* 0 if the server did not tell us */
+static ulong wget_load_addr;
+#ifdef CONFIG_LMB
+static ulong wget_load_size;
+#endif
+static ulong wget_time_start;
+static int wget_num_hash;
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget: %s\n", msg);
+	wget_state = WGET_DONE;
+	tcp_abort();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_connected(void)
+{
+	char req[WGET_PATH_LEN + 128];
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.0\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Accept: */*\r\n"
+		       "\r\n",
+		       *wget_path == '/' ? "" : "/", wget_path,
+		       &wget_server_ip);
+	wget_state = WGET_HEADER;
+	if (tcp_write(req, len))
+		wget_fail("cannot send request");
+}
+
+/*
+ * Parse the reply header once it is complete
+ *
+ * Return: 0 if the body follows, -ve on error
+ */
+static int wget_parse_header(void)
+{
+	char *line, *next;
+	ulong status;
+
+	if (strncmp(wget_hdr, "HTTP/", 5))
+		return -EPROTO;
+	line = strchr(wget_hdr, ' ');
+	if (!line)
+		return -EPROTO;
+	status = dectoul(line + 1, NULL);
+	if (status != 200) {
+		next = strchr(line, '\r');
+		if (next)
+			*next = '\0';
+		printf("\nHTTP error:%s", line);
+		return -ENOENT;
+	}
+
+	for (line = strchr(wget_hdr, '\n'); line; line = next) {
+		line++;
+		next = strchr(line, '\n');
+		if (strncasecmp(line, "Content-Length:", 15))
+			continue;
+		line += 15;
+		while (*line == ' ' || *line == '\t')
+			line++;
+		wget_content_len = dectoul(line, NULL);
+	}
+
+	return 0;
+}
+
+static void wget_show_progress(void)
+{
+	ulong step;
+
+	if (wget_content_len) {
+		step = max(wget_content_len / 50, 1UL);
+		while (wget_num_hash < 50 &&
+		       net_boot_file_size >= (wget_num_hash + 1) * step) {
+			putc('#');
+			wget_num_hash++;
+		}
+		return;
+	}
+
+	while (wget_num_hash < net_boot_file_size / WGET_HASH_SIZE) {
+		putc('#');
+		if (!(++wget_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+}
+
+static void wget_complete(void)
+{
+	ulong time;
+
+	wget_state = WGET_DONE;
+	tcp_close();
+	fit_stream_load_end();
+
+	if (wget_content_len) {
+		puts("  ");
+		print_size(wget_content_len, "");
+	}
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static int wget_store(const uchar *data, unsigned int len)
+{
+	ulong store_addr = wget_load_addr + net_boot_file_size;
+	void *ptr;
+
+	if (wget_content_len && net_boot_file_size + len > wget_content_len) {
+		wget_fail("server sent more data than announced");
+		return -EOVERFLOW;
+	}
+#ifdef CONFIG_LMB
+	if (net_boot_file_size + len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory");
+		return -EFBIG;
+	}
+#endif
+	ptr = map_sysmem(store_addr, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+	fit_stream_load_data(net_boot_file_size, len);
+	net_boot_file_size += len;
+
+	return 0;
+}
+
+static void wget_receive(const uchar *data, unsigned int len)
+{
+	unsigned int start, used;
+	char *end;
+
+	if (wget_state == WGET_HEADER) {
+		used = min(len, WGET_HDR_SIZE - wget_hdr_len);
+		start = wget_hdr_len > 3 ? wget_hdr_len - 3 : 0;
+		memcpy(wget_hdr + wget_hdr_len, data, used);
+		wget_hdr_len += used;
+		wget_hdr[wget_hdr_len] = '\0';
+
+		end = strstr(wget_hdr + start, "\r\n\r\n");
+		if (!end) {
+			if (wget_hdr_len == WGET_HDR_SIZE)
+				wget_fail("reply header too long");
+			return;
+		}
+		end += 4;
+		used -= wget_hdr + wget_hdr_len - end;
+		*end = '\0';
+		if (wget_parse_header()) {
+			wget_fail("download failed");
+			return;
+		}
+		wget_state = WGET_BODY;
+		data += used;
+		len -= used;
+	}
+
+	if (wget_state != WGET_BODY || !len)
+		goto check_done;
+	if (wget_store(data, len))
+		return;
+	wget_show_progress();
+
+check_done:
+	if (wget_state == WGET_BODY && wget_content_len &&
+	    net_boot_file_size == wget_content_len)
+		wget_complete();
+}
+
+static void wget_closed(int err)
+{
+	if (wget_state == WGET_DONE)
+		return;
+
+	if (err) {
+		printf("\nwget: connection failed (%d)\n", err);
+		wget_state = WGET_DONE;
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	/* Without a Content-Length, the end of the body is the end of data */
+	if (wget_state != WGET_BODY || wget_content_len) {
+		wget_fail("connection closed before the end of the file");
+		return;
+	}
+
+	wget_complete();
+}
+
+static const struct tcp_ops wget_tcp_ops = {
+	.connected = wget_connected,
+	.receive = wget_receive,
+	.closed = wget_closed,
+};
+
+/* Initialize wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+
+	return 0;
+}
+
+void wget_start(void)
+{
+	ulong port = WGET_DEFAULT_PORT;
+	char *ep;
+	int ret;
+
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path, WGET_PATH_LEN)) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	ep = env_get("httpdstp");
+	if (ep)
+		port = dectoul(ep, NULL);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4",
+	       &wget_server_ip, &net_ip);
+
+	/* Check if we need to send across this subnet */
+	if (net_gateway.s_addr && net_netmask.s_addr) {
+		struct in_addr our_net;
+		struct in_addr remote_net;
+
+		our_net.s_addr = net_ip.s_addr & net_netmask.s_addr;
+		remote_net.s_addr = wget_server_ip.s_addr & net_netmask.s_addr;
+		if (our_net.s_addr != remote_net.s_addr)
+			printf("; sending through gateway %pI4", &net_gateway);
+	}
+	putc('\n');
+
+	printf("Filename '%s'.\n", wget_path);
+
+	if (wget_init_load_addr()) {
+		puts("\nwget: trying to overwrite reserved memory...\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	printf("Load address: 0x%lx\n", wget_load_addr);
+	puts("Loading: *\b");
+
+	wget_state = WGET_CONNECTING;
+	wget_hdr_len = 0;
+	wget_content_len = 0;
+	wget_num_hash = 0;
+	wget_time_start = get_timer(0);
+	fit_stream_load_start(wget_load_addr);
+
+	ret = tcp_connect(wget_server_ip, port, &wget_tcp_ops);
+	if (ret) {
+		printf("wget: cannot connect (%d)\n", ret);
+		net_set_state(NETLOOP_FAIL);
+	}
+}
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+#define WGET_DEFAULT_PORT	80
+
+void wget_start(void);	/* Begin HTTP download */
+
+#endif /* __WGET_H__ */
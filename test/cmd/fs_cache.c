@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for the file lookup cache and the 'fs cache' command
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <fs.h>
+#include <mapmem.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_FILE	"/extlinux/extlinux.conf"
+#define TEST_SIZE	595
+
+static int fs_cache_check(struct unit_test_state *uts, ulong hits,
+			  ulong misses, int used)
+{
+	struct fs_cache_stats stats;
+
+	fs_cache_get_stats(&stats);
+	ut_asserteq(hits, stats.hits);
+	ut_asserteq(misses, stats.misses);
+	ut_asserteq(used, stats.used);
+
+	return 0;
+}
+
+/* Check that lookups are cached and dropped when the device changes */
+static int dm_test_fs_cache(struct unit_test_state *uts)
+{
+	char buf[TEST_SIZE * 2];
+	struct blk_desc *desc;
+	loff_t size;
+
+	fs_cache_clear();
+	ut_assertok(fs_cache_check(uts, 0, 0, 0));
+
+	/* The first lookup goes to the filesystem, the second does not */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_assertok(fs_size(TEST_FILE, &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_assertok(fs_cache_check(uts, 0, 1, 1));
+
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	size = 0;
+	ut_assertok(fs_size(TEST_FILE, &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_assertok(fs_cache_check(uts, 1, 1, 1));
+
+	/* Knowing the size means the file exists */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_asserteq(1, fs_exists(TEST_FILE));
+	ut_assertok(fs_cache_check(uts, 2, 1, 1));
+
+	/* Files which are missing are remembered too */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_asserteq(0, fs_exists("/not-there"));
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_asserteq(0, fs_exists("/not-there"));
+	ut_assertok(fs_cache_check(uts, 3, 2, 2));
+
+	/* Nothing is cached outside the fs layer */
+	ut_asserteq(false, fs_cache_get_exists(TEST_FILE, NULL));
+	ut_assertok(fs_cache_check(uts, 3, 2, 2));
+
+	/* Writing to the device drops its entries */
+	desc = blk_get_devnum_by_type(IF_TYPE_MMC, 1);
+	ut_assertnonnull(desc);
+	fs_cache_invalidate(desc);
+	ut_assertok(fs_cache_check(uts, 3, 2, 0));
+
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_asserteq(1, fs_exists(TEST_FILE));
+	ut_assertok(fs_cache_check(uts, 3, 3, 1));
+
+	ut_assertok(console_record_reset_enable());
+	ut_assertok(run_command("fs cache", 0));
+	ut_assert_nextline("Entries:       1 / %d", CONFIG_FS_CACHE_ENTRIES);
+	ut_assert_nextline("Hits:          3");
+	ut_assert_nextline("Misses:        3");
+	ut_assert_nextline("Evictions:     0");
+	ut_assert_nextline("Invalidations: 2");
+	ut_assert_nextline("%s", "");
+	ut_assert_nextline("Device     Part Exists       Size  Path");
+	ut_assert_nextline("mmc 1         1 yes             -  " TEST_FILE);
+	ut_assert_console_end();
+
+	ut_assertok(run_command("fs cache clear", 0));
+	ut_assertok(fs_cache_check(uts, 0, 0, 0));
+	ut_assert_console_end();
+
+	/* FAT finds the file again from the handle kept in the cache */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_FAT));
+	ut_assertok(fs_read(TEST_FILE, map_to_sysmem(buf), 0, 0, &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_assertok(fs_cache_check(uts, 0, 1, 1));
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_FAT));
+	ut_assertok(fs_read(TEST_FILE, map_to_sysmem(buf + TEST_SIZE), 0, 0,
+			    &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_assertok(fs_cache_check(uts, 1, 1, 1));
+	ut_asserteq_mem(buf, buf + TEST_SIZE, TEST_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_cache, UT_TESTF_SCAN_FDT | UT_TESTF_CONSOLE_REC);
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for wget command
+ *
+ * A fake HTTP server is hooked into the sandbox Ethernet driver. It drops
+ * one segment of the reply, so the download only completes quickly if the
+ * TCP stack asks for the hole with duplicate ACKs and keeps the segments
+ * received after it.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/eth.h>
+#include <asm/unaligned.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define WGET_TEST_PORT		80
+#define WGET_TEST_MSS		1024
+#define WGET_TEST_BODY_SIZE	(20 * WGET_TEST_MSS + 123)
+/* Offset in the reply of the segment which is dropped */
+#define WGET_TEST_DROP		(3 * WGET_TEST_MSS)
+#define WGET_TEST_ISS		0x10000000
+#define WGET_TEST_ADDR		0x1000
+
+/**
+ * struct wget_test_server - state of the fake HTTP server
+ *
+ * @reply:		HTTP reply, header and body
+ * @reply_len:		number of bytes in @reply
+ * @client_port:	TCP port of the client
+ * @client_nxt:		next sequence number expected from the client
+ * @snd_una:		oldest sequence number not acknowledged by the client
+ * @snd_nxt:		next sequence number to send
+ * @got_request:	true once the GET request has been received
+ * @dropped:		true once the segment at WGET_TEST_DROP was dropped
+ * @dup_acks:		duplicate ACKs received in a row
+ * @fast_retransmits:	number of segments resent after duplicate ACKs
+ */
+struct wget_test_server {
+	char *reply;
+	unsigned int reply_len;
+	u16 client_port;
+	u32 client_nxt;
+	u32 snd_una;
+	u32 snd_nxt;
+	bool got_request;
+	bool dropped;
+	int dup_acks;
+	int fast_retransmits;
+};
+
+static u8 wget_test_byte(unsigned int i)
+{
+	return i * 7 + (i >> 8);
+}
+
+/* Queue a segment for the client to receive */
+static void wget_test_send(struct udevice *dev, struct wget_test_server *srv,
+			   const uchar *client_ethaddr, u8 flags, u32 seq,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *pkt = priv->recv_packet_buffer[priv->recv_packets];
+	struct ethernet_hdr *eth = (struct ethernet_hdr *)pkt;
+	struct ip_tcp_hdr *ip = (void *)pkt + ETHER_HDR_SIZE;
+	unsigned int hdr_len = TCP_HDR_SIZE;
+	uchar *opt = (uchar *)ip + IP_TCP_HDR_SIZE;
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+	uint sum;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	memcpy(eth->et_dest, client_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	if (flags & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(WGET_TEST_MSS, opt + 2);
+		hdr_len += 4;
+	}
+	if (len)
+		memcpy((uchar *)ip + IP_HDR_SIZE + hdr_len,
+		       srv->reply + seq - WGET_TEST_ISS - 1, len);
+
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_HDR_SIZE + hdr_len + len, IPPROTO_TCP);
+	ip->tcp_src = htons(WGET_TEST_PORT);
+	ip->tcp_dst = htons(srv->client_port);
+	ip->tcp_seq = htonl(seq);
+	ip->tcp_ack = htonl(srv->client_nxt);
+	ip->tcp_hlen = (hdr_len / 4) << 4;
+	ip->tcp_flags = flags | TCP_ACK;
+	ip->tcp_win = htons(0xffff);
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = 0;
+
+	pseudo.src = ip->ip_src;
+	pseudo.dst = ip->ip_dst;
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(hdr_len + len);
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+	ip->tcp_xsum = add_ip_checksums(sizeof(pseudo), sum,
+					compute_ip_checksum(&ip->tcp_src,
+							    hdr_len + len));
+
+	priv->recv_packet_length[priv->recv_packets++] =
+		ETHER_HDR_SIZE + IP_HDR_SIZE + hdr_len + len;
+}
+
+static int wget_test_tx_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct wget_test_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	unsigned int hdr_len, data_len, seg_len;
+	u32 seq, ack, end;
+	u8 flags;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_TCP)
+		return 0;
+
+	hdr_len = (ip->tcp_hlen >> 4) * 4;
+	data_len = ntohs(ip->ip_len) - IP_HDR_SIZE - hdr_len;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	flags = ip->tcp_flags;
+
+	if (flags & TCP_RST)
+		return 0;
+	if (flags & TCP_SYN) {
+		srv->client_port = ntohs(ip->tcp_src);
+		srv->client_nxt = seq + 1;
+		srv->snd_una = WGET_TEST_ISS + 1;
+		srv->snd_nxt = srv->snd_una;
+		wget_test_send(dev, srv, eth->et_src, TCP_SYN, WGET_TEST_ISS,
+			       0);
+		return 0;
+	}
+
+	if ((s32)(ack - srv->snd_una) > 0) {
+		srv->snd_una = ack;
+		srv->dup_acks = 0;
+	} else if (ack == srv->snd_una && srv->snd_nxt != srv->snd_una &&
+		   !data_len && ++srv->dup_acks >= 3 &&
+		   !srv->fast_retransmits && priv->recv_packets < PKTBUFSRX) {
+		/* Only one segment is ever lost, so only resend it once */
+		srv->fast_retransmits++;
+		seg_len = min_t(u32, WGET_TEST_MSS,
+				WGET_TEST_ISS + 1 + srv->reply_len - ack);
+		wget_test_send(dev, srv, eth->et_src, TCP_PSH, ack, seg_len);
+	}
+
+	if (data_len && seq == srv->client_nxt) {
+		srv->client_nxt += data_len;
+		if (!strncmp((char *)ip + IP_HDR_SIZE + hdr_len,
+			     "GET /file HTTP/1.0\r\n", 20))
+			srv->got_request = true;
+	}
+	/* The client closes once it has the whole body; no need to answer */
+	if ((flags & TCP_FIN) || !srv->got_request)
+		return 0;
+
+	end = WGET_TEST_ISS + 1 + srv->reply_len;
+	while (srv->snd_nxt != end && priv->recv_packets < PKTBUFSRX) {
+		seg_len = min_t(u32, WGET_TEST_MSS, end - srv->snd_nxt);
+		if (!srv->dropped &&
+		    srv->snd_nxt - WGET_TEST_ISS - 1 == WGET_TEST_DROP)
+			srv->dropped = true;
+		else
+			wget_test_send(dev, srv, eth->et_src, TCP_PSH,
+				       srv->snd_nxt, seg_len);
+		srv->snd_nxt += seg_len;
+	}
+
+	return 0;
+}
+
+/* Download a file over a connection which loses a segment */
+static int dm_test_cmd_wget(struct unit_test_state *uts)
+{
+	static const char header[] = "HTTP/1.0 200 OK\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"Content-Length: %d\r\n"
+		"\r\n";
+	struct wget_test_server srv;
+	struct tcp_stats stats;
+	unsigned int i, hdr_len;
+	uchar *buf;
+
+	memset(&srv, '\0', sizeof(srv));
+	srv.reply = calloc(1, sizeof(header) + 16 + WGET_TEST_BODY_SIZE);
+	ut_assertnonnull(srv.reply);
+	hdr_len = sprintf(srv.reply, header, WGET_TEST_BODY_SIZE);
+	for (i = 0; i < WGET_TEST_BODY_SIZE; i++)
+		srv.reply[hdr_len + i] = wget_test_byte(i);
+	srv.reply_len = hdr_len + WGET_TEST_BODY_SIZE;
+
+	buf = map_sysmem(WGET_TEST_ADDR, WGET_TEST_BODY_SIZE + 1);
+	memset(buf, '\0', WGET_TEST_BODY_SIZE + 1);
+
+	env_set("ethact", "eth@10002000");
+	net_ip = string_to_ip("192.0.2.1");
+	net_server_ip = string_to_ip("192.0.2.2");
+	env_set("httpdstp", NULL);
+	sandbox_eth_set_tx_handler(0, wget_test_tx_handler);
+	sandbox_eth_set_priv(0, &srv);
+
+	ut_assertok(run_command("wget 1000 /file", 0));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	ut_asserteq(WGET_TEST_BODY_SIZE, env_get_hex("filesize", 0));
+	for (i = 0; i < WGET_TEST_BODY_SIZE; i++)
+		ut_asserteq(wget_test_byte(i), buf[i]);
+	ut_asserteq(0, buf[WGET_TEST_BODY_SIZE]);
+	unmap_sysmem(buf);
+
+	/* The hole was repaired by a fast retransmit, not by a timeout */
+	ut_assert(srv.dropped);
+	ut_asserteq(1, srv.fast_retransmits);
+	tcp_get_stats(&stats);
+	ut_assert(stats.ooo_segs >= 3);
+	ut_asserteq(0, stats.retransmits);
+	ut_asserteq(WGET_TEST_BODY_SIZE + hdr_len, stats.bytes_in);
+	free(srv.reply);
+
+	return 0;
+}
+DM_TEST(dm_test_cmd_wget, UT_TESTF_SCAN_FDT);
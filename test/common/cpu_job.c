@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for jobs on secondary cores
+ *
+ * On sandbox the workers are host threads, so this checks that jobs really
+ * run concurrently and that malloc() copes with that.
+ */
+
+#include <common.h>
+#include <cpu_job.h>
+#include <malloc.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* More than fit in the ring of a worker, so some run on the boot core */
+#define TEST_JOBS	20
+#define TEST_ALLOCS	200
+
+struct test_job {
+	struct cpu_job job;
+	uint seed;
+	uint sum;
+	bool on_worker;
+};
+
+static uint test_job_sum(uint seed)
+{
+	uint i, sum = 0;
+
+	for (i = 0; i < TEST_ALLOCS; i++)
+		sum += seed * i;
+
+	return sum;
+}
+
+static int test_job_func(void *arg)
+{
+	struct test_job *tj = arg;
+	uint *buf;
+	uint i;
+
+	tj->on_worker = cpu_job_on_worker();
+	for (i = 0; i < TEST_ALLOCS; i++) {
+		buf = malloc(64 + i);
+		if (!buf)
+			return -ENOMEM;
+		*buf = tj->seed * i;
+		tj->sum += *buf;
+		free(buf);
+	}
+
+	return tj->seed;
+}
+
+static int test_cpu_job_run(struct unit_test_state *uts)
+{
+	struct test_job jobs[TEST_JOBS];
+	int i, on_worker = 0;
+	void *ptr;
+
+	memset(jobs, '\0', sizeof(jobs));
+	for (i = 0; i < TEST_JOBS; i++) {
+		jobs[i].seed = i + 1;
+		cpu_job_queue(&jobs[i].job, test_job_func, &jobs[i]);
+	}
+
+	/* Allocate on the boot core while the jobs do the same */
+	for (i = 0; i < TEST_ALLOCS; i++) {
+		ptr = malloc(128);
+		ut_assertnonnull(ptr);
+		free(ptr);
+	}
+
+	for (i = 0; i < TEST_JOBS; i++) {
+		ut_asserteq(i + 1, cpu_job_wait(&jobs[i].job));
+		ut_asserteq(CPU_JOB_DONE, jobs[i].job.state);
+		ut_asserteq(test_job_sum(i + 1), jobs[i].sum);
+		on_worker += jobs[i].on_worker;
+	}
+	ut_assert(on_worker > 0);
+	ut_assert(!cpu_job_on_worker());
+
+	return 0;
+}
+
+static int test_cpu_job(struct unit_test_state *uts)
+{
+	ut_assertok(test_cpu_job_run(uts));
+	ut_assertok(cpu_job_stop());
+
+	/* The workers start again when needed */
+	ut_assertok(test_cpu_job_run(uts));
+	ut_assertok(cpu_job_stop());
+
+	return 0;
+}
+COMMON_TEST(test_cpu_job, 0);
+
+/* Set to let test_block_func() return */
+static int test_release;
+
+static int test_block_func(void *arg)
+{
+	while (!__atomic_load_n(&test_release, __ATOMIC_ACQUIRE))
+		;
+
+	return 0;
+}
+
+/* Test that a job stuck behind another one runs on the boot core */
+static int test_cpu_job_timeout(struct unit_test_state *uts)
+{
+	struct cpu_job block[CONFIG_CPU_JOB_WORKERS];
+	struct test_job tj;
+	int i;
+
+	test_release = 0;
+	for (i = 0; i < CONFIG_CPU_JOB_WORKERS; i++)
+		cpu_job_queue(&block[i], test_block_func, NULL);
+	memset(&tj, '\0', sizeof(tj));
+	tj.seed = 3;
+	tj.on_worker = true;
+	cpu_job_queue(&tj.job, test_job_func, &tj);
+
+	ut_asserteq(3, cpu_job_wait_timeout(&tj.job, 20));
+	ut_asserteq(CPU_JOB_DONE, tj.job.state);
+	ut_asserteq(test_job_sum(3), tj.sum);
+	ut_assert(!tj.on_worker);
+
+	/* A job which is running cannot be taken back */
+	ut_asserteq(-ETIMEDOUT, cpu_job_wait_timeout(&block[0], 20));
+
+	__atomic_store_n(&test_release, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < CONFIG_CPU_JOB_WORKERS; i++)
+		ut_assertok(cpu_job_wait(&block[i]));
+	ut_assertok(cpu_job_stop());
+
+	return 0;
+}
+COMMON_TEST(test_cpu_job_timeout, 0);
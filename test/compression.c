@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <abuf.h>
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
@@ -22,6 +23,7 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <linux/zstd.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -121,6 +123,27 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/*
+ * for i in $(seq 16); do cat /tmp/plain.txt; done > /tmp/plain16.txt
+ * zstd -19 -c /tmp/plain16.txt > /tmp/plain16.zst
+ */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\xe0\x14\xcd\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x09\x00\x7f\x14\xb6\xdd\xc1\x26\x02\xc6"
+	"\x46\x1d\x51\x28\xf3\x82\x54\xf0\x84\x23\xe1\x3e\x55\xd5\x42\xf4"
+	"\x42\x55\x19\x07\x78\x43\x8a";
+static const unsigned long zstd_compressed_size = 199;
+static const int zstd_plain_repeat = 16;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -536,6 +559,140 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/* Number of frames in the input of the zstd frame tests */
+#define ZSTD_TEST_FRAMES	512
+
+/* Fill @out with @count copies of the zstd frame, returning its size */
+static int zstd_make_frames(struct unit_test_state *uts, struct abuf *out,
+			    int count)
+{
+	int i;
+
+	ut_assert(abuf_realloc(out, count * zstd_compressed_size));
+	for (i = 0; i < count; i++)
+		memcpy(abuf_data(out) + i * zstd_compressed_size,
+		       zstd_compressed, zstd_compressed_size);
+
+	return 0;
+}
+
+/* Check that @buf holds the plain text repeated to fill @count frames */
+static int zstd_check_plain(struct unit_test_state *uts, struct abuf *buf,
+			    int count)
+{
+	ulong plain_len = strlen(plain);
+	int i;
+
+	for (i = 0; i < count * zstd_plain_repeat; i++)
+		ut_asserteq_mem(plain, abuf_data(buf) + i * plain_len,
+				plain_len);
+
+	return 0;
+}
+
+/* Test finding and decompressing independent zstd frames */
+static int compression_test_zstd_frames(struct unit_test_state *uts)
+{
+	ulong frame_len = strlen(plain) * zstd_plain_repeat;
+	struct zstd_frame frames[3];
+	struct abuf in, out;
+	void *ws;
+
+	if (!CONFIG_IS_ENABLED(ZSTD))
+		return -EAGAIN;
+
+	abuf_init(&in);
+	abuf_init(&out);
+	ut_assertok(zstd_make_frames(uts, &in, 3));
+	ut_assert(abuf_realloc(&out, 3 * frame_len));
+
+	/* A short list still gives the number of frames */
+	ut_asserteq(3, zstd_find_frames(&in, NULL, 0));
+	ut_asserteq(3, zstd_find_frames(&in, frames, 2));
+	ut_asserteq(3, zstd_find_frames(&in, frames, ARRAY_SIZE(frames)));
+	ut_asserteq_ptr(zstd_compressed_size + abuf_data(&in), frames[1].src);
+	ut_asserteq(zstd_compressed_size, frames[2].src_len);
+	ut_asserteq(2 * frame_len, frames[2].dst_off);
+	ut_asserteq(frame_len, frames[2].dst_len);
+
+	/* Frames can be decompressed in any order */
+	ws = malloc(ZSTD_DCtxWorkspaceBound());
+	ut_assertnonnull(ws);
+	memset(abuf_data(&out), '\0', abuf_size(&out));
+	ut_assertok(zstd_decompress_frame(&frames[2], ws, &out));
+	ut_assertok(zstd_decompress_frame(&frames[0], ws, &out));
+	ut_assertok(zstd_decompress_frame(&frames[1], ws, &out));
+	ut_assertok(zstd_check_plain(uts, &out, 3));
+
+	/* The whole lot, as well as through the normal entry point */
+	memset(abuf_data(&out), '\0', abuf_size(&out));
+	ut_asserteq(3 * frame_len, zstd_decompress_frames(&in, &out));
+	ut_assertok(zstd_check_plain(uts, &out, 3));
+	memset(abuf_data(&out), '\0', abuf_size(&out));
+	ut_asserteq(3 * frame_len, zstd_decompress(&in, &out));
+	ut_assertok(zstd_check_plain(uts, &out, 3));
+
+	/* Output too small */
+	abuf_realloc(&out, 3 * frame_len - 1);
+	ut_asserteq(-ENOSPC, zstd_decompress_frame(&frames[2], ws, &out));
+	ut_asserteq(-ENOSPC, zstd_decompress_frames(&in, &out));
+	free(ws);
+
+	/* Truncated and corrupted input */
+	abuf_realloc(&out, 3 * frame_len);
+	in.size--;
+	ut_asserteq(-EINVAL, zstd_find_frames(&in, NULL, 0));
+	in.size++;
+	memset(abuf_data(&in) + zstd_compressed_size + 20, '\x49', 40);
+	ut_asserteq(-EINVAL, zstd_decompress_frames(&in, &out));
+
+	abuf_uninit(&in);
+	abuf_uninit(&out);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_frames, 0);
+
+/* Check that sharing frames between cores gives the same as one go */
+static int compression_test_zstd_lanes(struct unit_test_state *uts)
+{
+	ulong frame_len = strlen(plain) * zstd_plain_repeat;
+	struct abuf in, out;
+	ZSTD_DCtx *dctx;
+	size_t len;
+	void *ws;
+
+	if (!CONFIG_IS_ENABLED(ZSTD))
+		return -EAGAIN;
+
+	abuf_init(&in);
+	abuf_init(&out);
+	ut_assertok(zstd_make_frames(uts, &in, ZSTD_TEST_FRAMES));
+	ut_assert(abuf_realloc(&out, ZSTD_TEST_FRAMES * frame_len));
+	ws = malloc(ZSTD_DCtxWorkspaceBound());
+	ut_assertnonnull(ws);
+
+	/* The single-shot decoder runs through all the frames on this core */
+	dctx = ZSTD_initDCtx(ws, ZSTD_DCtxWorkspaceBound());
+	ut_assertnonnull(dctx);
+	len = ZSTD_decompressDCtx(dctx, abuf_data(&out), abuf_size(&out),
+				  abuf_data(&in), abuf_size(&in));
+	ut_asserteq(ZSTD_TEST_FRAMES * frame_len, len);
+	ut_assertok(zstd_check_plain(uts, &out, ZSTD_TEST_FRAMES));
+	free(ws);
+
+	memset(abuf_data(&out), '\0', abuf_size(&out));
+	len = zstd_decompress_frames(&in, &out);
+	ut_asserteq(ZSTD_TEST_FRAMES * frame_len, len);
+	ut_assertok(zstd_check_plain(uts, &out, ZSTD_TEST_FRAMES));
+
+	abuf_uninit(&in);
+	abuf_uninit(&out);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_lanes, 0);
+
 int do_ut_compression(struct cmd_tbl *cmdtp, int flag, int argc,
 		      char *const argv[])
 {
@@ -5,7 +5,9 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
 #include <part.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
@@ -334,3 +336,135 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the block cache lookup, fill and eviction */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	char buf[8 * 512], out[8 * 512];
+	int i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / 512;
+
+	/* 8 slots of 8 blocks each, in two sets of four ways */
+	blkcache_configure(8, 8);
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	blkcache_fill(IF_TYPE_HOST, 0, 0, 8, 512, buf);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.entries);
+
+	/* A partial read within the filled range hits */
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 0, 2, 4, 512, out));
+	ut_asserteq_mem(buf + 2 * 512, out, 4 * 512);
+
+	/* Blocks beyond it, on another device or too large a read all miss */
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 6, 4, 512, out));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 1, 0, 4, 512, out));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 0, 9, 512, out));
+
+	/* An unaligned fill spans two slots */
+	blkcache_fill(IF_TYPE_HOST, 0, 12, 8, 512, buf);
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 0, 14, 4, 512, out));
+	ut_asserteq_mem(buf + 2 * 512, out, 4 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(3, stats.misses);
+	ut_asserteq(3, stats.entries);
+	ut_asserteq(0, stats.evictions);
+	ut_asserteq(4, stats.ways);
+
+	/* Filling more windows than there are slots evicts old ones */
+	for (i = 0; i < 16; i++)
+		blkcache_fill(IF_TYPE_HOST, 0, 0x100 + i * 8, 8, 512, buf);
+	blkcache_stats(&stats);
+	ut_assert(stats.entries <= 8);
+	ut_asserteq(19, stats.entries + stats.evictions);
+
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 0x100, 8, 512, out));
+
+	/* Restore the defaults */
+	blkcache_configure(8, 32);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+
+#if CONFIG_IS_ENABLED(BLOCK_READAHEAD)
+/* Test that sequential reads are grown into a readahead window */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	static char fname[] = "/tmp/dm_test_blk_readahead.img";
+	struct blk_readahead_stats stats;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char buf[512];
+	int fd, i;
+
+	/* Each block of the backing file holds its own block number */
+	fd = os_open(fname, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	for (i = 0; i < 256; i++) {
+		memset(buf, i, sizeof(buf));
+		ut_asserteq(sizeof(buf), os_write(fd, buf, sizeof(buf)));
+	}
+	os_close(fd);
+
+	ut_assertok(host_dev_bind(0, fname, false));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	desc = dev_get_uclass_plat(dev);
+	blkcache_configure(0, 0);
+	ut_asserteq(1, blk_dread(desc, 128, 1, buf));
+	blk_get_readahead_stats(dev, &stats);
+
+	/*
+	 * The first read goes straight to the device, then the window grows
+	 * 2, 4, 8, ... blocks, so 64 single-block reads need seven transfers
+	 */
+	for (i = 0; i < 64; i++) {
+		ut_asserteq(1, blk_dread(desc, i, 1, buf));
+		ut_asserteq(i, buf[0]);
+		ut_asserteq(i, buf[511]);
+	}
+	blk_get_readahead_stats(dev, &stats);
+	ut_asserteq(64, stats.reads);
+	ut_asserteq(7, stats.issued);
+	ut_asserteq(57, stats.merged);
+	ut_asserteq(1 + 2 + 4 + 8 + 16 + 32 + 64, stats.blocks);
+
+	/* Random access does not read ahead */
+	ut_asserteq(1, blk_dread(desc, 200, 1, buf));
+	ut_asserteq(200, (u8)buf[0]);
+	ut_asserteq(1, blk_dread(desc, 150, 1, buf));
+	ut_asserteq(150, (u8)buf[0]);
+	blk_get_readahead_stats(dev, &stats);
+	ut_asserteq(2, stats.issued);
+	ut_asserteq(2, stats.blocks);
+
+	/* The window stops at the end of the device */
+	for (i = 248; i < 256; i++)
+		ut_asserteq(1, blk_dread(desc, i, 1, buf));
+	ut_asserteq(255, (u8)buf[0]);
+	blk_get_readahead_stats(dev, &stats);
+	ut_asserteq(8, stats.blocks);
+
+	/* A write discards the window */
+	memset(buf, 0xaa, sizeof(buf));
+	ut_asserteq(1, blk_dread(desc, 0, 1, buf));
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	memset(buf, 0xaa, sizeof(buf));
+	ut_asserteq(1, blk_dwrite(desc, 2, 1, buf));
+	ut_asserteq(1, blk_dread(desc, 2, 1, buf));
+	ut_asserteq(0xaa, (u8)buf[0]);
+
+	blkcache_configure(8, 32);
+	ut_assertok(host_dev_bind(0, NULL, false));
+	os_unlink(fname);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, 0);
+#endif
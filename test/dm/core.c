@@ -11,8 +11,10 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -1028,6 +1030,39 @@ static int dm_test_uclass_before_ready(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass_before_ready, 0);
 
+/* Test that uclasses are found using the table */
+static int dm_test_uclass_table(struct unit_test_state *uts)
+{
+	struct uclass_table *tab = gd_uclass_table();
+	struct uclass *uc;
+	ulong finds, walks;
+
+	if (!CONFIG_IS_ENABLED(DM_UCLASS_TABLE))
+		return -EAGAIN;
+	ut_assertnonnull(tab);
+	ut_assert(tab->complete);
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	ut_asserteq_ptr(uc, tab->uc[UCLASS_TEST]);
+
+	finds = tab->finds;
+	walks = tab->walks;
+	ut_asserteq_ptr(uc, uclass_find(UCLASS_TEST));
+	ut_asserteq(finds + 1, tab->finds);
+	ut_asserteq(walks, tab->walks);
+
+	/* Removing the uclass drops it from the table */
+	ut_assertok(uclass_destroy(uc));
+	ut_assertnull(tab->uc[UCLASS_TEST]);
+	ut_assertnull(uclass_find(UCLASS_TEST));
+	ut_asserteq(walks, tab->walks);
+
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	ut_asserteq_ptr(uc, tab->uc[UCLASS_TEST]);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_table, 0);
+
 static int dm_test_uclass_devices_find(struct unit_test_state *uts)
 {
 	struct udevice *dev;
@@ -1366,3 +1401,129 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+#define BIND_MAX_DEVS	1000
+
+/* Record the driver of @dev and its children, in tree order */
+static void bind_record(struct udevice *dev, const struct driver **drvs,
+			int *countp)
+{
+	struct udevice *child;
+
+	if (*countp < BIND_MAX_DEVS)
+		drvs[*countp] = dev->driver;
+	(*countp)++;
+	device_foreach_child(child, dev)
+		bind_record(child, drvs, countp);
+}
+
+/* Bind the whole devicetree, then remove it all again */
+static int bind_all(struct unit_test_state *uts, const struct driver **drvs,
+		    int *countp)
+{
+	struct uclass *uc;
+	int id;
+
+	ut_assertok(dm_extended_scan(false));
+
+	*countp = 0;
+	bind_record(uts->root, drvs, countp);
+
+	/* Drop the uclasses too, since some keep state about their devices */
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		if (id == UCLASS_ROOT)
+			continue;
+		uc = uclass_find(id);
+		if (uc)
+			ut_assertok(uclass_destroy(uc));
+	}
+
+	return 0;
+}
+
+/* Bind the whole devicetree searching the linker list for drivers */
+static int bind_all_list(struct unit_test_state *uts,
+			 const struct driver **drvs, int *countp)
+{
+	int ret;
+
+	lists_use_hash(false);
+	ret = bind_all(uts, drvs, countp);
+	lists_use_hash(true);
+
+	return ret;
+}
+
+/* Compare binding with the driver hash tables against searching the list */
+static int dm_test_bind_hash(struct unit_test_state *uts)
+{
+	const struct driver **list_drvs, **hash_drvs;
+	int list_count, hash_count;
+
+	list_drvs = calloc(BIND_MAX_DEVS, sizeof(*list_drvs));
+	hash_drvs = calloc(BIND_MAX_DEVS, sizeof(*hash_drvs));
+	ut_assertnonnull(list_drvs);
+	ut_assertnonnull(hash_drvs);
+
+	ut_assertok(bind_all_list(uts, list_drvs, &list_count));
+	ut_assertok(bind_all(uts, hash_drvs, &hash_count));
+
+	/* The same driver must be picked for each node either way */
+	ut_assert(list_count > 1);
+	ut_assert(list_count <= BIND_MAX_DEVS);
+	ut_asserteq(list_count, hash_count);
+	ut_asserteq_mem(list_drvs, hash_drvs, list_count * sizeof(*list_drvs));
+
+	free(list_drvs);
+	free(hash_drvs);
+
+	return 0;
+}
+DM_TEST(dm_test_bind_hash, 0);
+
+/* Test binding devicetree nodes when they are first needed */
+static int dm_test_lazy_bind(struct unit_test_state *uts)
+{
+	struct udevice *dev, *dev2;
+	struct uclass *uc;
+	int deferred, id;
+	ofnode node;
+
+	if (!CONFIG_IS_ENABLED(DM_LAZY_BIND))
+		return -EAGAIN;
+
+	ut_assertok(lists_lazy_start());
+	ut_assertok(dm_extended_scan(false));
+	lists_lazy_stop();
+	deferred = lists_deferred_count();
+	ut_assert(deferred > 0);
+
+	/* Using the uclass binds its devices */
+	ut_assertnull(uclass_find(UCLASS_RNG));
+	ut_assertok(uclass_find_device_by_name(UCLASS_RNG, "rng", &dev));
+	ut_assert(lists_deferred_count() < deferred);
+
+	/* Looking up a node binds its device and the others in its uclass */
+	node = ofnode_path("/pwm");
+	ut_assert(ofnode_valid(node));
+	ut_assertnull(uclass_find(UCLASS_PWM));
+	ut_assertok(device_find_global_by_ofnode(node, &dev));
+	ut_asserteq_str("pwm", dev->name);
+	ut_asserteq(UCLASS_PWM, device_get_uclass_id(dev));
+
+	/* They are numbered in devicetree order */
+	ut_assertok(uclass_find_device_by_name(UCLASS_PWM, "pwm2", &dev2));
+	ut_assert(dev_seq(dev) < dev_seq(dev2));
+
+	/* Nodes found after lists_lazy_stop() are bound straight away */
+	ut_assert(!lists_defer_fdt(uts->root, ofnode_path("/bootcount"),
+				   false));
+
+	/* Everything is bound once each uclass has been used */
+	for (id = 0; id < UCLASS_COUNT; id++)
+		uclass_get(id, &uc);
+	ut_asserteq(0, lists_deferred_count());
+
+	return 0;
+}
+DM_TEST(dm_test_lazy_bind, 0);
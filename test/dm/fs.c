@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for mounted filesystems and open files in the fs layer
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_FILE	"/extlinux/extlinux.conf"
+#define TEST_SIZE	595
+
+/* Check that an open file reads the same as fs_read() */
+static int dm_test_fs_mount(struct unit_test_state *uts)
+{
+	struct fs_mount *mnt;
+	struct fs_file *file;
+	struct blk_desc *desc;
+	loff_t size, actread;
+	char *expect, *buf;
+
+	desc = blk_get_devnum_by_type(IF_TYPE_MMC, 1);
+	ut_assertnonnull(desc);
+
+	expect = malloc(TEST_SIZE);
+	ut_assertnonnull(expect);
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_assertok(fs_read(TEST_FILE, map_to_sysmem(expect), 0, 0, &actread));
+	ut_asserteq(TEST_SIZE, actread);
+
+	ut_assertok(fs_mount(desc, 1, &mnt));
+	ut_asserteq(-ENOENT, fs_file_open(mnt, "/not-there", &file));
+	ut_assertok(fs_file_open(mnt, TEST_FILE, &file));
+	ut_assertok(fs_file_size(file, &size));
+	ut_asserteq(TEST_SIZE, size);
+
+	/* Read the file a piece at a time */
+	buf = calloc(1, TEST_SIZE + 16);
+	ut_assertnonnull(buf);
+	ut_assertok(fs_pread(file, buf, 0, 100, &actread));
+	ut_asserteq(100, actread);
+	ut_assertok(fs_pread(file, buf + 100, 100, 400, &actread));
+	ut_asserteq(400, actread);
+
+	/* Reading stops at the end of the file */
+	ut_assertok(fs_pread(file, buf + 500, 500, 100, &actread));
+	ut_asserteq(TEST_SIZE - 500, actread);
+	ut_asserteq_mem(expect, buf, TEST_SIZE);
+	ut_assertok(fs_pread(file, buf, TEST_SIZE, 16, &actread));
+	ut_asserteq(0, actread);
+	ut_assertok(fs_pread(file, buf, 0, 0, &actread));
+	ut_asserteq(0, actread);
+
+	/* Using the fs layer in the meantime closes the mount */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_assertok(fs_size(TEST_FILE, &size));
+	memset(buf, '\0', TEST_SIZE);
+	ut_assertok(fs_pread(file, buf, 0, TEST_SIZE, &actread));
+	ut_asserteq(TEST_SIZE, actread);
+	ut_asserteq_mem(expect, buf, TEST_SIZE);
+
+	/* A mounted filesystem can be selected for the other calls */
+	ut_assertok(fs_set_mount(mnt));
+	ut_asserteq(1, fs_exists(TEST_FILE));
+
+	/* Writing to the device drops what is known */
+	fs_invalidate(desc);
+	size = 0;
+	ut_assertok(fs_file_size(file, &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_assertok(fs_pread(file, buf, 590, 16, &actread));
+	ut_asserteq(5, actread);
+	ut_asserteq_mem(expect + 590, buf, 5);
+
+	fs_file_close(file);
+	fs_unmount(mnt);
+	free(buf);
+	free(expect);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_mount, UT_TESTF_SCAN_FDT);
+
+/* Check that files on a memory-backed device can be used in place */
+static int dm_test_fs_map(struct unit_test_state *uts)
+{
+	struct fs_mount *mnt;
+	struct fs_file *file;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	loff_t actread, size;
+	char blk[512];
+	char *expect;
+	void *ptr;
+
+	expect = malloc(TEST_SIZE);
+	ut_assertnonnull(expect);
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_assertok(fs_read(TEST_FILE, map_to_sysmem(expect), 0, 0, &actread));
+	ut_asserteq(TEST_SIZE, actread);
+
+	/* MMC devices cannot be mapped */
+	ut_assertok(fs_set_blk_dev("mmc", "1:1", FS_TYPE_ANY));
+	ut_asserteq(-ENOSYS, fs_map(TEST_FILE, 0, 0, &ptr, &size));
+
+	/* Host devices map their backing file */
+	ut_assertok(host_dev_bind(0, "mmc1.img", false));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	desc = dev_get_uclass_plat(dev);
+	ut_assertok(blk_dmap(desc, 1, 1, &ptr));
+	ut_asserteq(1, blk_dread(desc, 1, 1, blk));
+	ut_asserteq_mem(blk, ptr, sizeof(blk));
+	ut_asserteq(-ERANGE, blk_dmap(desc, desc->lba, 1, &ptr));
+	ut_asserteq(-ERANGE, blk_dmap(desc, 1, desc->lba, &ptr));
+
+	ut_assertok(fs_set_blk_dev("host", "0:1", FS_TYPE_ANY));
+	ut_assertok(fs_map(TEST_FILE, 0, 0, &ptr, &size));
+	ut_asserteq(TEST_SIZE, size);
+	ut_asserteq_mem(expect, ptr, TEST_SIZE);
+
+	/* Part of the file, stopping at the end */
+	ut_assertok(fs_set_blk_dev("host", "0:1", FS_TYPE_ANY));
+	ut_assertok(fs_map(TEST_FILE, 500, 200, &ptr, &size));
+	ut_asserteq(TEST_SIZE - 500, size);
+	ut_asserteq_mem(expect + 500, ptr, size);
+
+	ut_assertok(fs_set_blk_dev("host", "0:1", FS_TYPE_ANY));
+	ut_asserteq(-ENXIO, fs_map(TEST_FILE, TEST_SIZE, 0, &ptr, &size));
+	ut_assertok(fs_set_blk_dev("host", "0:1", FS_TYPE_ANY));
+	ut_assert(fs_map("/not-there", 0, 0, &ptr, &size));
+
+	/* A mount cannot be used once its device is removed */
+	ut_assertok(fs_mount(desc, 1, &mnt));
+	ut_assertok(fs_file_open(mnt, TEST_FILE, &file));
+	ut_assertok(host_dev_bind(0, NULL, false));
+	ut_asserteq(-ENODEV, fs_set_mount(mnt));
+	ut_asserteq(-ENODEV, fs_pread(file, expect, 0, TEST_SIZE, &actread));
+	fs_unmount(mnt);
+	free(expect);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_map, UT_TESTF_SCAN_FDT);
+
+#define EXT4_BLKSZ	1024
+
+/*
+ * Check @count blocks of an ext4 test file from block @first, which should
+ * hold @val, @val + 1, ..., or zeroes if @val is 0
+ */
+static int check_ext4_blocks(struct unit_test_state *uts, const char *buf,
+			     int first, int count, int val)
+{
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < EXT4_BLKSZ; j++)
+			ut_asserteq(val ? val + i : 0,
+				    (u8)buf[(first + i) * EXT4_BLKSZ + j]);
+	}
+
+	return 0;
+}
+
+/* Check that ext4 reads whole runs and drops them when the device changes */
+static int dm_test_fs_ext4_runs(struct unit_test_state *uts)
+{
+	static char fname[] = "/tmp/dm_test_fs_ext4.img";
+	const int sparse_size = 88 * EXT4_BLKSZ;
+	struct blk_readahead_stats stats;
+	char *image, *swapped, *buf;
+	struct fs_mount *mnt;
+	struct fs_file *file;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	loff_t actread;
+	char blk[512];
+	int size, i, b;
+
+	/* Work on a copy, since the test writes to it */
+	ut_assertok(os_read_file("ext4.img", (void **)&image, &size));
+	ut_assertok(os_write_file(fname, image, size));
+	ut_assertok(os_read_file("ext4-swapped.img", (void **)&swapped,
+				 &size));
+	ut_assertok(host_dev_bind(0, fname, false));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	desc = dev_get_uclass_plat(dev);
+	buf = malloc(sparse_size);
+	ut_assertnonnull(buf);
+
+	/* Each run is read from the device in one go, not a block at a time */
+	blk_get_readahead_stats(dev, &stats);
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_EXT));
+	ut_assertok(fs_read("/big", map_to_sysmem(buf), 0, 0, &actread));
+	ut_asserteq(64 * EXT4_BLKSZ, actread);
+	ut_assertok(check_ext4_blocks(uts, buf, 0, 64, 1));
+	blk_get_readahead_stats(dev, &stats);
+	ut_assert(stats.reads < 16);
+
+	/* Holes read as zeroes, also when read in pieces */
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_EXT));
+	ut_assertok(fs_read("/sparse", map_to_sysmem(buf), 0, 0, &actread));
+	ut_asserteq(sparse_size, actread);
+	for (b = 0; b < 88; b += 16) {
+		ut_assertok(check_ext4_blocks(uts, buf, b, 8, b + 1));
+		if (b + 8 < 88)
+			ut_assertok(check_ext4_blocks(uts, buf, b + 8, 8, 0));
+	}
+
+	memset(buf, '\xff', sparse_size);
+	ut_assertok(fs_mount(desc, 0, &mnt));
+	ut_assertok(fs_file_open(mnt, "/sparse", &file));
+	ut_assertok(fs_pread(file, buf, 0, 7 * EXT4_BLKSZ + 100, &actread));
+	ut_assertok(fs_pread(file, buf + actread, actread,
+			     sparse_size - actread, &actread));
+	ut_asserteq(sparse_size - 7 * EXT4_BLKSZ - 100, actread);
+	ut_assertok(check_ext4_blocks(uts, buf, 0, 8, 1));
+	ut_assertok(check_ext4_blocks(uts, buf, 8, 8, 0));
+	ut_assertok(check_ext4_blocks(uts, buf, 80, 8, 81));
+
+	/*
+	 * Move the first two extents of /sparse behind the back of the
+	 * filesystem. Only the leaf block changes, not the inode.
+	 */
+	for (i = 0; i < size / sizeof(blk); i++) {
+		ut_asserteq(1, blk_dread(desc, i, 1, blk));
+		if (memcmp(blk, swapped + i * sizeof(blk), sizeof(blk)))
+			ut_asserteq(1, blk_dwrite(desc, i, 1,
+						  swapped + i * sizeof(blk)));
+	}
+	ut_assertok(fs_pread(file, buf, 0, sparse_size, &actread));
+	ut_asserteq(sparse_size, actread);
+	ut_assertok(check_ext4_blocks(uts, buf, 0, 8, 17));
+	ut_assertok(check_ext4_blocks(uts, buf, 16, 8, 1));
+	ut_assertok(check_ext4_blocks(uts, buf, 32, 8, 33));
+
+	fs_file_close(file);
+	fs_unmount(mnt);
+	ut_assertok(host_dev_bind(0, NULL, false));
+	os_unlink(fname);
+	os_free(swapped);
+	os_free(image);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_ext4_runs, UT_TESTF_SCAN_FDT);
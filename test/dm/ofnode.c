@@ -4,14 +4,18 @@
 #include <dm.h>
 #include <log.h>
 #include <of_live.h>
+#include <os.h>
+#include <asm/state.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <u-boot/crc.h>
 
 static int dm_test_ofnode_compatible(struct unit_test_state *uts)
 {
@@ -40,6 +44,39 @@ static int dm_test_ofnode_get_by_phandle(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_ofnode_get_by_phandle, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Check that phandles are still found in the live tree as it changes */
+static int dm_test_ofnode_phandle_table(struct unit_test_state *uts)
+{
+	struct device_node *np, *target = NULL;
+	phandle highest = 0;
+
+	if (!of_live_active())
+		return -EAGAIN;
+
+	for_each_of_allnodes(np) {
+		if (np->phandle) {
+			ut_asserteq_ptr(np, of_find_node_by_phandle(np->phandle));
+			highest = max(highest, np->phandle);
+		} else if (np->parent && !target) {
+			target = np;
+		}
+	}
+	ut_assert(highest > 1);
+	ut_assertnonnull(target);
+
+	/* A node which gains a phandle is found, then found again */
+	target->phandle = highest + 1;
+	ut_asserteq_ptr(target, of_find_node_by_phandle(highest + 1));
+	ut_asserteq_ptr(target, of_find_node_by_phandle(highest + 1));
+
+	/* ...but not once the phandle is gone */
+	target->phandle = 0;
+	ut_assertnull(of_find_node_by_phandle(highest + 1));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_table, 0);
+
 static int dm_test_ofnode_by_prop_value(struct unit_test_state *uts)
 {
 	const char propname[] = "compatible";
@@ -601,3 +638,77 @@ static int dm_test_ofnode_u32(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_ofnode_u32,
 	UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT | UT_TESTF_LIVE_OR_FLAT);
+
+/* Check a node of the prebuilt live tree against the unflattened one */
+static int check_prebuilt_node(struct unit_test_state *uts,
+			       const struct of_live_prebuilt *pre,
+			       const void *blob, const struct device_node *np,
+			       const struct device_node *exp)
+{
+	const struct device_node *child, *exp_child;
+	const struct property *pp, *exp_pp;
+	int i;
+
+	ut_asserteq_str(exp->name, np->name);
+	ut_asserteq_str(exp->type, np->type);
+	ut_asserteq_str(exp->full_name, np->full_name);
+	ut_asserteq(exp->phandle, np->phandle);
+
+	/* Properties must be in the same order, with the same values */
+	for (pp = np->properties, exp_pp = exp->properties; pp && exp_pp;
+	     pp = pp->next, exp_pp = exp_pp->next) {
+		ut_asserteq_str(exp_pp->name, pp->name);
+		ut_asserteq(exp_pp->length, pp->length);
+		i = pp - pre->props;
+		ut_assert(i >= 0 && i < pre->prop_count);
+		if (pre->value_offset[i]) {
+			ut_asserteq_ptr(exp_pp->value,
+					blob + pre->value_offset[i]);
+		} else {
+			/* A name property added by unflatten_device_tree() */
+			ut_asserteq_str("name", pp->name);
+			ut_asserteq_mem(exp_pp->value, pp->value, pp->length);
+		}
+	}
+	ut_assertnull(pp);
+	ut_assertnull(exp_pp);
+
+	for (child = np->child, exp_child = exp->child; child && exp_child;
+	     child = child->sibling, exp_child = exp_child->sibling) {
+		ut_asserteq_ptr(np, child->parent);
+		ut_assertok(check_prebuilt_node(uts, pre, blob, child,
+						exp_child));
+	}
+	ut_assertnull(child);
+	ut_assertnull(exp_child);
+
+	return 0;
+}
+
+/* Test that the live tree generated at build time matches unflattening */
+static int dm_test_ofnode_prebuilt(struct unit_test_state *uts)
+{
+	const struct of_live_prebuilt *pre = &of_live_prebuilt;
+	struct sandbox_state *state = state_get_current();
+	struct device_node *root;
+	char fname[256];
+	void *blob;
+	int size;
+
+	if (!CONFIG_IS_ENABLED(OF_LIVE_PREBUILT))
+		return -EAGAIN;
+
+	/* The tree is generated from U-Boot's default devicetree */
+	snprintf(fname, sizeof(fname), "%s.dtb", state->argv[0]);
+	ut_assertok(os_read_file(fname, &blob, &size));
+	ut_asserteq(pre->fdt_size, size);
+	ut_asserteq(pre->fdt_crc, crc32(0, blob, size));
+
+	ut_assertok(unflatten_device_tree(blob, &root));
+	ut_assertok(check_prebuilt_node(uts, pre, blob, pre->root, root));
+	free(root);
+	os_free(blob);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_prebuilt, 0);
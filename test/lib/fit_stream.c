@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for hashing FIT images while they are loaded
+ */
+
+#include <common.h>
+#include <command.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/libfdt.h>
+
+#define TEST_ADDR		0x100000
+#define TEST_HDR_SPACE		0x1000
+#define TEST_KERNEL_SIZE	(100 * 1024 + 3)
+#define TEST_FDT_SIZE		1000
+/* Size of the pieces the file is 'loaded' in, like a TFTP block */
+#define TEST_PIECE		1468
+
+static u8 test_byte(uint i, uint seed)
+{
+	return i * 13 + (i >> 9) + seed;
+}
+
+static int add_image(void *fit, const char *name, const char *algo,
+		     int offset, const u8 *data, int size)
+{
+	u8 value[FIT_MAX_HASH_LEN];
+	int len;
+
+	if (calculate_hash(data, size, algo, value, &len))
+		return -EINVAL;
+
+	fdt_begin_node(fit, name);
+	fdt_property_u32(fit, FIT_DATA_OFFSET_PROP, offset);
+	fdt_property_u32(fit, FIT_DATA_SIZE_PROP, size);
+	fdt_begin_node(fit, "hash-1");
+	fdt_property_string(fit, FIT_ALGO_PROP, algo);
+	fdt_property(fit, FIT_VALUE_PROP, value, len);
+	fdt_end_node(fit);
+
+	return fdt_end_node(fit);
+}
+
+/**
+ * make_fit() - create a FIT with external data at TEST_ADDR
+ *
+ * It holds a kernel hashed with sha256 and an fdt hashed with crc32
+ *
+ * @seed:	varies the image data
+ * Return: total size of the file
+ */
+static ulong make_fit(struct unit_test_state *uts, uint seed)
+{
+	void *fit = map_sysmem(TEST_ADDR, TEST_HDR_SPACE);
+	ulong hdr_size, fdt_offset;
+	u8 *kernel, *fdt;
+	uint i;
+
+	kernel = malloc(TEST_KERNEL_SIZE);
+	fdt = malloc(TEST_FDT_SIZE);
+	ut_assertnonnull(kernel);
+	ut_assertnonnull(fdt);
+	for (i = 0; i < TEST_KERNEL_SIZE; i++)
+		kernel[i] = test_byte(i, seed);
+	for (i = 0; i < TEST_FDT_SIZE; i++)
+		fdt[i] = test_byte(i, seed + 1);
+	fdt_offset = ALIGN(TEST_KERNEL_SIZE, 4);
+
+	ut_assertok(fdt_create(fit, TEST_HDR_SPACE));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_string(fit, FIT_DESC_PROP, "test"));
+	ut_assertok(fdt_begin_node(fit, FIT_IMAGES_PATH + 1));
+	ut_assertok(add_image(fit, "kernel", "sha256", 0, kernel,
+			      TEST_KERNEL_SIZE));
+	ut_assertok(add_image(fit, "fdt", "crc32", fdt_offset, fdt,
+			      TEST_FDT_SIZE));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+	hdr_size = ALIGN(fdt_totalsize(fit), 4);
+	unmap_sysmem(fit);
+
+	memcpy(map_sysmem(TEST_ADDR + hdr_size, TEST_KERNEL_SIZE), kernel,
+	       TEST_KERNEL_SIZE);
+	memcpy(map_sysmem(TEST_ADDR + hdr_size + fdt_offset, TEST_FDT_SIZE),
+	       fdt, TEST_FDT_SIZE);
+	free(kernel);
+	free(fdt);
+
+	return hdr_size + fdt_offset + TEST_FDT_SIZE;
+}
+
+/* Feed a file to the stream as a loader would, skipping @gap if not 0 */
+static void load_file(ulong size, ulong gap)
+{
+	ulong pos, len;
+
+	fit_stream_load_start(TEST_ADDR);
+	for (pos = 0; pos < size; pos += len) {
+		len = min_t(ulong, TEST_PIECE, size - pos);
+		if (!gap || pos < gap || pos >= gap + TEST_PIECE)
+			fit_stream_load_data(pos, len);
+	}
+	fit_stream_load_end();
+}
+
+static int get_image(struct unit_test_state *uts, const void *fit,
+		     const char *path, const void **datap, size_t *sizep)
+{
+	int node = fdt_path_offset(fit, path);
+
+	ut_assert(node >= 0);
+	ut_assertok(fit_image_get_data_and_size(fit, node, datap, sizep));
+
+	return node;
+}
+
+/* Test that digests computed while loading are used for verification */
+static int lib_test_fit_stream(struct unit_test_state *uts)
+{
+	u8 value[FIT_MAX_HASH_LEN], *fit_value;
+	int node, len, fit_len;
+	const void *fit, *data;
+	size_t size;
+	ulong total;
+
+	total = make_fit(uts, 0);
+	fit = map_sysmem(TEST_ADDR, total);
+	load_file(total, 0);
+
+	/* Each digest matches the FIT and is handed out only once */
+	node = get_image(uts, fit, "/images/kernel", &data, &size);
+	ut_asserteq(TEST_KERNEL_SIZE, size);
+	ut_assert(fit_stream_get_digest(data, size, "sha256", value, &len));
+	ut_assertok(fit_image_hash_get_value(fit, fdt_first_subnode(fit, node),
+					     &fit_value, &fit_len));
+	ut_asserteq(fit_len, len);
+	ut_asserteq_mem(fit_value, value, len);
+	ut_assert(!fit_stream_get_digest(data, size, "sha256", value, &len));
+
+	/* The fdt digest is picked up by the normal verification */
+	node = get_image(uts, fit, "/images/fdt", &data, &size);
+	ut_asserteq(1, fit_image_verify(fit, node));
+	ut_assert(!fit_stream_get_digest(data, size, "crc32", value, &len));
+
+	/* Damage arriving with the data is caught */
+	node = get_image(uts, fit, "/images/kernel", &data, &size);
+	((u8 *)data)[size / 2] ^= 1;
+	load_file(total, 0);
+	ut_asserteq(0, fit_image_verify(fit, node));
+	unmap_sysmem(fit);
+
+	/* Nothing is recorded for an image with a hole in its data */
+	total = make_fit(uts, 1);
+	fit = map_sysmem(TEST_ADDR, total);
+	node = get_image(uts, fit, "/images/kernel", &data, &size);
+	load_file(total, ALIGN(fdt_totalsize(fit), 4) + 10 * TEST_PIECE);
+	ut_assert(!fit_stream_get_digest(data, size, "sha256", value, &len));
+	ut_asserteq(1, fit_image_verify(fit, node));
+
+	/* A file which is not a FIT is not split up */
+	fit_stream_load_start(TEST_ADDR + 1);
+	ut_assert(fit_stream_load_active());
+	fit_stream_load_data(0, TEST_PIECE);
+	ut_assert(!fit_stream_load_active());
+	fit_stream_load_end();
+	unmap_sysmem(fit);
+
+	return 0;
+}
+LIB_TEST(lib_test_fit_stream, 0);
+
+/* Test that digests are not trusted once the image data may have changed */
+static int lib_test_fit_stream_changed(struct unit_test_state *uts)
+{
+	char key_blob[0x100], cmd[40];
+	const void *fit, *data;
+	size_t size;
+	ulong total;
+	int node;
+
+	/* A command which writes to memory drops the digests */
+	total = make_fit(uts, 2);
+	fit = map_sysmem(TEST_ADDR, total);
+	node = get_image(uts, fit, "/images/kernel", &data, &size);
+	load_file(total, 0);
+	snprintf(cmd, sizeof(cmd), "mw.b %lx %x",
+		 (ulong)map_to_sysmem(data) + 7,
+		 ((u8 *)data)[7] ^ 0xff);
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq(0, fit_image_verify(fit, node));
+	unmap_sysmem(fit);
+
+	/* With a required key the data is hashed again, whatever changed it */
+	ut_assertok(fdt_create(key_blob, sizeof(key_blob)));
+	ut_assertok(fdt_finish_reservemap(key_blob));
+	ut_assertok(fdt_begin_node(key_blob, ""));
+	ut_assertok(fdt_begin_node(key_blob, FIT_SIG_NODENAME));
+	ut_assertok(fdt_begin_node(key_blob, "key-dev"));
+	ut_assertok(fdt_property_string(key_blob, FIT_KEY_REQUIRED, "conf"));
+	ut_assertok(fdt_end_node(key_blob));
+	ut_assertok(fdt_end_node(key_blob));
+	ut_assertok(fdt_end_node(key_blob));
+	ut_assertok(fdt_finish(key_blob));
+
+	total = make_fit(uts, 3);
+	fit = map_sysmem(TEST_ADDR, total);
+	node = get_image(uts, fit, "/images/kernel", &data, &size);
+	load_file(total, 0);
+	((u8 *)data)[size - 1] ^= 1;
+	ut_asserteq(0, fit_image_verify_with_data(fit, node, key_blob, data,
+						  size));
+	((u8 *)data)[size - 1] ^= 1;
+	ut_asserteq(1, fit_image_verify_with_data(fit, node, key_blob, data,
+						  size));
+	unmap_sysmem(fit);
+
+	return 0;
+}
+LIB_TEST(lib_test_fit_stream_changed, 0);
@@ -41,3 +41,12 @@ def test_dm_uclass(u_boot_console):
 @pytest.mark.buildconfigspec("cmd_dm")
 def test_dm_devres(u_boot_console):
     response = u_boot_console.run_command("dm devres")
+
+@pytest.mark.buildconfigspec('cmd_dm')
+@pytest.mark.buildconfigspec('dm_stats')
+@pytest.mark.buildconfigspec('dm_uclass_table')
+def test_dm_stats(u_boot_console):
+    """Test that `dm stats` shows uclasses being found using the table."""
+    response = u_boot_console.run_command('dm stats')
+    assert 'uclass table:' in response
+    assert '0 searched the list' in response
@@ -2,14 +2,23 @@
 # Copyright (C) 2022 Huang Jianan <jnhuang95@gmail.com>
 # Author: Huang Jianan <jnhuang95@gmail.com>
 
+import hashlib
+import lzma
 import os
 import pytest
+import re
 import shutil
+import struct
 import subprocess
+import zlib
 
 EROFS_SRC_DIR = 'erofs_src_dir'
 EROFS_IMAGE_NAME = 'erofs.img'
 
+# Compressible file spanning many physical clusters, for the cache test
+EROFS_BIG_FILE = 'f262144'
+EROFS_BIG_SIZE = 262144
+
 def generate_file(name, size):
     """
     Generates a file filled with 'x'.
@@ -19,12 +28,21 @@ def generate_file(name, size):
     file.write(content)
     file.close()
 
-def make_erofs_image(build_dir):
+def generate_text_file(name, size):
+    """
+    Generates a file of numbered lines, which compresses but not to nothing.
+    """
+    content = ''.join('line %d\n' % i for i in range(size // 5))[:size]
+    with open(name, 'w') as file:
+        file.write(content)
+
+def make_erofs_image(build_dir, compressor):
     """
     Makes the EROFS images used for the test.
 
     The image is generated at build_dir with the following structure:
     erofs_src_dir/
+    ├── f262144
     ├── f4096
     ├── f7812
     ├── subdir/
@@ -41,6 +59,9 @@ def make_erofs_image(build_dir):
     # 7812: Compressed file
     generate_file(os.path.join(root, 'f7812'), 7812)
 
+    # Compressed file made of many physical clusters
+    generate_text_file(os.path.join(root, EROFS_BIG_FILE), EROFS_BIG_SIZE)
+
     # sub-directory with a single file inside
     subdir_path = os.path.join(root, 'subdir')
     os.makedirs(subdir_path)
@@ -53,17 +74,106 @@ def make_erofs_image(build_dir):
     input_path = os.path.join(build_dir, EROFS_SRC_DIR)
     output_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
     args = ' '.join([output_path, input_path])
-    subprocess.run(['mkfs.erofs -zlz4 ' + args], shell=True, check=True,
-                   stdout=subprocess.DEVNULL)
+    ret = subprocess.run(['mkfs.erofs -z%s %s' % (compressor, args)],
+                         shell=True, capture_output=True, text=True)
+
+    # Older mkfs.erofs only knows lz4, which must always work
+    output = ret.stdout + ret.stderr
+    if (ret.returncode and compressor != 'lz4' and
+            re.search('compressor', output, re.IGNORECASE)):
+        return False
+    ret.check_returncode()
+    return True
+
+def make_zip_image(build_dir, compressor):
+    """
+    Makes an EROFS image holding only the big file, compressed with
+    @compressor, without needing mkfs.erofs.
+
+    Each logical cluster is compressed on its own into one physical cluster,
+    aligned to its end, and described by a legacy full index:
+
+    block 0: superblock
+    block 1: root directory inode, file inode, map header and indexes
+    block 2: root directory entries
+    block 3: compressed physical clusters, one per block
+    """
+    blksz = 4096
+    root = os.path.join(build_dir, EROFS_SRC_DIR)
+    os.makedirs(root)
+    path = os.path.join(root, EROFS_BIG_FILE)
+    generate_text_file(path, EROFS_BIG_SIZE)
+    with open(path, 'rb') as file:
+        data = file.read()
+
+    nclusters = (len(data) + blksz - 1) // blksz
+    pclusters = b''
+    indexes = b''
+    for i in range(nclusters):
+        chunk = data[i * blksz:(i + 1) * blksz]
+        if compressor == 'lzma':
+            # MicroLZMA: the first byte holds the inverted properties
+            comp = lzma.compress(chunk, format=lzma.FORMAT_RAW,
+                                 filters=[{'id': lzma.FILTER_LZMA1,
+                                           'lc': 3, 'lp': 0, 'pb': 2}])
+            comp = bytes([~0x5d & 0xff]) + comp[1:]
+            alg = 1
+        else:
+            obj = zlib.compressobj(9, zlib.DEFLATED, -15)
+            comp = obj.compress(chunk) + obj.flush()
+            alg = 2
+        assert comp[0] and len(comp) < blksz
+        pclusters += comp.rjust(blksz, b'\0')
+
+        # HEAD lcluster starting at offset 0 of its own pcluster
+        indexes += struct.pack('<HHI', 1, 0, 3 + i)
+
+    def inode(fmt, mode, nlink, size, u, ino):
+        return struct.pack('<HHHHIIIIHHI', fmt, 0, mode, nlink, size, 0, u,
+                           ino, 0, 0, 0)
+
+    # root directory is nid 0 (flat plain), the file is nid 2
+    names = [b'.', b'..', EROFS_BIG_FILE.encode()]
+    nids = [0, 0, 2]
+    types = [2, 2, 1]
+    dirents = b''
+    nameoff = 12 * len(names)
+    for nid, name, ftype in zip(nids, names, types):
+        dirents += struct.pack('<QHBB', nid, nameoff, ftype, 0)
+        nameoff += len(name)
+    dirents += b''.join(names)
+
+    meta = inode(0 << 1, 0o40755, 2, len(dirents), 2, 1)
+    meta += b'\0' * 32
+    meta += inode(1 << 1, 0o100644, 1, len(data), nclusters, 2)
+    # map header: h_algorithmtype and 4KiB logical clusters, then padding
+    meta += struct.pack('<IHBB', 0, 0, alg, 0) + b'\0' * 8
+    meta += indexes
+    assert len(meta) <= blksz
+
+    nblocks = 3 + nclusters
+    sb = struct.pack('<IIIBBHQQIIII', 0xe0f5e1e2, 0, 0, 12, 0, 0, 2, 0, 0,
+                     nblocks, 1, 0)
+    sb += b'\0' * 32
+    # LZ4_0PADDING and BIG_PCLUSTER, so the map header is read from disk
+    sb += struct.pack('<I', 0x3)
+    sb = sb.ljust(128, b'\0')
+
+    image = b'\0' * 1024 + sb
+    image = image.ljust(blksz, b'\0') + meta.ljust(blksz, b'\0')
+    image += dirents.ljust(blksz, b'\0') + pclusters
+    with open(os.path.join(build_dir, EROFS_IMAGE_NAME), 'wb') as file:
+        file.write(image)
 
 def clean_erofs_image(build_dir):
     """
     Deletes the image and src_dir at build_dir.
     """
     path = os.path.join(build_dir, EROFS_SRC_DIR)
-    shutil.rmtree(path)
+    shutil.rmtree(path, ignore_errors=True)
     image_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
-    os.remove(image_path)
+    if os.path.exists(image_path):
+        os.remove(image_path)
 
 def erofs_ls_at_root(u_boot_console):
     """
@@ -73,8 +183,9 @@ def erofs_ls_at_root(u_boot_console):
     slash = u_boot_console.run_command('erofsls host 0 /')
     assert no_slash == slash
 
-    expected_lines = ['./', '../', '4096   f4096', '7812   f7812', 'subdir/',
-                      '<SYM>   symdir', '<SYM>   symfile', '4 file(s), 3 dir(s)']
+    expected_lines = ['./', '../', '4096   f4096', '7812   f7812',
+                      '262144   f262144', 'subdir/', '<SYM>   symdir',
+                      '<SYM>   symfile', '5 file(s), 3 dir(s)']
 
     output = u_boot_console.run_command('erofsls host 0')
     for line in expected_lines:
@@ -170,6 +281,61 @@ def erofs_load_non_existent_file(u_boot_console):
     out = u_boot_console.run_command('erofsload host 0 {} {}'.format(address, file))
     assert 'Failed to load' in out
 
+def erofs_load_piece(u_boot_console, offset, size):
+    """
+    Loads part of the big file and checks it.
+    """
+    address = '$kernel_addr_r'
+    out = u_boot_console.run_command('erofsload host 0 {} {} {:x} {:x}'.format(
+        address, EROFS_BIG_FILE, size, offset))
+    assert '%d bytes read' % size in out
+
+    out = u_boot_console.run_command('md5sum {} {:x}'.format(address, size))
+    u_boot_checksum = out.split()[-1]
+
+    build_dir = u_boot_console.config.build_dir
+    path = os.path.join(build_dir, EROFS_SRC_DIR, EROFS_BIG_FILE)
+    with open(path, 'rb') as file:
+        file.seek(offset)
+        original_checksum = hashlib.md5(file.read(size)).hexdigest()
+    assert u_boot_checksum == original_checksum
+
+def erofs_cache_stats(u_boot_console):
+    """
+    Returns the hits, fills and evictions of the pcluster cache.
+    """
+    out = u_boot_console.run_command('erofsstat')
+    match = re.search(r'(\d+) hits, (\d+) filled, (\d+) evicted', out)
+    assert match
+    return [int(val) for val in match.groups()]
+
+def erofs_load_pieces(u_boot_console):
+    """
+    Test the cache of decompressed physical clusters.
+
+    A read which stops within a physical cluster keeps it decompressed, so
+    that the next read carries on from the cache. Reading from more physical
+    clusters than the cache holds evicts the oldest one.
+    """
+    u_boot_console.run_command('erofsstat reset')
+    erofs_load_piece(u_boot_console, 1000, 100)
+    first_hits, fills, evictions = erofs_cache_stats(u_boot_console)
+    assert fills == 1
+
+    # A load may read the file in more than one go, e.g. to check for a FIT
+    erofs_load_piece(u_boot_console, 1100, 100)
+    hits, fills, evictions = erofs_cache_stats(u_boot_console)
+    assert hits > first_hits
+    assert fills == 1
+
+    for i in range(8):
+        erofs_load_piece(u_boot_console, i * 0x8000 + 10, 100)
+    hits, fills, evictions = erofs_cache_stats(u_boot_console)
+    assert evictions > 0
+
+    # A whole file read across the cached pieces is still right
+    erofs_load_piece(u_boot_console, 0, EROFS_BIG_SIZE)
+
 def erofs_run_all_tests(u_boot_console):
     """
     Runs all test cases.
@@ -182,6 +348,7 @@ def erofs_run_all_tests(u_boot_console):
     erofs_load_files_at_subdir(u_boot_console)
     erofs_load_files_at_symlink(u_boot_console)
     erofs_load_non_existent_file(u_boot_console)
+    erofs_load_pieces(u_boot_console)
 
 @pytest.mark.boardspec('sandbox')
 @pytest.mark.buildconfigspec('cmd_fs_generic')
@@ -189,16 +356,25 @@ def erofs_run_all_tests(u_boot_console):
 @pytest.mark.buildconfigspec('fs_erofs')
 @pytest.mark.requiredtool('mkfs.erofs')
 @pytest.mark.requiredtool('md5sum')
+@pytest.mark.parametrize('compressor', ['lz4', 'lzma', 'deflate'])
 
-def test_erofs(u_boot_console):
+def test_erofs(u_boot_console, compressor):
     """
     Executes the erofs test suite.
     """
     build_dir = u_boot_console.config.build_dir
 
+    if compressor != 'lz4':
+        config = 'fs_erofs_zip_' + compressor
+        if not u_boot_console.config.buildconfig.get('config_' + config):
+            pytest.skip('%s is not enabled' % config.upper())
+
+    if not make_erofs_image(build_dir, compressor):
+        clean_erofs_image(build_dir)
+        pytest.skip('mkfs.erofs does not support -z%s' % compressor)
+
     try:
         # setup test environment
-        make_erofs_image(build_dir)
         image_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
         u_boot_console.run_command('host bind 0 {}'.format(image_path))
         # run all tests
@@ -209,3 +385,36 @@ def test_erofs(u_boot_console):
 
     # clean test environment
     clean_erofs_image(build_dir)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_erofs')
+@pytest.mark.buildconfigspec('fs_erofs')
+@pytest.mark.requiredtool('md5sum')
+@pytest.mark.parametrize('compressor', ['lzma', 'deflate'])
+
+def test_erofs_zip(u_boot_console, compressor):
+    """
+    Decompresses a file which does not need mkfs.erofs to be made, so that
+    each decompressor, the cache and whole-file reads are always covered.
+    """
+    build_dir = u_boot_console.config.build_dir
+
+    config = 'fs_erofs_zip_' + compressor
+    if not u_boot_console.config.buildconfig.get('config_' + config):
+        pytest.skip('%s is not enabled' % config.upper())
+
+    clean_erofs_image(build_dir)
+    make_zip_image(build_dir, compressor)
+
+    try:
+        image_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
+        u_boot_console.run_command('host bind 0 {}'.format(image_path))
+        output = u_boot_console.run_command('erofsls host 0')
+        assert '%d   %s' % (EROFS_BIG_SIZE, EROFS_BIG_FILE) in output
+        erofs_load_pieces(u_boot_console)
+    except:
+        clean_erofs_image(build_dir)
+        raise AssertionError
+
+    clean_erofs_image(build_dir)
@@ -5,6 +5,7 @@ import gzip
 import os
 import os.path
 import pytest
+import re
 
 import u_boot_utils
 
@@ -96,6 +97,51 @@ label Fedora-Workstation-armhfp-31-1.9 (5.3.7-301.fc31.armv7hl)
             cons,
             ['sh', '-c', 'xz -dc %s >%s' % (infname, fname)])
 
+def setup_ext4_image(u_boot_console):
+    """Create a pair of ext4 images for the ext4 run-cache test
+
+    ext4.img holds a 64KB file, 'big', and a file with holes, 'sparse',
+    with enough extents to need a leaf block. Each 1KB block of either file
+    is filled with its block number plus one, so that none are left out as
+    holes. ext4-swapped.img is the same, except that the first two extents
+    of 'sparse' are swapped in the leaf block, so that the inode itself is
+    unchanged.
+    """
+    cons = u_boot_console
+    fname = os.path.join(cons.config.source_dir, 'ext4.img')
+    swapped = os.path.join(cons.config.source_dir, 'ext4-swapped.img')
+    src = os.path.join(cons.config.persistent_data_dir, 'ext4')
+    mkdir_cond(src)
+
+    with open(os.path.join(src, 'big'), 'wb') as fd:
+        for blk in range(64):
+            fd.write(bytes([blk + 1]) * 1024)
+    with open(os.path.join(src, 'sparse'), 'wb') as fd:
+        for blk in range(0, 96, 16):
+            fd.seek(blk * 1024)
+            for i in range(blk, blk + 8):
+                fd.write(bytes([i + 1]) * 1024)
+
+    if os.path.exists(fname):
+        os.remove(fname)
+    u_boot_utils.run_and_log(
+        cons, 'mke2fs -q -t ext4 -b 1024 -O ^has_journal,^metadata_csum '
+        '-d %s %s 1M' % (src, fname))
+    out = u_boot_utils.run_and_log(cons, ['debugfs', '-R', 'stat /sparse',
+                                          fname])
+    leaf = int(re.search(r'\(ETB0\):(\d+)', out).group(1))
+
+    with open(fname, 'rb') as fd:
+        data = bytearray(fd.read())
+
+    # Each extent is 12 bytes after a 12-byte header; the start is at +6
+    first = leaf * 1024 + 12
+    second = first + 12
+    data[first + 6:first + 12], data[second + 6:second + 12] = \
+        data[second + 6:second + 12], data[first + 6:first + 12]
+    with open(swapped, 'wb') as fd:
+        fd.write(data)
+
 
 @pytest.mark.buildconfigspec('ut_dm')
 def test_ut_dm_init(u_boot_console):
@@ -114,6 +160,8 @@ def test_ut_dm_init(u_boot_console):
         with open(fn, 'wb') as fh:
             fh.write(data)
 
+    setup_ext4_image(u_boot_console)
+
 @pytest.mark.buildconfigspec('cmd_bootflow')
 def test_ut_dm_init_bootstd(u_boot_console):
     """Initialise data for bootflow tests"""
@@ -19,6 +19,7 @@ from enum import IntEnum
 import os
 import re
 import sys
+import zlib
 
 from dtoc import fdt
 from dtoc import fdt_util
@@ -138,6 +139,26 @@ def get_value(ftype, value):
         val = '%#x' % value
     return val
 
+def c_string(data):
+    """Get a string of bytes as a C string literal
+
+    Printable characters are written as they are and everything else is written
+    as an octal escape, so that the result is safe for any data
+
+    Args:
+        data (bytes): Data to convert (without any nul terminator)
+
+    Returns:
+        str: C string literal, including the quotes
+    """
+    out = []
+    for char in data:
+        if 0x20 <= char < 0x7f and char not in b'"\\?':
+            out.append(chr(char))
+        else:
+            out.append('\\%03o' % char)
+    return '"%s"' % ''.join(out)
+
 
 class DtbPlatdata():
     """Provide a means to convert device tree binary data to platform data
@@ -1116,6 +1137,129 @@ class DtbPlatdata():
 
         self.out(''.join(self.get_buf()))
 
+    def generate_livetree(self):
+        """Generate the live tree for the devicetree
+
+        This writes out the struct device_node and struct property records
+        that unflatten_device_tree() creates at runtime, so that U-Boot proper
+        can use them without unflattening the tree. Property values are given
+        as offsets into the devicetree, since the live tree points into the
+        blob, so that in-place changes to it remain visible.
+
+        The size and CRC32 of the devicetree are written too, so that the
+        records are only used with the devicetree they were created from.
+
+        See the documentation in doc/develop/driver-model/livetree.rst for more
+        information.
+        """
+        def add_node(node):
+            nodes.append(node)
+            for subnode in node.subnodes:
+                add_node(subnode)
+
+        def node_ref(node):
+            return '&dtl_node[%d]' % node_idx[node.path] if node else 'NULL'
+
+        def unit_name(node):
+            if not node.parent:
+                return b''
+            name = node.name
+            if '@' in name:
+                name = name.rpartition('@')[0]
+            return name.encode('utf-8')
+
+        nodes = []
+        add_node(self._fdt.GetRoot())
+        node_idx = {node.path: seq for seq, node in enumerate(nodes)}
+
+        # Collect the properties of each node as (name, length, offset, value)
+        # adding a 'name' property where needed, as unflatten_dt_node() does
+        node_props = []
+        num_props = 0
+        for node in nodes:
+            props = [(prop.name, len(prop.bytes), prop.GetOffset() + 12, None)
+                     for prop in node.props.values()]
+            if 'name' not in node.props:
+                name = unit_name(node)
+                props.append(('name', len(name) + 1, 0, name))
+            node_props.append((num_props, props))
+            num_props += len(props)
+
+        self.out('#include <common.h>\n')
+        self.out('#include <of_live.h>\n')
+        self.out('#include <dm/of.h>\n')
+        self.out('\n')
+        self.out('static struct device_node dtl_node[%d];\n' % len(nodes))
+        self.out('\n')
+
+        offsets = []
+        self.out('static struct property dtl_prop[%d] = {\n' % num_props)
+        for node, (first, props) in zip(nodes, node_props):
+            self.out('\t/* %s */\n' % node.path)
+            for seq, (name, length, offset, value) in enumerate(props, first):
+                next_ref = ('&dtl_prop[%d]' % (seq + 1)
+                            if seq + 1 < first + len(props) else 'NULL')
+                value = '' if value is None else (
+                    ' .value = %s,' % c_string(value))
+                self.out('\t[%d] = { .name = %s, .length = %d,%s .next = %s },\n'
+                         % (seq, c_string(name.encode('utf-8')), length, value,
+                            next_ref))
+                offsets.append(offset)
+        self.out('};\n')
+        self.out('\n')
+
+        self.out('/* Offset of each property value in the devicetree */\n')
+        self.out('static const u32 dtl_value_offset[%d] = {\n' % num_props)
+        for seq, offset in enumerate(offsets):
+            self.out('\t[%d] = %#x,\n' % (seq, offset))
+        self.out('};\n')
+        self.out('\n')
+
+        self.out('static struct device_node dtl_node[%d] = {\n' % len(nodes))
+        for seq, (node, (first, _)) in enumerate(zip(nodes, node_props)):
+            phandle = 0
+            for prop in node.props.values():
+                if prop.name in ('phandle', 'linux,phandle') and not phandle:
+                    phandle = fdt_util.fdt32_to_cpu(prop.bytes[:4])
+                elif prop.name == 'ibm,phandle':
+                    phandle = fdt_util.fdt32_to_cpu(prop.bytes[:4])
+            name = node.props.get('name')
+            name = name.bytes.split(b'\0')[0] if name else unit_name(node)
+            dev_type = node.props.get('device_type')
+            dev_type = (dev_type.bytes.split(b'\0')[0] if dev_type else
+                        b'<NULL>')
+            sibling = None
+            if node.parent:
+                siblings = node.parent.subnodes
+                idx = siblings.index(node) + 1
+                if idx < len(siblings):
+                    sibling = siblings[idx]
+            self.out('\t[%d] = {\n' % seq)
+            self.out('\t\t.name\t\t= %s,\n' % c_string(name))
+            self.out('\t\t.type\t\t= %s,\n' % c_string(dev_type))
+            self.out('\t\t.phandle\t= %#x,\n' % phandle)
+            self.out('\t\t.full_name\t= %s,\n' %
+                     c_string(node.path.encode('utf-8')))
+            self.out('\t\t.properties\t= &dtl_prop[%d],\n' % first)
+            self.out('\t\t.parent\t\t= %s,\n' % node_ref(node.parent))
+            self.out('\t\t.child\t\t= %s,\n' %
+                     node_ref(node.subnodes[0] if node.subnodes else None))
+            self.out('\t\t.sibling\t= %s,\n' % node_ref(sibling))
+            self.out('\t},\n')
+        self.out('};\n')
+        self.out('\n')
+
+        size = self._fdt.GetFdtObj().totalsize()
+        data = self._fdt.GetContents()[:size]
+        self.out('struct of_live_prebuilt of_live_prebuilt = {\n')
+        self.out('\t.root\t\t= &dtl_node[0],\n')
+        self.out('\t.props\t\t= dtl_prop,\n')
+        self.out('\t.value_offset\t= dtl_value_offset,\n')
+        self.out('\t.prop_count\t= %d,\n' % num_props)
+        self.out('\t.fdt_size\t= %#x,\n' % size)
+        self.out('\t.fdt_crc\t= %#x,\n' % zlib.crc32(data))
+        self.out('};\n')
+
 
 # Types of output file we understand
 # key: Command used to generate this file
@@ -1147,6 +1291,14 @@ OUTPUT_FILES_INST = {
                    'Declares the uclass instances (struct uclass)'),
     }
 
+# File generated from the whole devicetree, for use by U-Boot proper. This does
+# not need the driver scan so cannot be combined with the commands above
+OUTPUT_FILES_LIVETREE = {
+    'livetree':
+        OutputFile(Ftype.SOURCE, 'dt-livetree.c', DtbPlatdata.generate_livetree,
+                   'Declares the live tree (struct device_node) records'),
+    }
+
 
 def run_steps(args, dtb_file, include_disabled, output, output_dirs, phase,
               instantiate, warning_disabled=False, drivers_additional=None,
@@ -1185,6 +1337,18 @@ def run_steps(args, dtb_file, include_disabled, output, output_dirs, phase,
     if output and output_dirs and any(output_dirs):
         raise ValueError('Must specify either output or output_dirs, not both')
 
+    if args[0] in OUTPUT_FILES_LIVETREE:
+        outfile = OUTPUT_FILES_LIVETREE[args[0]]
+        plat = DtbPlatdata(None, dtb_file, include_disabled)
+        plat.scan_dtb()
+        plat.setup_output_dirs(output_dirs)
+        plat.setup_output(outfile.ftype,
+                          outfile.fname if output_dirs else output)
+        plat.out_header(outfile)
+        outfile.method(plat)
+        plat.finish_output()
+        return plat
+
     if not scan:
         scan = src_scan.Scanner(basedir, drivers_additional, phase)
         scan.scan_drivers()
@@ -15,12 +15,14 @@ import glob
 import os
 import struct
 import unittest
+import zlib
 
 from dtoc import dtb_platdata
 from dtoc import fdt
 from dtoc import fdt_util
 from dtoc import src_scan
 from dtoc.dtb_platdata import Ftype
+from dtoc.dtb_platdata import c_string
 from dtoc.dtb_platdata import get_value
 from dtoc.dtb_platdata import tab_to
 from dtoc.src_scan import conv_name_to_c
@@ -66,6 +68,15 @@ C_HEADER = C_HEADER_PRE + '''
 #include <dt-structs.h>
 '''
 
+LIVETREE_HEADER = '''/*
+ * DO NOT MODIFY
+ *
+ * Declares the live tree (struct device_node) records.
+ * This was generated by dtoc from a .dtb (device tree binary) file.
+ */
+
+'''
+
 UCLASS_HEADER_COMMON = '''/*
  * DO NOT MODIFY
  *
@@ -194,6 +205,13 @@ class TestDtoc(unittest.TestCase):
         self.assertEqual('"test"', get_value(fdt.Type.STRING, 'test'))
         self.assertEqual('true', get_value(fdt.Type.BOOL, None))
 
+    def test_c_string(self):
+        """Test operation of c_string() function"""
+        self.assertEqual('""', c_string(b''))
+        self.assertEqual('"i2c@0"', c_string(b'i2c@0'))
+        self.assertEqual(r'"a\042b\134c\077\000\377"',
+                         c_string(b'a"b\\c?\0\xff'))
+
     def test_get_compat_name(self):
         """Test operation of get_compat_name() function"""
         Prop = collections.namedtuple('Prop', ['value'])
@@ -1849,3 +1867,137 @@ U_BOOT_DRVINFO(spl_test2) = {
         self.assertIn("Node '/i2c@0/spl-test/pmic@9' requires parent node "
                       "'/i2c@0/spl-test' but it is not in the valid list",
                       str(exc.exception))
+
+    livetree_text = '''#include <common.h>
+#include <of_live.h>
+#include <dm/of.h>
+
+static struct device_node dtl_node[5];
+
+static struct property dtl_prop[18] = {
+\t/* / */
+\t[0] = { .name = "#address-cells", .length = 4, .next = &dtl_prop[1] },
+\t[1] = { .name = "#size-cells", .length = 4, .next = &dtl_prop[2] },
+\t[2] = { .name = "name", .length = 1, .value = "", .next = NULL },
+\t/* /i2c@0 */
+\t[3] = { .name = "compatible", .length = 12, .next = &dtl_prop[4] },
+\t[4] = { .name = "#address-cells", .length = 4, .next = &dtl_prop[5] },
+\t[5] = { .name = "#size-cells", .length = 4, .next = &dtl_prop[6] },
+\t[6] = { .name = "reg", .length = 4, .next = &dtl_prop[7] },
+\t[7] = { .name = "name", .length = 4, .value = "i2c", .next = NULL },
+\t/* /i2c@0/pmic@9 */
+\t[8] = { .name = "compatible", .length = 13, .next = &dtl_prop[9] },
+\t[9] = { .name = "reg", .length = 4, .next = &dtl_prop[10] },
+\t[10] = { .name = "phandle", .length = 4, .next = &dtl_prop[11] },
+\t[11] = { .name = "name", .length = 5, .value = "pmic", .next = NULL },
+\t/* /cpu@1 */
+\t[12] = { .name = "device_type", .length = 4, .next = &dtl_prop[13] },
+\t[13] = { .name = "reg", .length = 4, .next = &dtl_prop[14] },
+\t[14] = { .name = "power-supply", .length = 4, .next = &dtl_prop[15] },
+\t[15] = { .name = "name", .length = 4, .value = "cpu", .next = NULL },
+\t/* /serial */
+\t[16] = { .name = "u-boot,dm-pre-reloc", .length = 0, .next = &dtl_prop[17] },
+\t[17] = { .name = "name", .length = 7, .value = "serial", .next = NULL },
+};
+
+/* Offset of each property value in the devicetree */
+static const u32 dtl_value_offset[18] = {
+\t[0] = 0x4c,
+\t[1] = 0x5c,
+\t[2] = 0x0,
+\t[3] = 0x78,
+\t[4] = 0x90,
+\t[5] = 0xa0,
+\t[6] = 0xb0,
+\t[7] = 0x0,
+\t[8] = 0xcc,
+\t[9] = 0xe8,
+\t[10] = 0xf8,
+\t[11] = 0x0,
+\t[12] = 0x11c,
+\t[13] = 0x12c,
+\t[14] = 0x13c,
+\t[15] = 0x0,
+\t[16] = 0x15c,
+\t[17] = 0x0,
+};
+
+static struct device_node dtl_node[5] = {
+\t[0] = {
+\t\t.name\t\t= "",
+\t\t.type\t\t= "<NULL>",
+\t\t.phandle\t= 0x0,
+\t\t.full_name\t= "/",
+\t\t.properties\t= &dtl_prop[0],
+\t\t.parent\t\t= NULL,
+\t\t.child\t\t= &dtl_node[1],
+\t\t.sibling\t= NULL,
+\t},
+\t[1] = {
+\t\t.name\t\t= "i2c",
+\t\t.type\t\t= "<NULL>",
+\t\t.phandle\t= 0x0,
+\t\t.full_name\t= "/i2c@0",
+\t\t.properties\t= &dtl_prop[3],
+\t\t.parent\t\t= &dtl_node[0],
+\t\t.child\t\t= &dtl_node[2],
+\t\t.sibling\t= &dtl_node[3],
+\t},
+\t[2] = {
+\t\t.name\t\t= "pmic",
+\t\t.type\t\t= "<NULL>",
+\t\t.phandle\t= 0x1,
+\t\t.full_name\t= "/i2c@0/pmic@9",
+\t\t.properties\t= &dtl_prop[8],
+\t\t.parent\t\t= &dtl_node[1],
+\t\t.child\t\t= NULL,
+\t\t.sibling\t= NULL,
+\t},
+\t[3] = {
+\t\t.name\t\t= "cpu",
+\t\t.type\t\t= "cpu",
+\t\t.phandle\t= 0x0,
+\t\t.full_name\t= "/cpu@1",
+\t\t.properties\t= &dtl_prop[12],
+\t\t.parent\t\t= &dtl_node[0],
+\t\t.child\t\t= NULL,
+\t\t.sibling\t= &dtl_node[4],
+\t},
+\t[4] = {
+\t\t.name\t\t= "serial",
+\t\t.type\t\t= "<NULL>",
+\t\t.phandle\t= 0x0,
+\t\t.full_name\t= "/serial",
+\t\t.properties\t= &dtl_prop[16],
+\t\t.parent\t\t= &dtl_node[0],
+\t\t.child\t\t= NULL,
+\t\t.sibling\t= NULL,
+\t},
+};
+'''
+
+    def test_livetree(self):
+        """Test output of the live tree"""
+        dtb_file = get_dtb_file('dtoc_test_livetree.dts')
+        output = tools.get_output_filename('output')
+
+        # This does not need the driver scan, so can be run without one
+        dtb_platdata.run_steps(['livetree'], dtb_file, False, output, [], None,
+                               False)
+        data = tools.read_file(output, binary=False)
+        dtb = tools.read_file(dtb_file)
+        self._check_strings(LIVETREE_HEADER + '''%s
+struct of_live_prebuilt of_live_prebuilt = {
+\t.root\t\t= &dtl_node[0],
+\t.props\t\t= dtl_prop,
+\t.value_offset\t= dtl_value_offset,
+\t.prop_count\t= 18,
+\t.fdt_size\t= %#x,
+\t.fdt_crc\t= %#x,
+};
+''' % (self.livetree_text, len(dtb), zlib.crc32(dtb)), data)
+
+        # The live tree cannot be generated along with other files
+        with self.assertRaises(ValueError) as exc:
+            self.run_test(['livetree,struct'], dtb_file, output)
+        self.assertIn("Unknown command 'livetree'", str(exc.exception))